@@ -0,0 +1,134 @@
+#include "corpus.h"
+
+#include <algorithm>
+#include <array>
+#include <fmt/core.h>
+#include <fstream>
+#include <random>
+
+namespace cgen::bench {
+namespace {
+
+constexpr std::array<const char *, 6> placeholder_names = {"PROJECT_NAME", "PROJECT_VERSION", "AUTHOR_NAME",
+                                                           "CPP_STANDARD", "NAMESPACE",       "APP_NAME"};
+
+constexpr std::array<const char *, 8> words = {"return", "const", "std::string", "auto", "namespace", "value", "(void)", "// note"};
+
+std::size_t write_small_files(const fs::path &dir, std::size_t count) {
+    fs::create_directories(dir);
+    for (std::size_t i = 0; i < count; ++i) {
+        write_file(dir / fmt::format("file_{:04}.cpp", i), fmt::format("// @PROJECT_NAME@ file {}\nint f{}() {{ return {}; }}\n", i, i, i));
+    }
+    return count;
+}
+
+} // namespace
+
+const std::unordered_map<std::string, std::string> &corpus_values() {
+    static const std::unordered_map<std::string, std::string> values = {
+        {"PROJECT_NAME", "BenchProject"}, {"PROJECT_VERSION", "1.2.3"}, {"AUTHOR_NAME", "Bench Author"},
+        {"CPP_STANDARD", "23"},           {"NAMESPACE", "bench"},       {"APP_NAME", "bench_app"},
+    };
+    return values;
+}
+
+const std::unordered_map<std::string, std::string> &corpus_many_values() {
+    static const std::unordered_map<std::string, std::string> values = [] {
+        auto padded = corpus_values();
+        for (std::size_t i = 0; padded.size() < 128; ++i) {
+            padded.emplace(fmt::format("PROJECT_OPTION_{:03}", i), fmt::format("option {}", i));
+        }
+        return padded;
+    }();
+    return values;
+}
+
+std::string make_text(std::size_t size, std::size_t spacing, std::uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::string  text;
+    text.reserve(size + 64);
+
+    std::size_t next_placeholder = rng() % (2 * spacing);
+    while (text.size() < size) {
+        if (text.size() >= next_placeholder) {
+            text += '@';
+            text += placeholder_names[rng() % placeholder_names.size()];
+            text += '@';
+            next_placeholder = text.size() + rng() % (2 * spacing);
+        } else {
+            text += words[rng() % words.size()];
+            text += (rng() % 8 == 0) ? '\n' : ' ';
+        }
+    }
+    text.resize(size);
+    return text;
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::binary) << content;
+}
+
+std::size_t make_deep_tree(const fs::path &root, std::size_t depth, std::size_t files_per_dir) {
+    std::size_t entries = 0;
+    fs::path    dir     = root;
+    for (std::size_t level = 0; level < depth; ++level) {
+        dir /= fmt::format("level_{:03}", level);
+        entries += 1 + write_small_files(dir, files_per_dir);
+    }
+    return entries;
+}
+
+std::size_t make_wide_tree(const fs::path &root, std::size_t dirs, std::size_t files_per_dir) {
+    std::size_t entries = 0;
+    for (std::size_t i = 0; i < dirs; ++i) {
+        entries += 1 + write_small_files(root / fmt::format("module_{:04}", i), files_per_dir);
+    }
+    return entries;
+}
+
+std::size_t make_project_template(const fs::path &root, double scale) {
+    auto scaled = [scale](std::size_t n) { return std::max<std::size_t>(1, static_cast<std::size_t>(static_cast<double>(n) * scale)); };
+
+    std::size_t  bytes = 0;
+    std::mt19937 rng(42);
+    auto         add   = [&](const fs::path &path, const std::string &content) {
+        write_file(root / path, content);
+        bytes += content.size();
+    };
+
+    add("CMakeLists.txt", make_text(2048, 64, 1));
+    add(".clang-format", "BasedOnStyle: LLVM\nIndentWidth: 4\nColumnLimit: 140\n");
+    add(".clang-tidy", "Checks: '-*,bugprone-*,performance-*'\n");
+
+    for (std::size_t m = 0; m < scaled(40); ++m) {
+        fs::path module = fs::path("src") / fmt::format("module_{:03}", m);
+        for (std::size_t f = 0; f < 10; ++f) {
+            bool dense = f % 3 == 0;
+            add(module / fmt::format("unit_{:02}.cpp", f), make_text(8 * 1024, dense ? 32 : 2048, static_cast<std::uint32_t>(m * 100 + f)));
+        }
+        add(fs::path("include") / fmt::format("module_{:03}.h", m), make_text(2 * 1024, 256, static_cast<std::uint32_t>(m)));
+    }
+
+    // Binary assets carry no placeholders and take the pass-through copy path
+    for (std::size_t a = 0; a < scaled(8); ++a) {
+        std::string asset(128 * 1024, '\0');
+        std::generate(asset.begin(), asset.end(), [&rng] { return static_cast<char>(rng() % 64); }); // Bytes below '@'
+        add(fs::path("assets") / fmt::format("asset_{:02}.bin", a), asset);
+    }
+
+    add(fs::path("data") / "seed.sql", make_text(scaled(16) * 1024 * 1024, 4096, 7));
+    return bytes;
+}
+
+TempDir::TempDir(const std::string &name) : path_(fs::temp_directory_path() / fmt::format("cgen_bench_{}_{}", name, std::random_device{}())) {
+    fs::remove_all(path_);
+    fs::create_directories(path_);
+}
+
+TempDir::~TempDir() {
+    std::error_code ec;
+    fs::remove_all(path_, ec);
+}
+
+} // namespace cgen::bench
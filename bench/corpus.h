@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+namespace cgen::bench {
+namespace fs = std::filesystem;
+
+// Placeholder names used by every synthetic corpus, each bound to a short value
+const std::unordered_map<std::string, std::string> &corpus_values();
+
+// corpus_values() padded with unused keys to the 128 keys a real project passes
+const std::unordered_map<std::string, std::string> &corpus_many_values();
+
+// Source-like text of `size` bytes with one placeholder every `spacing` bytes on average
+std::string make_text(std::size_t size, std::size_t spacing, std::uint32_t seed);
+
+void write_file(const fs::path &path, const std::string &content);
+
+// A chain of `depth` nested directories with `files_per_dir` small files in each, returns the entry count
+std::size_t make_deep_tree(const fs::path &root, std::size_t depth, std::size_t files_per_dir);
+
+// `dirs` sibling directories with `files_per_dir` small files in each, returns the entry count
+std::size_t make_wide_tree(const fs::path &root, std::size_t dirs, std::size_t files_per_dir);
+
+/**
+ * A template shaped like a real project: nested source directories of dense and sparse files,
+ * placeholder-free configuration files and binary assets, and one large data file.
+ *
+ * @return The total number of bytes written.
+ */
+std::size_t make_project_template(const fs::path &root, double scale);
+
+// Directory under the system temp directory, removed with its contents on destruction
+class TempDir {
+  public:
+    explicit TempDir(const std::string &name);
+    ~TempDir();
+    TempDir(const TempDir &)            = delete;
+    TempDir &operator=(const TempDir &) = delete;
+
+    const fs::path &path() const { return path_; }
+
+  private:
+    fs::path path_;
+};
+
+} // namespace cgen::bench
@@ -0,0 +1,118 @@
+#include "harness.h"
+
+#include <algorithm>
+#include <ctime>
+#include <fmt/core.h>
+#include <numeric>
+#include <thread>
+
+namespace cgen::bench {
+namespace {
+
+std::string json_escape(std::string_view text) {
+    std::string escaped;
+    for (char c : text) {
+        switch (c) {
+        case '"': escaped += "\\\""; break;
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\t': escaped += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                escaped += fmt::format("\\u{:04x}", static_cast<unsigned char>(c));
+            } else {
+                escaped += c;
+            }
+        }
+    }
+    return escaped;
+}
+
+std::string compiler_name() {
+#if defined(__clang__)
+    return fmt::format("clang {}.{}.{}", __clang_major__, __clang_minor__, __clang_patchlevel__);
+#elif defined(__GNUC__)
+    return fmt::format("gcc {}.{}.{}", __GNUC__, __GNUC_MINOR__, __GNUC_PATCHLEVEL__);
+#elif defined(_MSC_VER)
+    return fmt::format("msvc {}", _MSC_VER);
+#else
+    return "unknown";
+#endif
+}
+
+} // namespace
+
+void Runner::run(const std::string &name, std::uint64_t bytes, std::uint64_t items, const std::function<void()> &body,
+                 const std::function<void()> &setup) {
+    if (!selected(name)) {
+        return;
+    }
+    using clock = std::chrono::steady_clock;
+
+    if (setup) {
+        setup();
+    }
+    body(); // Warm-up
+
+    std::vector<double> samples;
+    const auto          deadline = clock::now() + std::chrono::duration<double>(options_.min_time);
+    while (samples.size() < options_.max_iters && (samples.size() < options_.min_iters || clock::now() < deadline)) {
+        if (setup) {
+            setup();
+        }
+        auto start = clock::now();
+        body();
+        samples.push_back(std::chrono::duration<double, std::nano>(clock::now() - start).count());
+    }
+
+    BenchResult result{name, samples.size()};
+    result.mean_ns = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+    std::sort(samples.begin(), samples.end());
+    result.median_ns = samples[samples.size() / 2];
+    result.min_ns    = samples.front();
+    result.max_ns    = samples.back();
+    result.bytes     = bytes;
+    result.items     = items;
+
+    std::string throughput;
+    if (bytes != 0) {
+        throughput = fmt::format("  {:9.1f} MiB/s", static_cast<double>(bytes) / (1024.0 * 1024.0) / (result.median_ns * 1e-9));
+    } else if (items != 0) {
+        throughput = fmt::format("  {:9.0f} items/s", static_cast<double>(items) / (result.median_ns * 1e-9));
+    }
+    fmt::print(stderr, "{:<44} {:>6} iters  median {:>12.3f} ms{}\n", name, result.iterations, result.median_ns * 1e-6, throughput);
+
+    results_.push_back(std::move(result));
+}
+
+std::string Runner::toJson() const {
+    std::string json = "{\n  \"context\": {\n";
+    json += fmt::format("    \"timestamp\": {},\n", static_cast<long long>(std::time(nullptr)));
+    json += fmt::format("    \"compiler\": \"{}\",\n", json_escape(compiler_name()));
+    json += fmt::format("    \"hardware_concurrency\": {},\n", std::thread::hardware_concurrency());
+#ifdef NDEBUG
+    json += "    \"assertions\": false\n";
+#else
+    json += "    \"assertions\": true\n";
+#endif
+    json += "  },\n  \"benchmarks\": [";
+
+    for (std::size_t i = 0; i < results_.size(); ++i) {
+        const auto &r = results_[i];
+        json += i == 0 ? "\n" : ",\n";
+        json += fmt::format("    {{\"name\": \"{}\", \"iterations\": {}, \"median_ns\": {:.1f}, \"mean_ns\": {:.1f}, "
+                            "\"min_ns\": {:.1f}, \"max_ns\": {:.1f}, \"bytes\": {}, \"items\": {}",
+                            json_escape(r.name), r.iterations, r.median_ns, r.mean_ns, r.min_ns, r.max_ns, r.bytes, r.items);
+        if (r.bytes != 0) {
+            json += fmt::format(", \"bytes_per_second\": {:.0f}", static_cast<double>(r.bytes) / (r.median_ns * 1e-9));
+        }
+        if (r.items != 0) {
+            json += fmt::format(", \"items_per_second\": {:.0f}", static_cast<double>(r.items) / (r.median_ns * 1e-9));
+        }
+        json += "}";
+    }
+    json += "\n  ]\n}\n";
+    return json;
+}
+
+} // namespace cgen::bench
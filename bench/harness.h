@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cgen::bench {
+
+// Timing of one benchmark, in nanoseconds per iteration
+struct BenchResult {
+    std::string   name;
+    std::size_t   iterations = 0;
+    double        median_ns  = 0;
+    double        mean_ns    = 0;
+    double        min_ns     = 0;
+    double        max_ns     = 0;
+    std::uint64_t bytes      = 0; // Bytes processed per iteration, 0 if not meaningful
+    std::uint64_t items      = 0; // Entries (files, directories, placeholders) per iteration, 0 if not meaningful
+};
+
+struct BenchOptions {
+    std::string filter;           // Only run benchmarks whose name contains this
+    double      min_time  = 0.5;  // Seconds spent timing each benchmark, after one warm-up iteration
+    std::size_t min_iters = 3;    // Iterations timed at least, however long they take
+    std::size_t max_iters = 1000; // Iterations timed at most, however short they are
+};
+
+/**
+ * Minimal benchmark runner: each benchmark runs once untimed to warm caches, then repeatedly
+ * until `min_time` has elapsed (bounded by `min_iters` and `max_iters`). Every iteration is timed
+ * on its own so the median is robust against outliers from other processes.
+ */
+class Runner {
+  public:
+    explicit Runner(BenchOptions options) : options_(std::move(options)) {}
+
+    // `setup` runs before every iteration and is not timed
+    void run(const std::string &name, std::uint64_t bytes, std::uint64_t items, const std::function<void()> &body,
+             const std::function<void()> &setup = {});
+
+    bool selected(const std::string &name) const { return options_.filter.empty() || name.find(options_.filter) != std::string::npos; }
+
+    const std::vector<BenchResult> &results() const { return results_; }
+
+    // The results and the environment they were measured in, as a JSON document
+    std::string toJson() const;
+
+  private:
+    BenchOptions             options_;
+    std::vector<BenchResult> results_;
+};
+
+// Prevents the compiler from optimizing away a computed value
+template <typename T> void keep(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+} // namespace cgen::bench
@@ -0,0 +1,282 @@
+#include "corpus.h"
+#include "harness.h"
+
+#include <algorithm>
+#include <cgen/generator.h>
+#include <cgen/placeholder_processor.h>
+#include <cgen/scanner.h>
+#include <cgen/streaming_renderer.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cxxopts.hpp>
+#include <fmt/core.h>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Path of the cgen executable built alongside, set by bench/CMakeLists.txt
+#ifndef CGEN_EXECUTABLE
+#define CGEN_EXECUTABLE ""
+#endif
+
+using namespace cgen;
+using namespace cgen::bench;
+
+namespace {
+
+constexpr std::size_t mib = 1024 * 1024;
+
+// Sends stdout to /dev/null while alive, so per-file generation messages do not distort the timing
+class SilenceStdout {
+  public:
+    SilenceStdout() {
+#if defined(__unix__) || defined(__APPLE__)
+        std::fflush(stdout);
+        saved_      = ::dup(STDOUT_FILENO);
+        int null_fd = ::open("/dev/null", O_WRONLY);
+        if (saved_ >= 0 && null_fd >= 0) {
+            ::dup2(null_fd, STDOUT_FILENO);
+        }
+        if (null_fd >= 0) {
+            ::close(null_fd);
+        }
+#endif
+    }
+    ~SilenceStdout() {
+#if defined(__unix__) || defined(__APPLE__)
+        std::fflush(stdout);
+        if (saved_ >= 0) {
+            ::dup2(saved_, STDOUT_FILENO);
+            ::close(saved_);
+        }
+#endif
+    }
+    SilenceStdout(const SilenceStdout &)            = delete;
+    SilenceStdout &operator=(const SilenceStdout &) = delete;
+
+  private:
+    int saved_ = -1;
+};
+
+std::size_t scaled(std::size_t n, double scale) { return std::max<std::size_t>(1, static_cast<std::size_t>(static_cast<double>(n) * scale)); }
+
+void placeholder_benchmarks(Runner &runner, double scale) {
+    PlaceholderProcessor processor;
+    const auto          &values = corpus_many_values();
+
+    struct Corpus {
+        const char   *name;
+        std::size_t   size;
+        std::size_t   spacing; // Average distance between placeholders
+        std::uint32_t seed;
+    };
+    const Corpus corpora[] = {
+        {"dense", scaled(4 * mib, scale), 32, 1},
+        {"sparse", scaled(4 * mib, scale), 4096, 2},
+        {"huge", scaled(64 * mib, scale), 4096, 3}, // Large generated data file
+    };
+    const char *groups[] = {"extract_placeholders", "replace_placeholders", "compiled_render", "bound_render",
+                            "arena_render",         "directive_render",     "stream_render"};
+
+    for (const auto &corpus : corpora) {
+        bool selected = false;
+        for (const char *group : groups) {
+            selected = selected || runner.selected(fmt::format("{}/{}", group, corpus.name));
+        }
+        if (!selected) {
+            continue;
+        }
+
+        const std::string text         = make_text(corpus.size, corpus.spacing, corpus.seed);
+        std::size_t       placeholders = 0;
+        std::size_t       pos          = 0;
+        while (auto match = processor.scanner().next(text, pos)) {
+            ++placeholders;
+            pos = match->offset + match->length;
+        }
+
+        runner.run(fmt::format("extract_placeholders/{}", corpus.name), text.size(), placeholders,
+                   [&] { keep(processor.extractPlaceholders(text)); });
+        runner.run(fmt::format("replace_placeholders/{}", corpus.name), text.size(), placeholders,
+                   [&] { keep(processor.replacePlaceholders(text, values)); });
+
+        // Compiled once, rendered per project: the shape used by the generator and batch mode
+        auto compiled = processor.compile(text);
+        runner.run(fmt::format("compiled_render/{}", corpus.name), text.size(), placeholders, [&] { keep(compiled.render(values)); });
+
+        // Values bound to symbol ids once per project, every placeholder is then an index instead of a hash lookup
+        SymbolValues bound = processor.symbols()->bind(values);
+        runner.run(fmt::format("bound_render/{}", corpus.name), text.size(), placeholders, [&] { keep(compiled.render(bound)); });
+
+        // The same into an arena reused from run to run, the steady state of a long-running service
+        std::string arena;
+        runner.run(fmt::format("arena_render/{}", corpus.name), text.size(), placeholders, [&] { keep(compiled.render(bound, arena)); });
+
+        // The same text inside a one-item loop, rendered through the jumps of the block directives
+        auto loop_values     = values;
+        loop_values["ITEMS"] = "item";
+        auto looped          = processor.compile("@each ITEM in ITEMS@" + text + "@endeach@");
+        runner.run(fmt::format("directive_render/{}", corpus.name), text.size(), placeholders,
+                   [&] { keep(looped.render(loop_values)); });
+
+        runner.run(fmt::format("stream_render/{}", corpus.name), text.size(), placeholders, [&] {
+            std::size_t       written = 0;
+            StreamingRenderer renderer(processor, values, [&written](std::string_view piece) { written += piece.size(); });
+            for (std::size_t pos = 0; pos < text.size(); pos += StreamingRenderer::default_chunk_size) {
+                renderer.write(std::string_view(text).substr(pos, StreamingRenderer::default_chunk_size));
+            }
+            renderer.finish();
+            keep(written);
+        });
+    }
+
+    // A project's worth of small, dense files: per-file lookups of the value map dominate rendering
+    if (runner.selected("render_files/map") || runner.selected("render_files/bound") || runner.selected("render_files/arena")) {
+        std::vector<CompiledTemplate> files;
+        std::size_t                   bytes = 0;
+        for (std::uint32_t i = 0; i < scaled(2000, scale); ++i) {
+            files.push_back(processor.compile(make_text(512, 32, 100 + i)));
+            bytes += files.back().source().size();
+        }
+        runner.run("render_files/map", bytes, files.size(), [&] {
+            for (const auto &file : files) {
+                keep(file.render(values));
+            }
+        });
+        runner.run("render_files/bound", bytes, files.size(), [&] {
+            SymbolValues bound = processor.symbols()->bind(values);
+            for (const auto &file : files) {
+                keep(file.render(bound));
+            }
+        });
+        std::string arena;
+        runner.run("render_files/arena", bytes, files.size(), [&] {
+            SymbolValues bound = processor.symbols()->bind(values);
+            for (const auto &file : files) {
+                keep(file.render(bound, arena));
+            }
+        });
+    }
+}
+
+void scan_benchmarks(Runner &runner, double scale) {
+    if (!runner.selected("scan_template_directory")) {
+        return;
+    }
+    TempDir     base("scan");
+    std::size_t deep = make_deep_tree(base.path() / "deep", scaled(64, scale), 16);
+    std::size_t wide = make_wide_tree(base.path() / "wide", scaled(400, scale), 50);
+    ThreadPool  pool;
+
+    for (auto [name, entries] : {std::pair{"deep", deep}, std::pair{"wide", wide}}) {
+        runner.run(fmt::format("scan_template_directory/{}", name), 0, entries,
+                   [&] { keep(scan_template_directory(name, base.path().string())); });
+        runner.run(fmt::format("scan_template_directory/{}_flat", name), 0, entries,
+                   [&] { keep(scan_template_directory(name, base.path().string(), flat_tree)); });
+        runner.run(fmt::format("scan_template_directory/{}_parallel", name), 0, entries,
+                   [&] { keep(scan_template_directory(name, base.path().string(), flat_tree, pool)); });
+    }
+}
+
+void generate_benchmarks(Runner &runner, double scale, const std::string &cgen_executable) {
+    if (!runner.selected("generate")) {
+        return;
+    }
+    TempDir     base("generate");
+    fs::path    templates = base.path() / "templates";
+    fs::path    output    = base.path() / "out";
+    std::size_t bytes     = make_project_template(templates / "project", scale);
+    auto        clear     = [&output] { fs::remove_all(output); };
+
+    PlaceholderProcessor     processor;
+    std::vector<std::size_t> job_counts = {1};
+    if (std::thread::hardware_concurrency() > 1) {
+        job_counts.push_back(std::thread::hardware_concurrency());
+    }
+    for (std::size_t jobs : job_counts) {
+        GenerateOptions options;
+        options.jobs = jobs;
+        runner.run(
+            fmt::format("generate/in_process_jobs_{}", jobs), bytes, 0,
+            [&] {
+                SilenceStdout silence;
+                auto          tree = load_template_tree("project", templates.string(), options);
+                auto          path = ensure_output_directory(output);
+                keep(tree && path && generate_project(tree.value(), path.value(), processor, corpus_values(), options));
+            },
+            clear);
+    }
+
+    // The real `cgen --generate` process, including startup, template validation and output
+    if (!cgen_executable.empty() && fs::exists(cgen_executable)) {
+#if defined(_WIN32)
+        const char *null_device = "NUL";
+#else
+        const char *null_device = "/dev/null";
+#endif
+        std::string command = fmt::format("\"{}\" --templates \"{}\" --output \"{}\" --generate project > {}", cgen_executable,
+                                          templates.string(), output.string(), null_device);
+        runner.run("generate/cli", bytes, 0, [&] { keep(std::system(command.c_str())); }, clear);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    cxxopts::Options options("cgen_bench", "Benchmarks for the cgen scanner, placeholder engine and generator");
+    // clang-format off
+    options.add_options()
+        ("h,help", "Print help")
+        ("f,filter", "Only run benchmarks whose name contains this text", cxxopts::value<std::string>()->default_value(""))
+        ("min-time", "Seconds spent timing each benchmark", cxxopts::value<double>()->default_value("0.5"))
+        ("scale", "Multiplier for the size of the synthetic corpora", cxxopts::value<double>()->default_value("1.0"))
+        ("o,output", "Write the JSON results to this file instead of stdout", cxxopts::value<std::string>()->default_value("-"))
+        ("cgen", "cgen executable for the end-to-end --generate benchmark", cxxopts::value<std::string>()->default_value(CGEN_EXECUTABLE));
+    // clang-format on
+
+    cxxopts::ParseResult result;
+    try {
+        result = options.parse(argc, argv);
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "Error: {}\n", e.what());
+        return 1;
+    }
+    if (result.count("help")) {
+        fmt::print("{}\n", options.help());
+        return 0;
+    }
+
+    BenchOptions bench_options;
+    bench_options.filter   = result["filter"].as<std::string>();
+    bench_options.min_time = result["min-time"].as<double>();
+    double scale           = result["scale"].as<double>();
+
+    Runner runner(bench_options);
+    try {
+        placeholder_benchmarks(runner, scale);
+        scan_benchmarks(runner, scale);
+        generate_benchmarks(runner, scale, result["cgen"].as<std::string>());
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "Error running benchmarks: {}\n", e.what());
+        return 1;
+    }
+
+    std::string json        = runner.toJson();
+    std::string output_path = result["output"].as<std::string>();
+    if (output_path == "-") {
+        fmt::print("{}", json);
+    } else {
+        std::ofstream out(output_path);
+        if (!(out << json)) {
+            fmt::print(stderr, "Error: Could not write {}\n", output_path);
+            return 1;
+        }
+        fmt::print(stderr, "Results written to {}\n", output_path);
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "cgen/generator.h"
+
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cgen {
+namespace fs = std::filesystem;
+
+// One project to generate in a batch run
+struct BatchProject {
+    std::string                                  template_name; // Template directory name under the templates base dir
+    fs::path                                     output_dir;    // Output directory of the project
+    std::unordered_map<std::string, std::string> values;        // Placeholder values for this project
+    std::vector<std::string>                     overlays = {}; // Layers composed before GenerateOptions::overlays
+};
+
+struct BatchManifest {
+    fs::path                  templates_dir; // Empty if the manifest does not name one
+    std::vector<BatchProject> projects;
+};
+
+/**
+ * Loads a batch manifest describing many projects to generate in a single run.
+ *
+ * The manifest is a TOML file:
+ *
+ * @code{.toml}
+ * templates = "templates/"          # Optional templates base directory
+ *
+ * [values]                          # Optional values shared by every project
+ * AUTHOR_NAME = "Platform Team"
+ *
+ * [[project]]
+ * template = "library_default"
+ * output = "services/alpha"
+ * [project.values]                  # Overrides the shared values
+ * PROJECT_NAME = "alpha"
+ * @endcode
+ *
+ * Relative `templates` and `output` paths are resolved against the directory of the manifest.
+ * Integer, floating point and boolean values are converted to their TOML spelling, arrays are
+ * joined into a `;`-separated CMake list.
+ *
+ * @param manifest_path Path of the manifest file.
+ *
+ * @return The parsed manifest, or `generate_status::error` if the file cannot be parsed or a
+ *         project is missing its `template` or `output` key.
+ */
+std::expected<BatchManifest, generate_status> load_batch_manifest(const fs::path &manifest_path);
+
+/**
+ * Loads a project configuration, the file passed to `cgen -i`, as one project to generate.
+ *
+ * The documented keys are mapped to the placeholder values the templates use:
+ *
+ * - `[project]`: `name` (required), `version` ("0.1.0"), `description`, `namespace` (the name),
+ *   `vendor` and `contact` become `PROJECT_NAME`, `PROJECT_VERSION` and its `_MAJOR`, `_MINOR`
+ *   and `_PATCH` parts, `PROJECT_DESCRIPTION`, `PROJECT_NAMESPACE`, `PROJECT_VENDOR` and
+ *   `PROJECT_CONTACT`.
+ * - `[project.type] type`: `binary` (default) selects the `binary_default` template, `library` and
+ *   `header_only` select `library_default`. Also sets `PROJECT_TYPE`, `PROJECT_KIND` (the xmake
+ *   target kind), `SOURCE_FILES` and `MODULE_FILES`.
+ * - `[dependencies]`: `DEPENDENCIES`, `REQUIRED_DEPENDENCIES` and `FIND_DEPENDENCIES`, one
+ *   `find_dependency` line per required dependency.
+ * - `[package_managers]`: `PACKAGE_MANAGERS`, and `USE_CPM`, `USE_CONAN`, `USE_VCPKG` and
+ *   `USE_XREPO` as the CMake lines that set each one up, or empty. A package manager with a layer
+ *   in `_package_managers` also adds it to the project's overlays.
+ * - `[build]`: `cpp_standard` ("23") becomes `CPP_STANDARD`, `enable_testing` and `use_modules`
+ *   become `ENABLE_TESTING` and `USE_MODULES` (`ON` or `OFF`), and the `cmake_options` and
+ *   `cmake_defines` tables become the `CMAKE_OPTIONS` and `CMAKE_DEFINES` lines.
+ *
+ * Lists are `;`-separated in name order, for `@each@` blocks. Placeholders in an optional
+ * `[values]` table are set as they are, after the derived ones. Other keys are ignored.
+ *
+ * @param config_path Path of the configuration file.
+ * @param output_dir Output directory of the project.
+ *
+ * @return The project, or `generate_status::error` if the file cannot be parsed, has no project
+ *         name or names an unknown project type.
+ */
+std::expected<BatchProject, generate_status> load_project_config(const fs::path &config_path, const fs::path &output_dir);
+
+/**
+ * Generates every project of a batch manifest in one process.
+ *
+ * Each distinct template (with its overlays) is scanned and compiled once, the first time a project
+ * uses it, and the prepared template is shared by all projects generated from it. All work runs on a single
+ * work-stealing pool with `options.jobs` workers.
+ *
+ * @param manifest The projects to generate.
+ * @param templates_base_dir Templates base directory, used when the manifest does not name one.
+ * @param processor Placeholder processor used to compile the template files.
+ * @param options Generation options.
+ *
+ * @return Nothing if every project was generated, `generate_status::error` if any project failed.
+ *         A failing project does not stop the remaining ones. If two projects share an output
+ *         directory nothing is generated at all.
+ */
+std::expected<void, generate_status> generate_batch(const BatchManifest &manifest, const fs::path &templates_base_dir,
+                                                    const PlaceholderProcessor &processor, const GenerateOptions &options = {});
+
+} // namespace cgen
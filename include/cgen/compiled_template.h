@@ -0,0 +1,143 @@
+#pragma once
+
+#include "cgen/file_source.h"
+#include "cgen/symbol_table.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cgen {
+
+// Receives rendered output piece by piece, in order
+using RenderSink = std::function<void(std::string_view)>;
+
+// What a segment of a compiled template does when it is rendered
+enum class segment_op : std::uint8_t {
+    emit        = 0, // Literal text, or the value of a placeholder slot
+    jump_if     = 1, // Continue at `target` if the value of `slot` is true (an `if !` block)
+    jump_unless = 2, // Continue at `target` unless the value of `slot` is true (an `if` block)
+    jump        = 3, // Continue at `target`
+    each        = 4, // Start iterating over the items of the list in `slot`, the `next` segment follows
+    next        = 5, // Bind `slot` to the next item of the innermost list, or end the loop and continue at `target`
+};
+
+/**
+ * A template that has been parsed once into a flat list of literal spans and placeholder slots.
+ *
+ * Compiling a template (see `PlaceholderProcessor::compile`) pays the placeholder matching cost up
+ * front. Rendering afterwards is a single linear pass over the segment list into an output buffer
+ * that is sized exactly before any bytes are copied, so the same compiled template can be rendered
+ * for many value sets (e.g. many generated projects) without re-parsing the source.
+ *
+ * Templates may also contain block directives, written with the placeholder delimiters:
+ *
+ *     @if USE_VCPKG@ ... @else@ ... @endif@     (or `@if !USE_VCPKG@`)
+ *     @each DEP in DEPENDENCIES@ ... @DEP@ ... @endeach@
+ *
+ * A value is true unless it is unbound, empty, `0`, `false`, `off` or `no` (in any case). Lists are
+ * `;`-separated, like the arrays of a batch manifest and CMake lists, and a trailing `;` adds no
+ * empty item; inside the loop the variable is bound to each item in turn. A directive alone on its line removes the whole line. Directives
+ * are compiled into jumps between the segments, so rendering stays a single pass without looking
+ * at the source again. An `@else@` or end directive without its opening one is plain text, and
+ * blocks still open at the end of the template end there.
+ *
+ * Every slot also carries the id its name was interned as in the compiling processor's
+ * SymbolTable. Rendering with SymbolValues bound from that table looks each slot up by index;
+ * the overloads taking a value map hash each slot name once per render instead.
+ *
+ * With bound values a template can also be rendered without any heap allocation: `renderedSize`
+ * adds up the literal spans and value lengths, and `renderInto` writes into a buffer of that size,
+ * either one the caller provides or a std::string reused as an arena across renders.
+ */
+class CompiledTemplate {
+  public:
+    // Slot id used by segments that are literal text
+    static constexpr std::uint32_t literal = UINT32_MAX;
+
+    struct Segment {
+        std::size_t   offset;                    // Offset into source()
+        std::size_t   length;                    // Length in source(), including delimiters for placeholder segments
+        std::uint32_t slot;                      // Index into slots(), or `literal`
+        segment_op    op     = segment_op::emit; // What rendering does with the segment
+        std::uint32_t target = 0;                // For control segments, the index of the segment to continue at
+    };
+
+    CompiledTemplate() = default;
+
+    // The original template text that segments point into, possibly a read-only file mapping
+    std::string_view source() const { return source_.view(); }
+
+    // Literal spans and placeholder slots in source order, with the jumps of block directives in between
+    const std::vector<Segment> &segments() const { return segments_; }
+
+    // Distinct placeholder, condition, list and loop variable names in first-seen order, indexed by Segment::slot
+    const std::vector<std::string> &slots() const { return slots_; }
+
+    // The SymbolTable id of each slot's name, indexed like slots()
+    const std::vector<std::uint32_t> &symbols() const { return symbols_; }
+
+    bool hasPlaceholders() const { return !slots_.empty(); }
+
+    bool hasDirectives() const { return hasDirectives_; }
+
+    // True if render(values) would return source() unchanged, because there are no directives and no placeholder has a value
+    bool rendersVerbatim(const std::unordered_map<std::string, std::string> &values) const;
+    bool rendersVerbatim(const SymbolValues &values) const;
+
+    // Render the template, placeholders without a value are emitted verbatim
+    std::string render(const std::unordered_map<std::string, std::string> &values) const;
+    std::string render(const SymbolValues &values) const;
+
+    // Same, handing each literal span and value to `sink` instead of building the whole output
+    void render(const std::unordered_map<std::string, std::string> &values, const RenderSink &sink) const;
+    void render(const SymbolValues &values, const RenderSink &sink) const;
+
+    // Exact size of the rendered output, from the lengths of the literal spans and bound values
+    std::size_t renderedSize(const SymbolValues &values) const;
+
+    // Render into `out` without allocating. Returns the full output size; if that is larger than `out`, only a prefix was written
+    std::size_t renderInto(const SymbolValues &values, std::span<char> out) const;
+
+    // Render into `arena`, replacing its contents. Once it has grown to the largest output, rendering no longer allocates
+    std::string_view render(const SymbolValues &values, std::string &arena) const;
+
+  private:
+    friend class PlaceholderProcessor;
+
+    // Append a placeholder segment referring to slots_[slot]
+    void addPlaceholder(std::size_t offset, std::size_t length, std::uint32_t slot);
+
+    // Append a literal segment covering [offset, offset + length)
+    void addLiteral(std::size_t offset, std::size_t length);
+
+    // Append a control segment and return its index, a forward target is set by `patchTarget` once known
+    std::uint32_t addControl(segment_op op, std::uint32_t slot, std::uint32_t target = 0);
+
+    // Make the control segment at `index` jump to the segment appended next
+    void patchTarget(std::uint32_t index);
+
+    // Shared by both kinds of values, `lookup(slot)` returns the value of a slot or a null view if it has none
+    template <typename Lookup> bool rendersVerbatimWith(const Lookup &lookup) const;
+    template <typename Lookup> std::string renderWith(const Lookup &lookup) const;
+    template <typename Lookup, typename Sink> void emitWith(const Lookup &lookup, Sink &&sink) const;
+
+    // Render through the control segments, for templates with directives, and return the number of substituted placeholders
+    template <typename Lookup, typename Sink> std::size_t run(const Lookup &lookup, Sink &&sink) const;
+
+    // The value bound to each slot, a null view if it has none
+    std::vector<std::string_view> bindSlots(const std::unordered_map<std::string, std::string> &values) const;
+
+    FileSource                 source_;
+    std::vector<Segment>       segments_;
+    std::vector<std::string>   slots_;
+    std::vector<std::uint32_t> symbols_; // Symbol id of each slot
+    bool                       hasDirectives_ = false;
+};
+
+} // namespace cgen
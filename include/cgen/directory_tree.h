@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cgen {
+namespace fs = std::filesystem;
+
+/**
+ * A scanned template tree stored in a few contiguous arrays instead of a graph of heap nodes.
+ *
+ * Directories are kept in pre-order in one vector and link to each other by index: a node's
+ * subtree is the range `[i, subtree_end)`, its first child (if any) is `i + 1` and its next sibling
+ * is `subtree_end`. The files of each directory form one contiguous, name-sorted range of the file
+ * vector, and every directory and file name is a span of a single shared string pool. Walking the
+ * whole tree is therefore a linear scan over two arrays with no pointer chasing or reference
+ * counting, and a tree with tens of thousands of entries costs a handful of allocations.
+ *
+ * Node 0 is the template root. Its name is empty and its files are the files at the top level of
+ * the template, which `scan_template_directory` would otherwise put in a virtual "." directory.
+ *
+ * A tree composed from several template layers (see `compose_layers`) also records which layer
+ * each file comes from and which layers contain each directory. A scanned tree has one layer, its
+ * root, and stores nothing extra for it.
+ */
+class DirectoryTree {
+  public:
+    static constexpr std::uint32_t no_parent = UINT32_MAX;
+
+    // A span of the name pool
+    struct Name {
+        std::uint32_t offset = 0;
+        std::uint32_t length = 0;
+    };
+
+    struct Node {
+        Name          name;
+        std::uint32_t parent      = no_parent; // Index of the parent node, no_parent for the root
+        std::uint32_t subtree_end = 0;         // One past the last node of this subtree, i.e. the next sibling
+        std::uint32_t first_file  = 0;         // Index of its first file in files()
+        std::uint32_t file_count  = 0;         // Number of files directly in this directory
+    };
+
+    DirectoryTree() = default;
+    explicit DirectoryTree(fs::path root_path) : rootPath_(std::move(root_path)) {}
+
+    // Canonical path of the template directory
+    const fs::path &rootPath() const { return rootPath_; }
+
+    // Directories in pre-order, parents before children
+    const std::vector<Node> &nodes() const { return nodes_; }
+
+    // File names of all directories, grouped by directory in node order
+    const std::vector<Name> &files() const { return files_; }
+
+    std::string_view name(Name name) const { return std::string_view(names_).substr(name.offset, name.length); }
+
+    // Path of a node relative to the template root, empty for the root itself
+    fs::path relativePath(std::size_t node) const;
+
+    // Source directory of a layer: layer 0 is rootPath(), the others were added with addLayer
+    const fs::path &layerRoot(std::size_t layer) const { return layer == 0 ? rootPath_ : layers_[layer - 1]; }
+    std::size_t     layerCount() const { return layers_.size() + 1; }
+
+    // Layer a file is read from
+    std::uint32_t fileLayer(std::size_t file) const { return layers_.empty() ? 0 : fileLayers_[file]; }
+
+    // Layers that contain a directory, one bit per layer
+    std::uint32_t nodeLayers(std::size_t node) const { return layers_.empty() ? 1 : nodeLayers_[node]; }
+
+    // Add a source directory and return its layer index; at most `max_layers` layers are supported
+    static constexpr std::size_t max_layers = 32;
+    std::uint32_t                addLayer(fs::path root);
+
+    /**
+     * Pre-order builder interface used by the scanners.
+     *
+     * `openDirectory` starts a child of the directory opened last (or the root), `addFile` appends
+     * a file to the directory opened last and `closeDirectory` finishes it. All files of a directory
+     * must be added before its first subdirectory is opened, siblings must be added in name order.
+     * The layer arguments are only needed for composed trees.
+     */
+    std::size_t openDirectory(std::string_view name, std::uint32_t layers = 1);
+    void        addFile(std::string_view name, std::uint32_t layer = 0);
+    void        closeDirectory();
+
+  private:
+    Name intern(std::string_view name);
+
+    fs::path                   rootPath_;
+    std::vector<Node>          nodes_;
+    std::vector<Name>          files_;
+    std::string                names_;
+    std::vector<std::uint32_t> open_;       // Nodes opened but not closed yet
+    std::vector<fs::path>      layers_;     // Roots of the layers after the first
+    std::vector<std::uint32_t> fileLayers_; // Per file, empty in a tree with a single layer
+    std::vector<std::uint32_t> nodeLayers_; // Per node, empty in a tree with a single layer
+};
+
+} // namespace cgen
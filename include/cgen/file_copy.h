@@ -0,0 +1,38 @@
+#pragma once
+
+#include <expected>
+#include <filesystem>
+#include <system_error>
+
+namespace cgen {
+namespace fs = std::filesystem;
+
+// How copy_file_contents moved the bytes, from cheapest to most expensive
+enum class copy_method : int {
+    reflink         = 0, // FICLONE, the destination shares the source's extents
+    copy_file_range = 1, // In-kernel copy, may be offloaded by the filesystem
+    sendfile        = 2, // In-kernel copy through the page cache
+    buffered        = 3, // read/write through a user-space buffer
+};
+
+/**
+ * Copies the contents of a file without passing its bytes through user space when possible.
+ *
+ * On Linux the destination is created or truncated and then filled with the cheapest primitive
+ * the filesystems accept: a reflink (`FICLONE`), `copy_file_range`, `sendfile` and finally a
+ * plain read/write loop. Each step falls back to the next only when the kernel reports it as
+ * unsupported for this pair of files. Other platforms use `fs::copy_file`.
+ *
+ * The destination gets default permissions, exactly like a file written with `std::ofstream`;
+ * the source's mode is not copied.
+ *
+ * @param from File to copy.
+ * @param to Destination path, overwritten if it exists.
+ *
+ * @return The method that performed the copy, or the error reported by the operating system,
+ *         including a failure to close the destination. `std::errc::file_exists` if `to` is
+ *         `from` itself, e.g. through a hard or symbolic link, which is left untouched.
+ */
+std::expected<copy_method, std::error_code> copy_file_contents(const fs::path &from, const fs::path &to);
+
+} // namespace cgen
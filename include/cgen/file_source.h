@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace cgen {
+namespace fs = std::filesystem;
+
+/**
+ * Read-only contents of a template file, memory-mapped when that is worthwhile.
+ *
+ * Regular files of at least `mmap_threshold` bytes are mapped with `mmap(PROT_READ, MAP_PRIVATE)`,
+ * so their bytes are paged in straight from the page cache and never copied into the process
+ * before rendering. Smaller files, files on filesystems that cannot be mapped (procfs, some FUSE
+ * and network mounts) and platforms without `mmap` fall back to a single buffered read into an
+ * owned string. Either way `view()` exposes the contents as one contiguous `std::string_view`.
+ *
+ * A mapping reflects the file as it was opened; template files are not expected to be rewritten
+ * while a generation is running. Contents kept for longer than one run (see `TemplateCache`) are
+ * loaded with `read` instead, since touching a mapping of a file that was truncated since raises
+ * SIGBUS.
+ */
+class FileSource {
+  public:
+    // Files smaller than this are read into a buffer, mapping them costs more than the copy
+    static constexpr std::size_t mmap_threshold = 16 * 1024;
+
+    FileSource() = default;
+    FileSource(FileSource &&other) noexcept;
+    FileSource &operator=(FileSource &&other) noexcept;
+    FileSource(const FileSource &)            = delete;
+    FileSource &operator=(const FileSource &) = delete;
+    ~FileSource();
+
+    /**
+     * Opens a file, mapping it if it is large enough and the filesystem supports it.
+     *
+     * @param path Path of the file to read.
+     *
+     * @return The file contents, or the error reported by the operating system.
+     */
+    static std::expected<FileSource, std::error_code> open(const fs::path &path);
+
+    // Same as `open`, but always reads the file into an owned buffer, whatever its size
+    static std::expected<FileSource, std::error_code> read(const fs::path &path);
+
+    // Wraps text that is already in memory
+    static FileSource fromString(std::string content);
+
+    std::string_view view() const { return mapped_ ? std::string_view(static_cast<const char *>(mapped_), mappedSize_) : buffer_; }
+    std::size_t      size() const { return view().size(); }
+    bool             isMapped() const { return mapped_ != nullptr; }
+
+  private:
+    static std::expected<FileSource, std::error_code> load(const fs::path &path, bool allow_mapping);
+
+    void release() noexcept;
+
+    void       *mapped_     = nullptr;
+    std::size_t mappedSize_ = 0;
+    std::string buffer_; // Used when the file is not mapped
+};
+
+} // namespace cgen
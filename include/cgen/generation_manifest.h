@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace cgen {
+namespace fs = std::filesystem;
+
+/**
+ * Streaming 64-bit content hash (XXH64 with seed 0).
+ *
+ * Feeding the same bytes in any split produces the same digest, so rendered output can be hashed
+ * piece by piece as it is produced.
+ */
+class ContentHasher {
+  public:
+    ContentHasher();
+
+    void update(std::string_view data);
+
+    std::uint64_t digest() const;
+
+  private:
+    void consumeStripe(const char *stripe);
+
+    std::array<std::uint64_t, 4> lanes_;
+    std::uint64_t                total_ = 0;
+    std::array<char, 32>         buffer_{};
+    std::size_t                  buffered_ = 0;
+};
+
+// Hash of a complete piece of data
+std::uint64_t hash_content(std::string_view data);
+
+// Hash of a file's contents
+std::expected<std::uint64_t, std::error_code> hash_file(const fs::path &path);
+
+// Size and modification time of a generated file, compared before hashing it
+struct OutputStamp {
+    std::uint64_t size     = 0;
+    std::int64_t  mtime_ns = 0;
+
+    bool operator==(const OutputStamp &) const = default;
+};
+
+// Stamp of an existing regular file, empty if it does not exist or cannot be stat'ed
+std::optional<OutputStamp> output_stamp(const fs::path &path);
+
+// What a generated file was produced from, and what was produced
+struct ManifestEntry {
+    std::uint64_t template_hash = 0; // Contents of the template file
+    std::uint64_t values_hash   = 0; // Names and values of the placeholders the template uses
+    std::uint64_t output_hash   = 0; // Contents of the generated file
+    OutputStamp   stamp;             // The generated file as it was left on disk
+};
+
+/**
+ * Record of the last generation into an output directory, stored in `<output>/.cgen-manifest`.
+ *
+ * For every generated file the manifest keeps the hash of its template, of the placeholder values
+ * it used and of the output that was written. A later generation with the same template and
+ * values can then skip the file without rendering it, as long as the file on disk still has the
+ * recorded stamp or hash; files whose output would be byte-identical are not rewritten either.
+ * Untouched outputs keep their mtime, so build systems downstream do not see spurious changes.
+ *
+ * A missing, unreadable or outdated manifest is treated as empty: every file is then generated
+ * and compared as if for the first time.
+ */
+class GenerationManifest {
+  public:
+    // Location of the manifest for an output directory
+    static fs::path manifestPath(const fs::path &output_dir);
+
+    // Loads the manifest of an output directory, empty if it has none
+    static GenerationManifest load(const fs::path &output_dir);
+
+    /**
+     * Writes the manifest into an output directory, atomically via rename.
+     *
+     * @return Nothing on success, or the error that prevented writing the file.
+     */
+    std::expected<void, std::error_code> save(const fs::path &output_dir) const;
+
+    // Entry of a generated file, given its path relative to the output directory
+    const ManifestEntry *find(const fs::path &relative) const;
+
+    void record(const fs::path &relative, const ManifestEntry &entry);
+
+    void forget(const fs::path &relative);
+
+    // Drops every entry, e.g. before recording the files of a new generation
+    void clear() { entries_.clear(); }
+
+    std::size_t size() const { return entries_.size(); }
+
+  private:
+    std::map<std::string, ManifestEntry> entries_; // Keyed by generic relative path
+};
+
+} // namespace cgen
@@ -0,0 +1,216 @@
+#pragma once
+
+#include "cgen/compiled_template.h"
+#include "cgen/generation_manifest.h"
+#include "cgen/io_ring.h"
+#include "cgen/placeholder_processor.h"
+#include "cgen/scanner.h"
+#include "cgen/thread_pool.h"
+
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cgen {
+namespace fs = std::filesystem;
+
+enum class generate_status : int {
+    success = 0,
+    error   = 1,
+};
+
+struct GenerateOptions {
+    std::size_t              jobs         = 0;     // Worker threads for file rendering, 0 selects the hardware concurrency
+    bool                     use_index    = false; // Scan templates through the persistent `.cgen-index` (see TemplateIndex)
+    bool                     incremental  = false; // Skip outputs that are up to date in `.cgen-manifest` (see GenerationManifest)
+    bool                     staging      = false; // Build the project beside the output, then move it into place (see generate_staged)
+    io_backend               io           = io_backend::blocking; // How template files are read and outputs written (see IoRing)
+    std::vector<std::string> overlays;             // Shared layers composed below the template, highest precedence first
+    bool                     common_layer = true;  // Also compose `_common` below the template, if the templates directory has one
+};
+
+// An output directory of a prepared template, with the files placed directly inside it
+struct PreparedDirectory {
+    static constexpr std::size_t no_parent = static_cast<std::size_t>(-1);
+
+    fs::path                        relative;   // Relative to the project root, empty for the root itself
+    std::size_t                     parent;     // Index in PreparedTemplate::directories, or no_parent at the top level
+    std::size_t                     first_file; // Index of its first file in PreparedTemplate::files
+    std::size_t                     file_count; // Number of files directly in this directory
+    std::optional<CompiledTemplate> name;       // Set if the directory name contains placeholders
+};
+
+// A template file read and compiled once, ready to be rendered into any number of projects
+struct PreparedFile {
+    fs::path                        source;   // Canonical path of the template file
+    fs::path                        relative; // Output path relative to the project root
+    std::optional<CompiledTemplate> content;  // Empty if the template file could not be read
+    std::optional<CompiledTemplate> name;     // Set if the file name contains placeholders
+};
+
+/**
+ * A scanned template with every file compiled, shared by all projects generated from it.
+ *
+ * The directories and files also form the output path plan. Every entry's path relative to the
+ * project root is resolved once, when the template is prepared. Names containing placeholders
+ * (e.g. `cmake/@PROJECT_NAME@-config.cmake.in`) are compiled at the same time; for those the
+ * `relative` path still spells the placeholders, and each project renders only these names
+ * and joins them to the already resolved path of their parent.
+ */
+struct PreparedTemplate {
+    std::vector<PreparedDirectory>     directories;             // Pre-order, parents before children
+    std::vector<PreparedFile>          files;                   // Grouped by directory, in tree order
+    bool                               templated_names = false; // True if any directory or file name contains placeholders
+    bool                               resident        = false; // Sources are owned copies, see `prepare_template`
+    std::shared_ptr<const SymbolTable> symbols         = std::make_shared<SymbolTable>(); // Interned names of every file and name
+};
+
+/**
+ * Scans a template directory, either directly or through the persistent template index.
+ *
+ * With `options.use_index` set the tree comes from `TemplateIndex::open`, which only re-lists
+ * directories that changed since the last run; otherwise `scan_template_directory` lists the whole
+ * template, one directory per task on `pool`, or on a temporary pool of `options.jobs` workers if
+ * none is given. Both produce the same tree.
+ *
+ * The layers in `options.overlays` (directories under `templates_base_dir`, e.g.
+ * `_package_managers/vcpkg`) and then `_common` are scanned the same way and composed below the
+ * template with `compose_layers`, so files of the template take precedence over every overlay.
+ * A missing overlay is an error, a missing `_common` is not.
+ */
+std::expected<DirectoryTree, scan_status> load_template_tree(const std::string &template_name, const std::string &templates_base_dir,
+                                                             const GenerateOptions &options, ThreadPool *pool = nullptr);
+
+/**
+ * Reads and compiles every file of a scanned template.
+ *
+ * Files are read and compiled as independent tasks on `pool`. The result does not depend on any
+ * placeholder values, so one prepared template can be rendered into any number of projects.
+ *
+ * @param top_level_entries The result of `scan_template_directory`.
+ * @param processor Placeholder processor used to compile each template file.
+ * @param pool Worker pool the files are compiled on.
+ * @param io With `io_backend::io_uring` the files are read in batches through an IoRing on the
+ *        calling thread, while the pool compiles the previous batch.
+ * @param resident For a template kept in memory beyond one generation (see `TemplateCache`): every
+ *        file is read into an owned buffer instead of being mapped, and files without substitutions
+ *        are written from that buffer instead of being copied from the template file, so neither a
+ *        template file truncated in place nor one edited since can reach the output.
+ *
+ * @return The prepared template, or `generate_status::error` if the worker pool failed.
+ *
+ * @note Files that cannot be read are reported once here and skipped by every later generation.
+ */
+std::expected<PreparedTemplate, generate_status>
+prepare_template(const std::set<std::shared_ptr<Directory>, CompareDirectoryByName<Directory>> &top_level_entries,
+                 const PlaceholderProcessor &processor, ThreadPool &pool, io_backend io = io_backend::blocking, bool resident = false);
+
+// Same as above for a flat tree, planned in a single pass over its nodes
+std::expected<PreparedTemplate, generate_status> prepare_template(const DirectoryTree &tree, const PlaceholderProcessor &processor,
+                                                                  ThreadPool &pool, io_backend io = io_backend::blocking,
+                                                                  bool resident = false);
+
+/**
+ * Reads and compiles the given files of a prepared template again, after their sources changed.
+ * The template's structure is kept as it is; files that can no longer be read are reported and
+ * skipped by later generations.
+ *
+ * @param files Indices into `prepared.files`.
+ * @param processor The processor that prepared the template, so the files keep using its SymbolTable.
+ */
+std::expected<void, generate_status> recompile_files(PreparedTemplate &prepared, const std::vector<std::size_t> &files,
+                                                     const PlaceholderProcessor &processor, ThreadPool &pool);
+
+/**
+ * Generates a project from a prepared template into an output directory.
+ *
+ * Generation runs in two phases. First the output path of every templated name is rendered and
+ * every output directory is created in tree order, so no file write can race with the creation of
+ * its parent. Then each file is rendered and written as an independent task on the work-stealing
+ * `pool`.
+ *
+ * Progress and error messages are buffered per directory and per file and printed in tree order
+ * once all tasks have finished, so the output is identical regardless of the number of workers or
+ * the order in which tasks complete.
+ *
+ * @param prepared The result of `prepare_template`.
+ * @param output_base_path Directory the project is generated into, it must already exist.
+ * @param values Placeholder values substituted into every file.
+ * @param pool Worker pool the files are rendered on.
+ * @param manifest If given, files whose template, values and output match their manifest entry
+ *        are skipped, outputs that would be byte-identical are not rewritten, and the manifest is
+ *        updated to describe exactly the files of this generation.
+ * @param report_files If false, only errors are printed, not a line per directory and file.
+ * @param io With `io_backend::io_uring`, files are rendered into memory on the pool in batches,
+ *        and each batch is written through an IoRing on the calling thread while the pool renders
+ *        the next one. Every file is then written: a `manifest` only receives the entries of the
+ *        written files, nothing is skipped or compared against previous outputs, as when
+ *        generating into a fresh directory.
+ *
+ * @return Nothing on success, `generate_status::error` if the worker pool failed.
+ *
+ * @note Individual files that cannot be written are reported and skipped, as are the contents of
+ *       output directories that cannot be created. So are entries whose name the values turn into
+ *       something other than a single path component (empty, `.`, `..` or containing a
+ *       separator), and files whose output path another file already claimed.
+ */
+std::expected<void, generate_status> generate_project(const PreparedTemplate &prepared, const fs::path &output_base_path,
+                                                      const std::unordered_map<std::string, std::string> &values, ThreadPool &pool,
+                                                      GenerationManifest *manifest = nullptr, bool report_files = true,
+                                                      io_backend io = io_backend::blocking);
+
+/**
+ * Generates only the given files of a prepared template, e.g. after `recompile_files`.
+ *
+ * Output directories and paths are resolved exactly as by `generate_project`, and missing
+ * directories are created, but only the listed files are rendered and written. With a
+ * `manifest`, only the entries of these files are updated; all other entries are kept.
+ *
+ * @param files Indices into `prepared.files`.
+ */
+std::expected<void, generate_status> regenerate_files(const PreparedTemplate &prepared, const std::vector<std::size_t> &files,
+                                                      const fs::path &output_base_path,
+                                                      const std::unordered_map<std::string, std::string> &values, ThreadPool &pool,
+                                                      GenerationManifest *manifest = nullptr);
+
+/**
+ * Generates a project incrementally: loads the manifest of the output directory, generates with
+ * it and writes it back. Failing to write the manifest is reported but is not an error.
+ */
+std::expected<void, generate_status> generate_incremental(const PreparedTemplate &prepared, const fs::path &output_base_path,
+                                                          const std::unordered_map<std::string, std::string> &values, ThreadPool &pool);
+
+/**
+ * Convenience overload that prepares the scanned template and generates a single project from it
+ * on a pool with `options.jobs` workers, through a staging directory if `options.staging` is set
+ * and otherwise incrementally if `options.incremental` is set.
+ */
+std::expected<void, generate_status>
+generate_project(const std::set<std::shared_ptr<Directory>, CompareDirectoryByName<Directory>> &top_level_entries,
+                 const fs::path &output_base_path, const PlaceholderProcessor &processor,
+                 const std::unordered_map<std::string, std::string> &values, const GenerateOptions &options = {});
+
+std::expected<void, generate_status> generate_project(const DirectoryTree &tree, const fs::path &output_base_path,
+                                                      const PlaceholderProcessor &processor,
+                                                      const std::unordered_map<std::string, std::string> &values,
+                                                      const GenerateOptions &options = {});
+
+// Whether a rendered name is one path component: not empty, `.` or `..`, and without a separator, NUL or root
+bool is_single_path_component(std::string_view name);
+
+/**
+ * Makes sure an output directory exists, creating it if necessary.
+ *
+ * @return The absolute output path, or `generate_status::error` if the path exists but is not a
+ *         directory or could not be created.
+ */
+std::expected<fs::path, generate_status> ensure_output_directory(const fs::path &output_dir);
+
+} // namespace cgen
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace cgen {
+namespace fs = std::filesystem;
+
+// How template files are read and output files written
+enum class io_backend : int {
+    blocking = 0, // One open/read/write/close system call after another, on the worker threads
+    io_uring = 1, // Batched through an IoRing, falling back to `blocking` where io_uring is unavailable
+};
+
+/**
+ * A Linux io_uring instance that reads and writes whole batches of files.
+ *
+ * Every step of a batch (opening, reading or writing, closing) is queued for all of its files
+ * and handed to the kernel with a single `io_uring_enter`, so a batch of N files costs a handful
+ * of system calls instead of 3N or more. This matters most where each system call has a high
+ * latency, such as network filesystems and overlayfs in containers.
+ *
+ * The ring is driven through the raw system calls, no liburing is needed. `create` fails on other
+ * platforms, on kernels without io_uring or without the required operations (Linux 5.6+), and
+ * where io_uring is disabled, e.g. by a seccomp filter; callers then fall back to blocking I/O.
+ *
+ * An IoRing is not thread-safe, it is meant to be driven by a single coordinating thread.
+ */
+class IoRing {
+  public:
+    static constexpr unsigned default_entries = 256;
+
+    /**
+     * Sets up a ring.
+     *
+     * @param entries Submission queue size, which is also the largest batch handed to the kernel at once.
+     *
+     * @return The ring, or the error explaining why io_uring cannot be used.
+     */
+    static std::expected<IoRing, std::error_code> create(unsigned entries = default_entries);
+
+    IoRing(IoRing &&other) noexcept;
+    IoRing &operator=(IoRing &&other) noexcept;
+    IoRing(const IoRing &)            = delete;
+    IoRing &operator=(const IoRing &) = delete;
+    ~IoRing();
+
+    // Number of files whose reads or writes are queued at once
+    std::size_t batchSize() const;
+
+    /**
+     * Reads files completely.
+     *
+     * @return For each path, its contents or the error reported by the kernel.
+     */
+    std::vector<std::expected<std::string, std::error_code>> readFiles(std::span<const fs::path> paths);
+
+    /**
+     * Creates or truncates files and writes the given contents into them, with default permissions
+     * like `std::ofstream`.
+     *
+     * @return For each path, an empty error code or the error reported by the kernel.
+     */
+    std::vector<std::error_code> writeFiles(std::span<const fs::path> paths, std::span<const std::string_view> contents);
+
+  private:
+    struct Ring;
+    explicit IoRing(std::unique_ptr<Ring> ring);
+
+    std::unique_ptr<Ring> ring_;
+};
+
+} // namespace cgen
@@ -1,9 +1,14 @@
 #pragma once
 
+#include "cgen/compiled_template.h"
+#include "cgen/placeholder_scanner.h"
+#include "cgen/symbol_table.h"
+
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
-#include <regex>
 
 namespace cgen {
 
@@ -23,28 +28,38 @@ public:
     explicit PlaceholderProcessor(std::initializer_list<PlaceholderStyle> styles = {PlaceholderStyle::AtSign});
     
     // Extract all placeholders from a template
-    std::vector<std::string> extractPlaceholders(const std::string& content) const;
+    std::vector<std::string> extractPlaceholders(std::string_view content) const;
     
-    // Replace placeholders in content with values
+    // Replace placeholders in content with values, compiling it on every call (see compile() to render repeatedly).
+    // Block directives are left as text unless `directives` is set, as the streaming renderer does.
     std::string replacePlaceholders(
         const std::string& content,
-        const std::unordered_map<std::string, std::string>& values
+        const std::unordered_map<std::string, std::string>& values,
+        bool directives = false
     ) const;
 
+    // Parse content once into literal spans, placeholder slots and block directives for repeated rendering
+    CompiledTemplate compile(std::string content, bool directives = true) const;
+
+    // Same, taking ownership of a (possibly memory-mapped) file without copying it
+    CompiledTemplate compile(FileSource source, bool directives = true) const;
+
+    // The scanner matching placeholders of all active styles
+    const PlaceholderScanner& scanner() const { return scanner_; }
+
+    // The table placeholder names are interned into by compile(), shared by copies of this processor
+    std::shared_ptr<const SymbolTable> symbols() const { return symbols_; }
+
 private:
     std::vector<PlaceholderStyle> allStyles_;
-    
-    // Build regex for a specific style
-    std::regex buildRegexForStyle(PlaceholderStyle style) const;
+    PlaceholderScanner scanner_; // Matches placeholders of all active styles
+    std::shared_ptr<SymbolTable> symbols_ = std::make_shared<SymbolTable>();
     
     // Get the prefix and suffix for a style
     std::pair<std::string, std::string> getStyleDelimiters(PlaceholderStyle style) const;
     
-    // Build a combined regex for all active styles
-    std::regex buildCombinedRegex() const;
-    
-    // Extract placeholder name from a matched string based on style
-    std::string extractPlaceholderName(const std::string& match) const;
+    // Build the delimiter set the scanner searches for
+    std::string buildDelimiters() const;
 };
 
-} // namespace cgen
\ No newline at end of file
+} // namespace cgen
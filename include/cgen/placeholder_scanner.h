@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace cgen {
+
+// A placeholder token located in a piece of text
+struct PlaceholderMatch {
+    std::size_t offset;            // Offset of the opening delimiter
+    std::size_t length;            // Length of the token, including both delimiters
+    bool        directive = false; // A block directive found by `nextToken` rather than a placeholder
+
+    // The placeholder name (or directive body) between the delimiters
+    std::string_view name(std::string_view text) const { return text.substr(offset + 1, length - 2); }
+};
+
+/**
+ * Hand-written replacement for the `<d>([A-Z0-9_]+)<d>` regex alternation used for placeholders.
+ *
+ * Delimiter bytes are located with a vectorized byte search (AVX2 when the CPU supports it, SSE2
+ * otherwise on x86-64, and a scalar fallback everywhere else); the placeholder body is validated
+ * inline with a lookup table. Matches are reported leftmost-first and never overlap, which is
+ * exactly the sequence `std::sregex_iterator` produced for the combined regex.
+ */
+class PlaceholderScanner {
+  public:
+    static constexpr std::size_t max_delimiters = 4;
+
+    // One byte per active style, a placeholder is `<d>[A-Z0-9_]+<d>` for any of them
+    explicit PlaceholderScanner(std::string_view delimiters);
+
+    // Position of the next delimiter byte at or after `from`, or npos
+    std::size_t findDelimiter(std::string_view text, std::size_t from) const;
+
+    // The next placeholder starting at or after `from`
+    std::optional<PlaceholderMatch> next(std::string_view text, std::size_t from) const;
+
+    /**
+     * Same, but also reports directive candidates in the same pass.
+     *
+     * A directive is `<d>keyword<d>` or `<d>keyword arguments<d>`: a lowercase keyword, then
+     * arguments made of letters, digits, `_`, `!` and spaces, at most `max_directive_length` bytes
+     * between the delimiters. Whether the keyword means anything is up to the caller; if it does
+     * not, scanning should resume right after the opening delimiter.
+     */
+    std::optional<PlaceholderMatch> nextToken(std::string_view text, std::size_t from) const;
+
+    static constexpr std::size_t max_directive_length = 128;
+
+    static bool isBodyChar(char c) { return bodyTable()[static_cast<unsigned char>(c)]; }
+
+    bool isDelimiter(char c) const { return isDelimiter_[static_cast<unsigned char>(c)]; }
+
+  private:
+    static const std::array<bool, 256> &bodyTable();
+
+    template <bool with_directives> std::optional<PlaceholderMatch> scan(std::string_view text, std::size_t from) const;
+
+    std::array<char, max_delimiters> delimiters_{};
+    std::size_t                      count_ = 0;
+    std::array<bool, 256>            isDelimiter_{};
+};
+
+} // namespace cgen
@@ -1,6 +1,9 @@
 
 #pragma once
 
+#include "cgen/directory_tree.h"
+#include "cgen/thread_pool.h"
+
 #include <expected>
 #include <filesystem>
 #include <fmt/core.h> // For fmt::print
@@ -69,6 +72,47 @@ struct Directory {
 std::expected<std::set<std::shared_ptr<Directory>, CompareDirectoryByName<Directory>>, scan_status>
 scan_template_directory(const std::string &template_name, const std::string &templates_base_dir);
 
+// Tag selecting the flat `DirectoryTree` overload of `scan_template_directory`
+struct flat_tree_t {};
+inline constexpr flat_tree_t flat_tree{};
+
+/**
+ * Scans a template directory into a flat, arena-backed `DirectoryTree`.
+ *
+ * Produces the same entries as the `Directory` overload, but lists each directory once with a
+ * plain directory iterator and canonicalizes only the template root, so the cost per entry is
+ * one `readdir` record and a copy of its name into the tree's string pool. Top-level files belong
+ * to the root node instead of a virtual "." directory.
+ *
+ * @param template_name The name of the template directory to scan.
+ * @param templates_base_dir The base directory path where template directories are located.
+ *
+ * @return The scanned tree, or `scan_status::error` under the same conditions as the
+ *         `Directory` overload.
+ *
+ * @note Symbolic links to directories are recorded but not descended into, matching the
+ *       `Directory` overload.
+ */
+std::expected<DirectoryTree, scan_status> scan_template_directory(const std::string &template_name, const std::string &templates_base_dir,
+                                                                  flat_tree_t);
+
+/**
+ * Scans a template directory into a `DirectoryTree`, listing directories concurrently on `pool`.
+ *
+ * Each directory is one task: it is opened with `openat` relative to its parent's descriptor and
+ * read with `readdir` (`getdents64` on Linux), so no path is resolved from the root again and
+ * nothing is canonicalized. Entry types come from `d_type`; only symlinks and filesystems that do
+ * not report a type cost an extra `fstatat`. Subdirectories are submitted as new tasks as soon as
+ * their parent is listed, so the work-stealing pool spreads a wide tree over every worker and
+ * directory latency (e.g. on NFS) overlaps instead of adding up.
+ *
+ * The listings are merged into the tree in name order once every task finished, so the result and
+ * the order of the error messages are exactly those of the sequential overload, whatever the
+ * number of workers. Platforms without `openat` use the sequential overload.
+ */
+std::expected<DirectoryTree, scan_status> scan_template_directory(const std::string &template_name, const std::string &templates_base_dir,
+                                                                  flat_tree_t, ThreadPool &pool);
+
 /**
  * @brief Lists template directories based on the provided configuration result.
  *
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "cgen/generator.h"
+#include "cgen/placeholder_processor.h"
+
+#include <expected>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace cgen {
+namespace fs = std::filesystem;
+
+enum class server_command : int {
+    generate = 0, // Generate a project
+    ping     = 1, // Check that the server is running
+    shutdown = 2, // Stop the server
+};
+
+// A request sent to `cgen serve` over its socket
+struct ServerRequest {
+    server_command                               command = server_command::generate;
+    std::string                                  template_name;
+    fs::path                                     output_dir; // Absolute, the server does not share the client's working directory
+    std::unordered_map<std::string, std::string> values;
+    bool                                         incremental = false;
+    bool                                         staging     = false;
+    std::optional<io_backend>                    io;         // The backend the server was started with if empty
+};
+
+/**
+ * Encodes a request in the line-based wire format:
+ *
+ * @code
+ * cgen-request 1
+ * generate library_default
+ * output /home/me/projects/demo
+ * incremental 0
+ * staging 0
+ * io io_uring
+ * value PROJECT_NAME demo
+ * end
+ * @endcode
+ *
+ * The `io` line is only sent when the client chose a backend. Backslashes and line breaks in paths and values are escaped as `\\`, `\n` and `\r`. The server
+ * answers with a single line, `ok` or `error <reason>`.
+ */
+std::string encode_request(const ServerRequest &request);
+
+// Parses a complete request, empty if it is malformed
+std::optional<ServerRequest> decode_request(std::string_view text);
+
+struct ServeOptions {
+    fs::path        socket_path;
+    std::string     templates_base_dir = "templates/";
+    GenerateOptions generate; // Worker count and index use; whether to generate incrementally comes with each request
+};
+
+// `$XDG_RUNTIME_DIR/cgen.sock`, or a per-user path in the temp directory without it
+fs::path default_socket_path();
+
+#if defined(__unix__) || defined(__APPLE__)
+/**
+ * Runs the generator as a daemon on a Unix domain socket until it receives a `shutdown` request,
+ * SIGINT or SIGTERM.
+ *
+ * The process keeps one worker pool and a `TemplateCache` for its whole lifetime, so a request
+ * for a template that did not change since the last one skips option parsing, scanning and
+ * compiling entirely and only renders. Requests are served one at a time, each generation still
+ * runs on all workers. Progress messages go to the server's standard output.
+ *
+ * @return Nothing after a clean shutdown, or `generate_status::error` if the socket could not be
+ *         created, e.g. because another server is already listening on it.
+ */
+std::expected<void, generate_status> serve(const ServeOptions &options, const PlaceholderProcessor &processor);
+
+/**
+ * Sends one request to a running server and waits for its answer.
+ *
+ * @return Nothing if the server answered `ok`, or `generate_status::error` after printing the
+ *         reason the request failed or could not be delivered.
+ */
+std::expected<void, generate_status> send_request(const fs::path &socket_path, const ServerRequest &request);
+#endif
+
+} // namespace cgen
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "cgen/generator.h"
+
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+namespace cgen {
+namespace fs = std::filesystem;
+
+/**
+ * Generates a project so that readers of the output directory only ever see the previous project
+ * or the complete new one, and a crash leaves the output as it was.
+ *
+ * The project is written into a hidden staging directory next to the output
+ * (`.<name>.cgen-staging-<random>`), with a `.cgen-manifest`. Printing is limited to errors and one
+ * summary line. The staging directory is flushed to disk with a single `syncfs` and then renamed
+ * onto the output path. If the output already exists, the two directories are swapped atomically
+ * with `renameat2(RENAME_EXCHANGE)` on Linux and the previous tree is deleted afterwards. Elsewhere
+ * the previous tree is first moved aside, so for a moment the output path does not exist.
+ *
+ * Because the whole directory is replaced, an existing output must be empty or must have been
+ * generated by cgen before, i.e. contain a `.cgen-manifest`; anything else is refused. So is an
+ * output with entries its manifest does not list, such as a `.git` directory or a build tree, or
+ * with generated files that were edited since, as swapping in the new tree would delete them.
+ * `GenerateOptions::incremental` does not apply, every file of the project is written, through
+ * `io` (see `generate_project`).
+ *
+ * @return Nothing once the new project is in place, or `generate_status::error` if it could not
+ *         be generated or moved into place, in which case the output is left untouched and the
+ *         staging directory is removed.
+ */
+std::expected<void, generate_status> generate_staged(const PreparedTemplate &prepared, const fs::path &output_dir,
+                                                     const std::unordered_map<std::string, std::string> &values, ThreadPool &pool,
+                                                     io_backend io = io_backend::blocking);
+
+} // namespace cgen
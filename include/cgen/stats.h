@@ -0,0 +1,146 @@
+#pragma once
+
+#include "cgen/trace.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace cgen {
+
+// Stages of a generation that are timed
+enum class stats_phase : int {
+    scan         = 0, // Listing template directories, including canonicalization
+    canonicalize = 1, // Resolving canonical template paths
+    read         = 2, // Opening and reading template files
+    compile      = 3, // Finding the placeholders of template files
+    prepare      = 4, // Reading and compiling a whole template
+    render       = 5, // Rendering files with placeholders, in memory
+    write        = 6, // Opening, writing and closing rendered output files
+    copy         = 7, // Copying files without placeholders
+    generate     = 8, // Generating a whole project
+};
+inline constexpr std::size_t stats_phase_count = 9;
+
+// Events and amounts that are counted
+enum class stats_counter : int {
+    directories_scanned      = 0,
+    files_scanned            = 1,
+    files_read               = 2,
+    bytes_read               = 3,
+    placeholders_matched     = 4, // Placeholder occurrences found while compiling
+    placeholders_substituted = 5, // Placeholder occurrences replaced by a value while rendering
+    files_written            = 6,
+    bytes_written            = 7,
+    files_unchanged          = 8, // Outputs an incremental generation left alone
+};
+inline constexpr std::size_t stats_counter_count = 9;
+
+enum class stats_format : int {
+    text = 0,
+    json = 1,
+};
+
+/**
+ * Counters and accumulated phase times of everything cgen did in this process.
+ *
+ * Recording is off by default and costs a relaxed atomic load per instrumented call site while
+ * it stays off. Once enabled, counters and timers are relaxed atomic additions, so worker threads
+ * record concurrently without locks. A phase that runs on several threads (reading, compiling,
+ * rendering, writing, copying) accumulates the time of all of them, so it can exceed the wall time.
+ */
+class Statistics {
+  public:
+    void enable(bool enabled = true) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    void add(stats_counter counter, std::uint64_t amount = 1) {
+        counters_[static_cast<std::size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+    }
+    void addTime(stats_phase phase, std::chrono::nanoseconds elapsed) {
+        nanoseconds_[static_cast<std::size_t>(phase)].fetch_add(static_cast<std::uint64_t>(elapsed.count()), std::memory_order_relaxed);
+    }
+
+    std::uint64_t count(stats_counter counter) const {
+        return counters_[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed);
+    }
+    std::chrono::nanoseconds time(stats_phase phase) const {
+        return std::chrono::nanoseconds(nanoseconds_[static_cast<std::size_t>(phase)].load(std::memory_order_relaxed));
+    }
+
+    // Zero every counter and timer, recording stays enabled or disabled
+    void reset();
+
+  private:
+    std::atomic<bool>                                           enabled_{false};
+    std::array<std::atomic<std::uint64_t>, stats_counter_count> counters_{};
+    std::array<std::atomic<std::uint64_t>, stats_phase_count>   nanoseconds_{};
+};
+
+// The statistics of this process
+Statistics &statistics();
+
+// Name of a phase in reports and traces, e.g. "scan"
+std::string_view phase_name(stats_phase phase);
+
+// Add to a counter if statistics are enabled
+inline void count_stat(stats_counter counter, std::uint64_t amount = 1) {
+    Statistics &stats = statistics();
+    if (stats.enabled()) {
+        stats.add(counter, amount);
+    }
+}
+
+/**
+ * Adds the time from its construction to its destruction to a phase if statistics are enabled, and
+ * records it as a span of the current thread if tracing is.
+ */
+class ScopedTimer {
+  public:
+    explicit ScopedTimer(stats_phase phase) : phase_(phase), counting_(statistics().enabled()), tracing_(tracer().enabled()) {
+        if (counting_ || tracing_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+    ~ScopedTimer() {
+        if (!counting_ && !tracing_) {
+            return;
+        }
+        auto end = std::chrono::steady_clock::now();
+        if (counting_) {
+            statistics().addTime(phase_, end - start_ - excluded_);
+        }
+        if (tracing_) {
+            tracer().record(phase_name(phase_), "phase", start_, end);
+        }
+    }
+    ScopedTimer(const ScopedTimer &)            = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+    // Leave time spent in a nested phase out of this one, so it is not counted twice; a trace still shows it nested
+    void exclude(std::chrono::nanoseconds elapsed) { excluded_ += elapsed; }
+
+  private:
+    stats_phase                           phase_;
+    bool                                  counting_;
+    bool                                  tracing_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::nanoseconds              excluded_{0};
+};
+
+/**
+ * Formats a report of the recorded statistics.
+ *
+ * Besides the phases and counters, the report includes the number of read and write system calls
+ * the process made, as the kernel counts them in `/proc/self/io`, where that file is available.
+ *
+ * @param wall_time Wall time of the whole run.
+ * @param format `text` for an aligned table, `json` for a single JSON object.
+ */
+std::string format_stats(const Statistics &stats, std::chrono::nanoseconds wall_time, stats_format format);
+
+} // namespace cgen
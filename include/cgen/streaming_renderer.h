@@ -0,0 +1,78 @@
+#pragma once
+
+#include "cgen/compiled_template.h"
+#include "cgen/placeholder_processor.h"
+
+#include <cstddef>
+#include <expected>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+
+namespace cgen {
+
+/**
+ * Placeholder substitution over a stream of input chunks, with bounded memory.
+ *
+ * Input is fed with `write` in chunks of any size and the substituted output is handed to a sink
+ * as it is produced. Only a possibly unfinished placeholder at the end of a chunk (a delimiter
+ * followed by nothing but name characters) is held back until the next chunk decides it, so
+ * placeholders straddling chunk boundaries are substituted exactly as `PlaceholderProcessor`
+ * would substitute them in one piece. Memory use is one chunk plus `max_token_length` bytes,
+ * independent of the size of the input or the output.
+ *
+ * A held-back candidate that grows beyond `max_token_length` bytes without being closed is
+ * emitted as plain text; the in-memory engine has no such limit on placeholder names.
+ *
+ * Block directives (see `CompiledTemplate`) need the whole template and are passed through as text.
+ */
+class StreamingRenderer {
+  public:
+    static constexpr std::size_t default_chunk_size = 64 * 1024;
+    static constexpr std::size_t max_token_length   = 256;
+
+    // `processor` and `values` must outlive the renderer
+    StreamingRenderer(const PlaceholderProcessor &processor, const std::unordered_map<std::string, std::string> &values, RenderSink sink);
+
+    // Substitute the next chunk of input
+    void write(std::string_view chunk);
+
+    // Flush the held-back tail, an unfinished placeholder at the end of the input is plain text
+    void finish();
+
+  private:
+    // Emit every literal and placeholder of `text` that later input cannot change, return the
+    // number of bytes consumed
+    std::size_t process(std::string_view text);
+
+    const PlaceholderScanner                           &scanner_;
+    const std::unordered_map<std::string, std::string> &values_;
+    RenderSink                                          sink_;
+    std::string                                         pending_; // Held-back tail, shorter than max_token_length
+    std::string                                         name_;    // Reused lookup key
+};
+
+/**
+ * Substitutes placeholders in everything read from `in`, handing the output to `sink`.
+ *
+ * @return Nothing on success, or `std::errc::io_error` if reading from `in` failed.
+ */
+std::expected<void, std::error_code> render_stream(const PlaceholderProcessor &processor, std::istream &in,
+                                                   const std::unordered_map<std::string, std::string> &values, const RenderSink &sink,
+                                                   std::size_t chunk_size = StreamingRenderer::default_chunk_size);
+
+#if defined(__unix__) || defined(__APPLE__)
+/**
+ * Substitutes placeholders from one file descriptor into another, buffering at most one chunk
+ * of input and one chunk of output.
+ *
+ * @return Nothing on success, or the error of the first failing `read` or `write`.
+ */
+std::expected<void, std::error_code> render_stream(const PlaceholderProcessor &processor, int in_fd, int out_fd,
+                                                   const std::unordered_map<std::string, std::string> &values,
+                                                   std::size_t chunk_size = StreamingRenderer::default_chunk_size);
+#endif
+
+} // namespace cgen
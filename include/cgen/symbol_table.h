@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cgen {
+
+class SymbolTable;
+
+/**
+ * Placeholder values bound to the dense ids of a SymbolTable, for rendering without hashing.
+ *
+ * The values are views into the map they were bound from, which must outlive them. Ids interned
+ * after binding, and names the map has no value for, are unbound. They are only made by
+ * `SymbolTable::bind`, so `render({})` still means an empty value map.
+ */
+class SymbolValues {
+  public:
+    // The value bound to `id`, a null view (data() == nullptr) if there is none
+    std::string_view get(std::uint32_t id) const { return id < values_.size() ? values_[id] : std::string_view(); }
+
+    bool contains(std::uint32_t id) const { return get(id).data() != nullptr; }
+
+  private:
+    friend class SymbolTable;
+
+    explicit SymbolValues(std::size_t size) : values_(size) {}
+
+    std::vector<std::string_view> values_; // Indexed by symbol id
+};
+
+/**
+ * Interns placeholder names into dense integer ids.
+ *
+ * Templates intern the names they use when they are compiled (see `PlaceholderProcessor::compile`),
+ * and each set of values is bound once to a flat SymbolValues. Rendering then resolves every
+ * placeholder by indexing, with no string hashing or allocation per file or per match.
+ *
+ * Interning is thread-safe, so files can be compiled in parallel against the same table, and ids
+ * never change once assigned.
+ */
+class SymbolTable {
+  public:
+    // The id of `name`, assigning the next free one if it has none yet
+    std::uint32_t intern(std::string_view name);
+
+    // The id of `name`, if it was interned
+    std::optional<std::uint32_t> find(std::string_view name) const;
+
+    // The name interned as `id`
+    std::string_view name(std::uint32_t id) const;
+
+    std::size_t size() const;
+
+    // Bind every value whose name was interned to its id, other values are not used by any template
+    SymbolValues bind(const std::unordered_map<std::string, std::string> &values) const;
+
+  private:
+    struct NameHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+    };
+
+    mutable std::shared_mutex                                                      mutex_;
+    std::deque<std::string>                                                        names_; // Indexed by id, a deque keeps views valid
+    std::unordered_map<std::string_view, std::uint32_t, NameHash, std::equal_to<>> ids_;   // Keys view into names_
+};
+
+} // namespace cgen
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "cgen/generator.h"
+#include "cgen/placeholder_processor.h"
+#include "cgen/thread_pool.h"
+
+#include <cstddef>
+#include <expected>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cgen {
+
+/**
+ * Prepared templates kept in memory between generations, for a long-running process.
+ *
+ * A template is scanned and compiled the first time it is requested and served from memory
+ * afterwards. On Linux every directory of a cached template is watched with inotify; any change
+ * below it (a file written, created, deleted or renamed) drops the template from the cache, so the
+ * next request prepares it again. Call `processChanges` whenever `changeDescriptor` becomes
+ * readable, and before serving a request. Where inotify is not available nothing is cached and
+ * every request prepares the template anew.
+ *
+ * Templates are prepared resident: their files are held as owned copies rather than mappings, so a
+ * template file truncated while a request renders it cannot bring the process down, and verbatim
+ * outputs are written from the same bytes the generation manifest hashes.
+ */
+class TemplateCache {
+  public:
+    TemplateCache(std::string templates_base_dir, const PlaceholderProcessor &processor, GenerateOptions options = {});
+    ~TemplateCache();
+    TemplateCache(const TemplateCache &)            = delete;
+    TemplateCache &operator=(const TemplateCache &) = delete;
+
+    /**
+     * Returns a prepared template, preparing it on `pool` if it is not cached.
+     *
+     * @return The prepared template, valid until the next call to `get` or `processChanges`, or
+     *         `generate_status::error` if it could not be scanned or prepared.
+     */
+    std::expected<const PreparedTemplate *, generate_status> get(const std::string &template_name, ThreadPool &pool);
+
+    // Descriptor that becomes readable when a cached template changes on disk, -1 without inotify
+    int changeDescriptor() const { return inotify_; }
+
+    // Drop every cached template with a pending change notification, without blocking
+    void processChanges();
+
+    std::size_t size() const { return entries_.size(); }
+
+  private:
+    struct Entry {
+        PreparedTemplate prepared;
+        std::vector<int> watches; // inotify watch descriptors of its directories
+    };
+
+    // Watch every directory of a scanned template, empty if any of them cannot be watched
+    std::vector<int> watch(const std::string &template_name, const DirectoryTree &tree);
+
+    void invalidate(const std::string &template_name);
+
+    std::string                                    templatesBaseDir_;
+    const PlaceholderProcessor                    &processor_;
+    GenerateOptions                                options_;
+    std::map<std::string, Entry>                   entries_;
+    std::unordered_map<int, std::set<std::string>> watchOwners_; // Cached templates below each watched directory
+    PreparedTemplate                               uncached_;    // Last template that could not be watched
+    int                                            inotify_ = -1;
+};
+
+} // namespace cgen
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "cgen/scanner.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace cgen {
+namespace fs = std::filesystem;
+
+// The stat() fields used to decide whether a cached entry is still valid
+struct IndexStamp {
+    std::int64_t  mtime_ns = 0;
+    std::uint64_t inode    = 0;
+    std::uint64_t size     = 0;
+
+    bool operator==(const IndexStamp &) const = default;
+};
+
+struct IndexedFile {
+    std::string name;
+    IndexStamp  stamp;
+};
+
+struct IndexedDirectory {
+    std::string                   name;               // Empty for the template root
+    IndexStamp                    stamp;              // Its mtime changes whenever an entry is added, removed or renamed
+    bool                          is_symlink = false; // Symlinked directories are listed but never descended into
+    std::vector<IndexedFile>      files;              // Sorted by name
+    std::vector<IndexedDirectory> directories;        // Sorted by name
+};
+
+/**
+ * Persistent cache of a template's directory tree and file stamps.
+ *
+ * The index of every template below a templates base directory is stored in a single
+ * `.cgen-index` file inside that base directory. Opening the index stats each cached directory:
+ * only directories whose mtime or inode changed are listed again. Files are never read here, the
+ * contents are read once, when the template is prepared. Unchanged subtrees cost one stat per
+ * entry and no path canonicalization, which is what makes repeated scans cheap on network
+ * filesystems. The file is rewritten (atomically, via rename) only when something changed.
+ */
+class TemplateIndex {
+  public:
+    /**
+     * Loads, validates and refreshes the index of one template.
+     *
+     * @param template_name The name of the template directory.
+     * @param templates_base_dir The base directory path where template directories are located.
+     *
+     * @return The up-to-date index, or `scan_status::error` if the template directory does not
+     *         exist or cannot be read. Failing to write the index file is not an error.
+     */
+    static std::expected<TemplateIndex, scan_status> open(const std::string &template_name, const std::string &templates_base_dir);
+
+    // Location of the index file for a templates base directory
+    static fs::path indexPath(const std::string &templates_base_dir);
+
+    // The tree in the shape returned by `scan_template_directory`
+    std::set<std::shared_ptr<Directory>, CompareDirectoryByName<Directory>> directories() const;
+
+    // The tree as a flat `DirectoryTree`, without copying any path
+    DirectoryTree tree() const;
+
+    const IndexedDirectory &root() const { return root_; }
+
+    // Cached entry of a file, given its path relative to the template root
+    const IndexedFile *findFile(const fs::path &relative) const;
+
+    // Directories that had to be listed again, and files that are new or whose stamp changed
+    std::size_t refreshedDirectories() const { return refreshedDirectories_; }
+    std::size_t refreshedFiles() const { return refreshedFiles_; }
+
+  private:
+    fs::path         rootPath_; // Canonical path of the template directory
+    IndexedDirectory root_;
+    std::size_t      refreshedDirectories_ = 0;
+    std::size_t      refreshedFiles_       = 0;
+};
+
+} // namespace cgen
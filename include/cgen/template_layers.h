@@ -0,0 +1,33 @@
+#pragma once
+
+#include "cgen/directory_tree.h"
+
+#include <span>
+
+namespace cgen {
+
+// Layer every template is composed with, unless disabled (see GenerateOptions::common_layer)
+inline constexpr const char *common_layer_name = "_common";
+
+// Directory of the layer selected by `--package-manager`, e.g. "_package_managers/cpm"
+inline constexpr const char *package_managers_dir = "_package_managers";
+
+/**
+ * Composes scanned template layers into one virtual template tree.
+ *
+ * The layers are merged entry by entry, so the result lists every output path once. Where several
+ * layers contain the same path, the layer earlier in `layers` wins: its file is the one read, and
+ * an entry of a later layer that would be a file where an earlier one has a directory (or the
+ * other way round) is dropped. Directories that exist in several layers are merged recursively.
+ *
+ * Nothing is read or copied, the result only records which layer each file comes from (see
+ * `DirectoryTree::fileLayer`), and generating from it writes every output file exactly once.
+ *
+ * @param layers Scanned layers, highest precedence first: the template itself, then its overlays.
+ *        At most `DirectoryTree::max_layers`, each with a single layer of its own.
+ *
+ * @return The composed tree, rooted at the first layer.
+ */
+DirectoryTree compose_layers(std::span<const DirectoryTree> layers);
+
+} // namespace cgen
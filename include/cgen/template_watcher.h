@@ -0,0 +1,99 @@
+#pragma once
+
+#include "cgen/generation_manifest.h"
+#include "cgen/generator.h"
+#include "cgen/placeholder_processor.h"
+#include "cgen/thread_pool.h"
+
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cgen {
+namespace fs = std::filesystem;
+
+/**
+ * Keeps a generated project in sync with its template while the template is being edited.
+ *
+ * `start` generates the whole project once and then watches every directory of the template with
+ * inotify. Each batch of changes is applied to the prepared template in memory:
+ *
+ * - A file that was written or replaced is read and compiled again, and only its output is
+ *   rendered.
+ * - A file or directory that was created, deleted or renamed makes the template be scanned and
+ *   prepared again. The project is then regenerated against an in-memory manifest (see
+ *   `GenerationManifest`), so only outputs whose template changed are written.
+ *
+ * The template is prepared resident (see `prepare_template`), so an editor truncating a
+ * file while it renders cannot bring the process down. Outputs of template files that were deleted
+ * are left in place. With `options.incremental` the
+ * manifest starts from `<output>/.cgen-manifest` and is written back after each batch.
+ *
+ * Watching needs inotify, i.e. Linux; elsewhere `start` reports an error after the initial
+ * generation.
+ */
+class TemplateWatcher {
+  public:
+    TemplateWatcher(std::string template_name, std::string templates_base_dir, fs::path output_base_path,
+                    std::unordered_map<std::string, std::string> values, const PlaceholderProcessor &processor,
+                    GenerateOptions options = {});
+    ~TemplateWatcher();
+    TemplateWatcher(const TemplateWatcher &)            = delete;
+    TemplateWatcher &operator=(const TemplateWatcher &) = delete;
+
+    /**
+     * Generates the project and starts watching its template.
+     *
+     * @return Nothing on success, or `generate_status::error` if the template could not be
+     *         scanned or generated, or could not be watched.
+     */
+    std::expected<void, generate_status> start();
+
+    // Descriptor that becomes readable when the template changes, -1 before `start`
+    int changeDescriptor() const { return inotify_; }
+
+    /**
+     * Applies every pending change to the template without blocking.
+     *
+     * @return The number of template files whose output was brought up to date, all of them after a
+     *         structural change, or `generate_status::error` if the template could not be prepared
+     *         again. The watcher keeps watching in that case, so the next change can fix it.
+     */
+    std::expected<std::size_t, generate_status> processChanges();
+
+    /**
+     * Runs `start`, then applies changes as they happen until SIGINT or SIGTERM.
+     *
+     * Changes arriving within a few milliseconds of each other, like the several events of one
+     * editor save, are applied as one batch.
+     */
+    std::expected<void, generate_status> run();
+
+  private:
+    // Scan, prepare and watch the template again, then regenerate every out-of-date output
+    std::expected<std::size_t, generate_status> rebuild();
+
+    // Replace all watches with one per directory of the scanned template
+    bool watchDirectories(const DirectoryTree &tree);
+
+    void saveManifest() const;
+
+    std::string                                  templateName_;
+    std::string                                  templatesBaseDir_;
+    fs::path                                     outputBasePath_;
+    std::unordered_map<std::string, std::string> values_;
+    const PlaceholderProcessor                  &processor_;
+    GenerateOptions                              options_;
+    ThreadPool                                   pool_;
+    fs::path                                     rootPath_; // Canonical path of the template directory
+    PreparedTemplate                             prepared_;
+    GenerationManifest                           manifest_;
+    std::unordered_map<int, fs::path>            watches_;     // inotify watch descriptor to the directory it watches
+    std::unordered_map<std::string, std::size_t> fileIndices_; // Source path to index in prepared_.files
+    int                                          inotify_ = -1;
+};
+
+} // namespace cgen
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cgen {
+
+/**
+ * A small work-stealing thread pool.
+ *
+ * Every worker owns a task deque. Tasks submitted from a worker go to that worker's own deque,
+ * tasks submitted from outside are spread round-robin. A worker pops from the back of its own
+ * deque and, when that is empty, steals from the front of the other workers' deques, so uneven
+ * task costs (e.g. one huge template file among many small ones) do not leave workers idle.
+ */
+class ThreadPool {
+  public:
+    // Start `threads` workers, 0 selects std::thread::hardware_concurrency()
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &)            = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Block until every submitted task has finished, rethrows the first exception a task threw
+    void wait();
+
+    std::size_t size() const { return threads_.size(); }
+
+  private:
+    struct Queue {
+        std::mutex                        mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // Pop from the worker's own queue, otherwise steal from the others
+    bool tryPop(std::size_t index, std::function<void()> &task);
+
+    void run(std::size_t index);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread>            threads_;
+
+    std::mutex              mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::size_t             queued_  = 0; // Tasks sitting in a queue
+    std::size_t             pending_ = 0; // Tasks submitted but not yet finished
+    std::size_t             next_    = 0; // Round-robin cursor for external submissions
+    bool                    stop_    = false;
+    std::exception_ptr      error_;
+};
+
+} // namespace cgen
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace cgen {
+namespace fs = std::filesystem;
+
+/**
+ * Records what every thread did and when, for the Chrome / Perfetto trace viewers.
+ *
+ * Each thread appends its events to a buffer of its own, so recording takes no lock and threads
+ * never wait for each other; a lock is only taken once per thread, to register its buffer. The
+ * buffers are written out as one trace-event JSON file (complete `X` events with thread ids and
+ * thread names) once recording is over.
+ *
+ * Tracing is off by default, every instrumented call site then costs one relaxed atomic load.
+ */
+class Tracer {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * Discards any previous events and starts recording, with timestamps relative to now.
+     * Threads still recording into the previous session's buffers are safe: those buffers are
+     * retired rather than freed, and whatever lands in them is not written.
+     */
+    void start();
+    void stop() { enabled_.store(false, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    /**
+     * Records a finished span on the calling thread.
+     *
+     * @param name Name of the span, it must outlive the tracer (e.g. a string literal).
+     * @param category Category shown and filtered on by the viewers, with the same lifetime.
+     * @param detail Shown as the span's `file` argument if not empty, e.g. the file worked on.
+     */
+    void record(std::string_view name, std::string_view category, clock::time_point begin, clock::time_point end, std::string detail = {});
+
+    // Name the calling thread in the trace, e.g. "worker 3"
+    void nameThread(std::string name);
+
+    /**
+     * Writes every recorded event as a trace-event JSON file. Recording threads must have finished,
+     * e.g. by waiting for their worker pool.
+     *
+     * @return Nothing on success, or the error that prevented writing the file.
+     */
+    std::expected<void, std::error_code> write(const fs::path &path) const;
+
+    std::size_t eventCount() const;
+
+  private:
+    struct Event {
+        std::string_view name;
+        std::string_view category;
+        std::int64_t     begin_ns;
+        std::int64_t     duration_ns;
+        std::string      detail;
+    };
+
+    struct ThreadBuffer {
+        std::uint32_t      tid;
+        std::string        name;
+        std::vector<Event> events;
+    };
+
+    // Buffer of the calling thread, registered on its first event
+    ThreadBuffer &localBuffer();
+
+    std::atomic<bool>                          enabled_{false};
+    std::atomic<std::uint64_t>                 session_{0}; // Invalidates thread buffers cached from an earlier start()
+    std::atomic<clock::rep>                    epoch_{0};   // Start of the session, as ticks since the clock's epoch
+    mutable std::mutex                         registryMutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+    std::vector<std::unique_ptr<ThreadBuffer>> retired_; // Buffers of earlier sessions, a thread may still hold one
+};
+
+// The tracer of this process
+Tracer &tracer();
+
+// Records the span from its construction to its destruction, if tracing is enabled
+class TraceScope {
+  public:
+    TraceScope(std::string_view name, std::string_view category) : name_(name), category_(category), active_(tracer().enabled()) {
+        if (active_) {
+            begin_ = Tracer::clock::now();
+        }
+    }
+    // Same, with the file the span works on
+    TraceScope(std::string_view name, std::string_view category, const fs::path &file) : TraceScope(name, category) { file_ = &file; }
+    ~TraceScope() {
+        if (active_) {
+            tracer().record(name_, category_, begin_, Tracer::clock::now(), file_ ? file_->string() : std::string());
+        }
+    }
+    TraceScope(const TraceScope &)            = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+  private:
+    std::string_view          name_;
+    std::string_view          category_;
+    bool                      active_;
+    const fs::path           *file_ = nullptr;
+    Tracer::clock::time_point begin_;
+};
+
+} // namespace cgen
@@ -0,0 +1,373 @@
+#include "cgen/batch.h"
+
+#include "cgen/staging.h"
+#include "cgen/template_layers.h"
+#include "cgen/trace.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fmt/core.h>
+#include <map>
+#include <toml++/toml.hpp>
+
+namespace cgen {
+namespace {
+
+// Convert a TOML value into the string substituted for a placeholder
+std::optional<std::string> to_placeholder_value(const toml::node &node) {
+    if (auto value = node.as_string()) {
+        return value->get();
+    }
+    if (auto value = node.as_integer()) {
+        return std::to_string(value->get());
+    }
+    if (auto value = node.as_floating_point()) {
+        return fmt::format("{}", value->get());
+    }
+    if (auto value = node.as_boolean()) {
+        return value->get() ? "true" : "false";
+    }
+    if (auto array = node.as_array()) {
+        std::string joined;
+        for (const auto &element : *array) {
+            auto item = to_placeholder_value(element);
+            if (!item) {
+                return std::nullopt;
+            }
+            if (!joined.empty()) {
+                joined += ';';
+            }
+            joined += *item;
+        }
+        return joined;
+    }
+    return std::nullopt;
+}
+
+bool read_values(const toml::table *table, std::unordered_map<std::string, std::string> &values, const fs::path &manifest_path) {
+    if (!table) {
+        return true;
+    }
+    for (auto &&[key, node] : *table) {
+        auto value = to_placeholder_value(node);
+        if (!value) {
+            fmt::print(stderr, "Error: Unsupported value type for '{}' in {}\n", key.str(), manifest_path.string());
+            return false;
+        }
+        values[std::string(key.str())] = std::move(*value);
+    }
+    return true;
+}
+
+std::string join_list(const std::vector<std::string> &items, char separator) {
+    std::string joined;
+    for (const auto &item : items) {
+        if (!joined.empty()) {
+            joined += separator;
+        }
+        joined += item;
+    }
+    return joined;
+}
+
+// The table at `path` in `document`, or an empty one
+const toml::table &table_at(const toml::table &document, std::initializer_list<std::string_view> path) {
+    static const toml::table empty;
+    const toml::table       *table = &document;
+    for (auto key : path) {
+        table = (*table)[key].as_table();
+        if (!table) {
+            return empty;
+        }
+    }
+    return *table;
+}
+
+// Keys of a table in name order, TOML tables are unordered
+std::vector<std::string> sorted_keys(const toml::table &table) {
+    std::vector<std::string> keys;
+    for (auto &&[key, node] : table) {
+        keys.emplace_back(key.str());
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+std::string cmake_bool(bool value) { return value ? "ON" : "OFF"; }
+
+// CMake lines that set up a package manager in the root CMakeLists.txt, before project()
+constexpr std::array<std::pair<std::string_view, std::string_view>, 4> package_manager_setup = {{
+    {"conan", "list(APPEND CMAKE_PREFIX_PATH \"${CMAKE_BINARY_DIR}\")"},
+    {"cpm", "include(${CMAKE_CURRENT_SOURCE_DIR}/get_cpm.cmake)"},
+    {"vcpkg", "set(CMAKE_TOOLCHAIN_FILE \"$ENV{VCPKG_ROOT}/scripts/buildsystems/vcpkg.cmake\" CACHE STRING \"Vcpkg toolchain file\")"},
+    {"xrepo", "# Dependencies are managed by xrepo, see xmake.lua"},
+}};
+
+void derive_project_values(const toml::table &document, const std::string &type, std::unordered_map<std::string, std::string> &values) {
+    const toml::table &project = table_at(document, {"project"});
+    const toml::table &build   = table_at(document, {"build"});
+
+    std::string name    = project["name"].value_or(std::string());
+    std::string version = project["version"].value_or(std::string("0.1.0"));
+
+    values["PROJECT_NAME"]        = name;
+    values["PROJECT_VERSION"]     = version;
+    values["PROJECT_DESCRIPTION"] = project["description"].value_or(std::string());
+    values["PROJECT_NAMESPACE"]   = project["namespace"].value_or(name);
+    values["PROJECT_VENDOR"]      = project["vendor"].value_or(std::string());
+    values["PROJECT_CONTACT"]     = project["contact"].value_or(std::string());
+
+    // "1.2" is 1.2.0, a suffix like "-rc1" stays with the last number
+    std::array<std::string, 3> parts = {"0", "0", "0"};
+    for (std::size_t i = 0, pos = 0; i < parts.size() && pos <= version.size(); ++i) {
+        std::size_t end = i + 1 < parts.size() ? std::min(version.find('.', pos), version.size()) : version.size();
+        if (end > pos) {
+            parts[i] = version.substr(pos, end - pos);
+        }
+        pos = end + 1;
+    }
+    values["PROJECT_VERSION_MAJOR"] = parts[0];
+    values["PROJECT_VERSION_MINOR"] = parts[1];
+    values["PROJECT_VERSION_PATCH"] = parts[2];
+
+    const toml::table &cmake_options = table_at(document, {"build", "cmake_options"});
+    bool               shared        = cmake_options["BUILD_SHARED_LIBS"].value_or(false);
+    values["PROJECT_TYPE"]           = type;
+    values["PROJECT_KIND"]           = type == "binary" ? "binary" : type == "header_only" ? "headeronly" : shared ? "shared" : "static";
+    values["SOURCE_FILES"]           = type == "binary" ? "    main.cpp" : type == "library" ? "    library.cpp" : "";
+    values["MODULE_FILES"]           = "";
+
+    if (const toml::node *standard = build["cpp_standard"].node()) {
+        values["CPP_STANDARD"] = to_placeholder_value(*standard).value_or("23");
+    } else {
+        values["CPP_STANDARD"] = "23";
+    }
+    values["ENABLE_TESTING"] = cmake_bool(build["enable_testing"].value_or(false));
+    values["USE_MODULES"]    = cmake_bool(build["use_modules"].value_or(false));
+
+    std::vector<std::string> options;
+    for (const auto &option : sorted_keys(cmake_options)) {
+        const toml::node *value = cmake_options[option].node();
+        if (auto flag = value->value<bool>()) {
+            options.push_back(fmt::format("set({} {})", option, cmake_bool(*flag)));
+        } else {
+            options.push_back(fmt::format("set({} \"{}\")", option, to_placeholder_value(*value).value_or("")));
+        }
+    }
+    values["CMAKE_OPTIONS"] = join_list(options, '\n');
+
+    const toml::table       &cmake_defines = table_at(document, {"build", "cmake_defines"});
+    std::vector<std::string> defines;
+    for (const auto &define : sorted_keys(cmake_defines)) {
+        std::string value = to_placeholder_value(*cmake_defines[define].node()).value_or("");
+        defines.push_back(fmt::format("target_compile_definitions(${{PROJECT_NAME}} PRIVATE {}{}{})", define, value.empty() ? "" : "=",
+                                      value));
+    }
+    values["CMAKE_DEFINES"] = join_list(defines, '\n');
+
+    // `fmt = { version = "9.1.0", required = true }`, or just `fmt = "9.1.0"`
+    const toml::table       &dependencies = table_at(document, {"dependencies"});
+    std::vector<std::string> all;
+    std::vector<std::string> required;
+    std::vector<std::string> find;
+    for (const auto &dependency : sorted_keys(dependencies)) {
+        const toml::node *entry       = dependencies[dependency].node();
+        std::string       dep_version = entry->as_table() ? (*entry->as_table())["version"].value_or(std::string())
+                                                          : entry->value_or(std::string());
+        bool              is_required = entry->as_table() ? (*entry->as_table())["required"].value_or(true) : true;
+        all.push_back(dependency);
+        if (is_required) {
+            required.push_back(dependency);
+            find.push_back(dep_version.empty() ? fmt::format("find_dependency({})", dependency)
+                                               : fmt::format("find_dependency({} {})", dependency, dep_version));
+        }
+    }
+    values["DEPENDENCIES"]          = join_list(all, ';');
+    values["REQUIRED_DEPENDENCIES"] = join_list(required, ';');
+    values["FIND_DEPENDENCIES"]     = join_list(find, '\n');
+
+    const toml::table       &package_managers = table_at(document, {"package_managers"});
+    std::vector<std::string> used;
+    for (const auto &[manager, setup] : package_manager_setup) {
+        bool enabled = package_managers[manager].value_or(false);
+        if (enabled) {
+            used.emplace_back(manager);
+        }
+        std::string key = "USE_" + std::string(manager);
+        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+        values[key] = enabled ? std::string(setup) : std::string();
+    }
+    values["PACKAGE_MANAGERS"] = join_list(used, ';');
+}
+
+} // namespace
+
+std::expected<BatchManifest, generate_status> load_batch_manifest(const fs::path &manifest_path) {
+    toml::table document;
+    try {
+        document = toml::parse_file(manifest_path.string());
+    } catch (const toml::parse_error &e) {
+        fmt::print(stderr, "Error parsing batch manifest {}:{}: {}\n", manifest_path.string(), e.source().begin.line, e.description());
+        return std::unexpected(generate_status::error);
+    }
+
+    const fs::path manifest_dir = manifest_path.parent_path();
+    BatchManifest  manifest;
+
+    if (auto templates = document["templates"].value<std::string>()) {
+        manifest.templates_dir = manifest_dir / *templates;
+    }
+
+    std::unordered_map<std::string, std::string> shared_values;
+    if (!read_values(document["values"].as_table(), shared_values, manifest_path)) {
+        return std::unexpected(generate_status::error);
+    }
+
+    const toml::array *projects = document["project"].as_array();
+    if (!projects) {
+        fmt::print(stderr, "Error: Batch manifest {} has no [[project]] entries\n", manifest_path.string());
+        return std::unexpected(generate_status::error);
+    }
+
+    for (const auto &node : *projects) {
+        const toml::table *entry = node.as_table();
+        if (!entry) {
+            fmt::print(stderr, "Error: Every [[project]] entry in {} must be a table\n", manifest_path.string());
+            return std::unexpected(generate_status::error);
+        }
+
+        auto template_name = (*entry)["template"].value<std::string>();
+        auto output_dir    = (*entry)["output"].value<std::string>();
+        if (!template_name || !output_dir) {
+            fmt::print(stderr, "Error: Project #{} in {} needs both 'template' and 'output'\n", manifest.projects.size() + 1,
+                       manifest_path.string());
+            return std::unexpected(generate_status::error);
+        }
+
+        BatchProject project{*template_name, manifest_dir / *output_dir, shared_values};
+        if (!read_values((*entry)["values"].as_table(), project.values, manifest_path)) {
+            return std::unexpected(generate_status::error);
+        }
+        manifest.projects.push_back(std::move(project));
+    }
+
+    return manifest;
+}
+
+std::expected<BatchProject, generate_status> load_project_config(const fs::path &config_path, const fs::path &output_dir) {
+    toml::table document;
+    try {
+        document = toml::parse_file(config_path.string());
+    } catch (const toml::parse_error &e) {
+        fmt::print(stderr, "Error parsing project configuration {}:{}: {}\n", config_path.string(), e.source().begin.line, e.description());
+        return std::unexpected(generate_status::error);
+    }
+
+    if (document["project"]["name"].value_or(std::string()).empty()) {
+        fmt::print(stderr, "Error: Project configuration {} has no [project] name\n", config_path.string());
+        return std::unexpected(generate_status::error);
+    }
+    std::string type = document["project"]["type"]["type"].value_or(std::string("binary"));
+    if (type != "binary" && type != "library" && type != "header_only") {
+        fmt::print(stderr, "Error: Unknown project type '{}' in {}, expected 'binary', 'library' or 'header_only'\n", type,
+                   config_path.string());
+        return std::unexpected(generate_status::error);
+    }
+
+    BatchProject project{type == "binary" ? "binary_default" : "library_default", output_dir, {}};
+    derive_project_values(document, type, project.values);
+    for (const char *manager : {"cpm", "vcpkg", "xrepo"}) { // The package managers with a template layer
+        if (document["package_managers"][manager].value_or(false)) {
+            project.overlays.push_back(fmt::format("{}/{}", package_managers_dir, manager));
+        }
+    }
+    if (!read_values(document["values"].as_table(), project.values, config_path)) {
+        return std::unexpected(generate_status::error);
+    }
+    return project;
+}
+
+std::expected<void, generate_status> generate_batch(const BatchManifest &manifest, const fs::path &templates_base_dir,
+                                                    const PlaceholderProcessor &processor, const GenerateOptions &options) {
+    const std::string base_dir = (manifest.templates_dir.empty() ? templates_base_dir : manifest.templates_dir).string();
+
+    // Two projects in one directory would overwrite each other's files, so nothing is generated
+    std::map<fs::path, const BatchProject *> claimed;
+    for (const auto &project : manifest.projects) {
+        std::error_code ec;
+        fs::path        output = fs::weakly_canonical(fs::absolute(project.output_dir), ec);
+        if (ec) {
+            output = fs::absolute(project.output_dir).lexically_normal();
+        }
+        auto [it, inserted] = claimed.try_emplace(output, &project);
+        if (!inserted) {
+            fmt::print(stderr, "Error: Projects '{}' and '{}' would both be generated into {}\n", it->second->output_dir.string(),
+                       project.output_dir.string(), output.string());
+            return std::unexpected(generate_status::error);
+        }
+    }
+
+    ThreadPool pool(options.jobs);
+
+    // Scanned and compiled templates, keyed by template name and overlays. Failed templates map to nullopt so they are not retried.
+    std::map<std::string, std::optional<PreparedTemplate>> prepared_templates;
+    std::size_t                                            failed = 0;
+
+    for (const auto &project : manifest.projects) {
+        TraceScope trace("project", "batch", project.output_dir);
+
+        std::string key = project.template_name;
+        for (const auto &overlay : project.overlays) {
+            key += '\n' + overlay;
+        }
+        auto [it, inserted] = prepared_templates.try_emplace(key);
+        if (inserted) {
+            GenerateOptions layered = options;
+            layered.overlays.insert(layered.overlays.begin(), project.overlays.begin(), project.overlays.end());
+            auto scanned_template_or = load_template_tree(project.template_name, base_dir, layered, &pool);
+            if (!scanned_template_or) {
+                fmt::print(stderr, "Error scanning template directory '{}'.\n", project.template_name);
+            } else if (auto prepared_or = prepare_template(scanned_template_or.value(), processor, pool, options.io)) {
+                it->second = std::move(prepared_or.value());
+            }
+        }
+        if (!it->second) {
+            fmt::print(stderr, "Error: Skipping '{}', template '{}' is unavailable.\n", project.output_dir.string(), project.template_name);
+            ++failed;
+            continue;
+        }
+
+        fmt::print("Generating project from template '{}' into directory '{}'\n", project.template_name, project.output_dir.string());
+        try {
+            auto output_base_path_or = ensure_output_directory(project.output_dir);
+            if (!output_base_path_or) {
+                ++failed;
+                continue;
+            }
+            std::expected<void, generate_status> generated_or;
+            if (options.staging) {
+                generated_or = generate_staged(*it->second, output_base_path_or.value(), project.values, pool, options.io);
+            } else if (options.incremental) {
+                generated_or = generate_incremental(*it->second, output_base_path_or.value(), project.values, pool);
+            } else {
+                generated_or = generate_project(*it->second, output_base_path_or.value(), project.values, pool, nullptr, true, options.io);
+            }
+            if (!generated_or) {
+                ++failed;
+            }
+        } catch (const std::exception &e) {
+            fmt::print(stderr, "Error generating project into {}: {}\n", project.output_dir.string(), e.what());
+            ++failed;
+        }
+    }
+
+    fmt::print("Batch generation complete: {} of {} projects from {} templates.\n", manifest.projects.size() - failed,
+               manifest.projects.size(), prepared_templates.size());
+    if (failed != 0) {
+        return std::unexpected(generate_status::error);
+    }
+    return {};
+}
+
+} // namespace cgen
@@ -0,0 +1,250 @@
+#include "cgen/compiled_template.h"
+
+#include "cgen/stats.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace cgen {
+namespace {
+
+// Unbound slots are null views, so an empty value can still be told apart from a missing one
+bool is_bound(std::string_view value) { return value.data() != nullptr; }
+
+bool is_true(std::string_view value) {
+    if (value.empty()) {
+        return false;
+    }
+    for (std::string_view no : {"0", "false", "off", "no"}) {
+        if (std::ranges::equal(value, no, [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; })) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// An `each` loop being rendered
+struct LoopFrame {
+    std::string_view rest;            // Items not visited yet, null once the list is exhausted
+    std::string_view saved;           // Binding of the loop variable before the loop
+    bool             started = false; // Whether `saved` was taken yet
+};
+
+// Slot bindings and loop stack of `run`, kept per thread so their capacity is reused from render to render
+struct RunScratch {
+    std::vector<std::string_view> bound;
+    std::vector<LoopFrame>        loops;
+};
+
+thread_local RunScratch run_scratch;
+
+// Resolves a slot through its symbol id
+auto by_symbol(const std::vector<std::uint32_t> &symbols, const SymbolValues &values) {
+    return [&symbols, &values](std::uint32_t slot) { return values.get(symbols[slot]); };
+}
+
+} // namespace
+
+void CompiledTemplate::addLiteral(std::size_t offset, std::size_t length) {
+    if (length == 0) {
+        return;
+    }
+    segments_.push_back({offset, length, literal});
+}
+
+std::uint32_t CompiledTemplate::addControl(segment_op op, std::uint32_t slot, std::uint32_t target) {
+    hasDirectives_ = true;
+    segments_.push_back({0, 0, slot, op, target});
+    return static_cast<std::uint32_t>(segments_.size() - 1);
+}
+
+void CompiledTemplate::patchTarget(std::uint32_t index) { segments_[index].target = static_cast<std::uint32_t>(segments_.size()); }
+
+void CompiledTemplate::addPlaceholder(std::size_t offset, std::size_t length, std::uint32_t slot) {
+    segments_.push_back({offset, length, slot});
+}
+
+template <typename Lookup> bool CompiledTemplate::rendersVerbatimWith(const Lookup &lookup) const {
+    if (hasDirectives_) {
+        return false; // The directives themselves are never output
+    }
+    for (std::uint32_t slot = 0; slot < slots_.size(); ++slot) {
+        if (is_bound(lookup(slot))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<std::string_view> CompiledTemplate::bindSlots(const std::unordered_map<std::string, std::string> &values) const {
+    std::vector<std::string_view> bound(slots_.size());
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        if (auto it = values.find(slots_[i]); it != values.end()) {
+            bound[i] = it->second;
+        }
+    }
+    return bound;
+}
+
+template <typename Lookup, typename Sink> std::size_t CompiledTemplate::run(const Lookup &lookup, Sink &&sink) const {
+    // Taken out of the scratch while running, so a sink that renders another template gets fresh vectors
+    std::vector<std::string_view> bound = std::move(run_scratch.bound);
+    std::vector<LoopFrame>        loops = std::move(run_scratch.loops);
+    loops.clear();
+
+    // Loop variables are rebound to list items, so the slots get a copy of their bindings
+    bound.resize(slots_.size());
+    for (std::uint32_t slot = 0; slot < slots_.size(); ++slot) {
+        bound[slot] = lookup(slot);
+    }
+
+    std::string_view source      = source_.view();
+    std::size_t      substituted = 0;
+    for (std::size_t pc = 0; pc < segments_.size();) {
+        const Segment &segment = segments_[pc++];
+        switch (segment.op) {
+        case segment_op::emit:
+            if (segment.slot != literal && is_bound(bound[segment.slot])) {
+                sink(bound[segment.slot]);
+                ++substituted;
+            } else {
+                sink(source.substr(segment.offset, segment.length));
+            }
+            break;
+        case segment_op::jump_if:
+            if (is_true(bound[segment.slot])) {
+                pc = segment.target;
+            }
+            break;
+        case segment_op::jump_unless:
+            if (!is_true(bound[segment.slot])) {
+                pc = segment.target;
+            }
+            break;
+        case segment_op::jump: pc = segment.target; break;
+        case segment_op::each: loops.push_back({bound[segment.slot].empty() ? std::string_view() : bound[segment.slot], {}}); break;
+        case segment_op::next: {
+            LoopFrame &loop = loops.back();
+            if (!loop.started) {
+                loop.saved   = bound[segment.slot];
+                loop.started = true;
+            }
+            if (!is_bound(loop.rest)) {
+                bound[segment.slot] = loop.saved;
+                loops.pop_back();
+                pc = segment.target;
+                break;
+            }
+            // A trailing separator ends the list rather than adding an empty last item
+            std::size_t end     = loop.rest.find(';');
+            bool        last    = end == std::string_view::npos || end + 1 == loop.rest.size();
+            bound[segment.slot] = loop.rest.substr(0, end);
+            loop.rest           = last ? std::string_view() : loop.rest.substr(end + 1);
+            break;
+        }
+        }
+    }
+    run_scratch.bound = std::move(bound);
+    run_scratch.loops = std::move(loops);
+    return substituted;
+}
+
+template <typename Lookup> std::string CompiledTemplate::renderWith(const Lookup &lookup) const {
+    if (hasDirectives_) {
+        std::string result;
+        result.reserve(source_.view().size()); // Only a guess, the size depends on the branches taken
+        emitWith(lookup, [&result](std::string_view piece) { result.append(piece); });
+        return result;
+    }
+
+    std::size_t size = 0;
+    for (const auto &segment : segments_) {
+        std::string_view value = segment.slot != literal ? lookup(segment.slot) : std::string_view();
+        size += is_bound(value) ? value.size() : segment.length;
+    }
+    std::string result;
+    result.reserve(size);
+    emitWith(lookup, [&result](std::string_view piece) { result.append(piece); });
+    return result;
+}
+
+template <typename Lookup, typename Sink> void CompiledTemplate::emitWith(const Lookup &lookup, Sink &&sink) const {
+    if (hasDirectives_) {
+        count_stat(stats_counter::placeholders_substituted, run(lookup, sink));
+        return;
+    }
+    std::string_view source      = source_.view();
+    std::size_t      substituted = 0;
+    for (const auto &segment : segments_) {
+        std::string_view value = segment.slot != literal ? lookup(segment.slot) : std::string_view();
+        if (is_bound(value)) {
+            sink(value);
+            ++substituted;
+        } else {
+            sink(source.substr(segment.offset, segment.length));
+        }
+    }
+    count_stat(stats_counter::placeholders_substituted, substituted);
+}
+
+bool CompiledTemplate::rendersVerbatim(const std::unordered_map<std::string, std::string> &values) const {
+    return rendersVerbatimWith([this, &values](std::uint32_t slot) {
+        auto it = values.find(slots_[slot]);
+        return it != values.end() ? std::string_view(it->second) : std::string_view();
+    });
+}
+
+bool CompiledTemplate::rendersVerbatim(const SymbolValues &values) const {
+    return rendersVerbatimWith(by_symbol(symbols_, values));
+}
+
+std::string CompiledTemplate::render(const std::unordered_map<std::string, std::string> &values) const {
+    // Resolve every slot once, instead of once per occurrence
+    auto bound = bindSlots(values);
+    return renderWith([&bound](std::uint32_t slot) { return bound[slot]; });
+}
+
+std::string CompiledTemplate::render(const SymbolValues &values) const {
+    return renderWith(by_symbol(symbols_, values));
+}
+
+void CompiledTemplate::render(const std::unordered_map<std::string, std::string> &values, const RenderSink &sink) const {
+    auto bound = bindSlots(values);
+    emitWith([&bound](std::uint32_t slot) { return bound[slot]; }, sink);
+}
+
+void CompiledTemplate::render(const SymbolValues &values, const RenderSink &sink) const {
+    emitWith(by_symbol(symbols_, values), sink);
+}
+
+std::size_t CompiledTemplate::renderedSize(const SymbolValues &values) const {
+    std::size_t size = 0;
+    if (hasDirectives_) {
+        run(by_symbol(symbols_, values), [&size](std::string_view piece) { size += piece.size(); });
+        return size;
+    }
+    for (const auto &segment : segments_) {
+        std::string_view value = segment.slot != literal ? values.get(symbols_[segment.slot]) : std::string_view();
+        size += is_bound(value) ? value.size() : segment.length;
+    }
+    return size;
+}
+
+std::size_t CompiledTemplate::renderInto(const SymbolValues &values, std::span<char> out) const {
+    std::size_t size = 0;
+    emitWith(by_symbol(symbols_, values), [&out, &size](std::string_view piece) {
+        if (size < out.size()) {
+            std::memcpy(out.data() + size, piece.data(), std::min(piece.size(), out.size() - size));
+        }
+        size += piece.size();
+    });
+    return size;
+}
+
+std::string_view CompiledTemplate::render(const SymbolValues &values, std::string &arena) const {
+    arena.resize_and_overwrite(renderedSize(values), [&](char *data, std::size_t size) { return renderInto(values, {data, size}); });
+    return arena;
+}
+
+} // namespace cgen
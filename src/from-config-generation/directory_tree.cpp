@@ -0,0 +1,69 @@
+#include "cgen/directory_tree.h"
+
+#include <cassert>
+
+namespace cgen {
+
+fs::path DirectoryTree::relativePath(std::size_t node) const {
+    std::vector<std::uint32_t> chain;
+    for (auto i = static_cast<std::uint32_t>(node); nodes_[i].parent != no_parent; i = nodes_[i].parent) {
+        chain.push_back(i);
+    }
+
+    fs::path relative;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        relative /= name(nodes_[*it].name);
+    }
+    return relative;
+}
+
+std::uint32_t DirectoryTree::addLayer(fs::path root) {
+    assert(layerCount() < max_layers);
+    layers_.push_back(std::move(root));
+    fileLayers_.resize(files_.size(), 0); // Layers are only recorded from the first overlay on
+    nodeLayers_.resize(nodes_.size(), 1);
+    return static_cast<std::uint32_t>(layers_.size());
+}
+
+std::size_t DirectoryTree::openDirectory(std::string_view name, std::uint32_t layers) {
+    auto index = static_cast<std::uint32_t>(nodes_.size());
+    assert(layers != 0 && layers < (std::uint64_t{1} << layerCount()));
+    if (!layers_.empty()) {
+        nodeLayers_.push_back(layers);
+    }
+
+    Node node;
+    node.name       = intern(name);
+    node.parent     = open_.empty() ? no_parent : open_.back();
+    node.first_file = static_cast<std::uint32_t>(files_.size());
+    nodes_.push_back(node);
+
+    open_.push_back(index);
+    return index;
+}
+
+void DirectoryTree::addFile(std::string_view name, std::uint32_t layer) {
+    assert(!open_.empty());
+    assert(layer < layerCount());
+    Node &dir = nodes_[open_.back()];
+    assert(dir.first_file + dir.file_count == files_.size()); // No subdirectory opened in between
+    if (!layers_.empty()) {
+        fileLayers_.push_back(layer);
+    }
+    files_.push_back(intern(name));
+    ++dir.file_count;
+}
+
+void DirectoryTree::closeDirectory() {
+    assert(!open_.empty());
+    nodes_[open_.back()].subtree_end = static_cast<std::uint32_t>(nodes_.size());
+    open_.pop_back();
+}
+
+DirectoryTree::Name DirectoryTree::intern(std::string_view name) {
+    Name span{static_cast<std::uint32_t>(names_.size()), static_cast<std::uint32_t>(name.size())};
+    names_.append(name);
+    return span;
+}
+
+} // namespace cgen
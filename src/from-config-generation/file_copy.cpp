@@ -0,0 +1,155 @@
+#include "cgen/file_copy.h"
+
+#include <utility>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cgen {
+
+#if defined(__linux__)
+namespace {
+
+std::error_code last_error() { return std::error_code(errno, std::generic_category()); }
+
+// Closes a descriptor on every return path
+struct FdGuard {
+    int fd;
+    ~FdGuard() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+
+// errno values meaning the primitive cannot be used for this pair of files, so the next one is tried
+bool is_unsupported(int error) { return error == EXDEV || error == ENOSYS || error == EINVAL || error == EOPNOTSUPP || error == EBADF; }
+
+enum class step_result { done, unsupported, failed };
+
+// Run one in-kernel primitive until `size` bytes are copied. Falling back is only allowed before
+// the first byte moved, afterwards the file positions are no longer at the start.
+template <typename CopyChunk> step_result copy_in_kernel(std::size_t size, CopyChunk copy_chunk) {
+    std::size_t copied = 0;
+    while (copied < size) {
+        ssize_t count = copy_chunk(size - copied);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return copied == 0 && is_unsupported(errno) ? step_result::unsupported : step_result::failed;
+        }
+        if (count == 0) {
+            break; // The source shrank while copying
+        }
+        copied += static_cast<std::size_t>(count);
+    }
+    return step_result::done;
+}
+
+std::expected<void, std::error_code> copy_buffered(int in, int out) {
+    char buffer[64 * 1024];
+    for (;;) {
+        ssize_t count = ::read(in, buffer, sizeof(buffer));
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return std::unexpected(last_error());
+        }
+        if (count == 0) {
+            return {};
+        }
+        for (ssize_t written = 0; written < count;) {
+            ssize_t n = ::write(out, buffer + written, static_cast<std::size_t>(count - written));
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return std::unexpected(last_error());
+            }
+            written += n;
+        }
+    }
+}
+
+// Fill an empty destination with the cheapest primitive the filesystems accept
+std::expected<copy_method, std::error_code> copy_into(int in, const struct stat &st, int out) {
+    // Files that report no size (procfs and friends) can only be read to EOF
+    auto size = static_cast<std::size_t>(st.st_size);
+    if (S_ISREG(st.st_mode) && size != 0) {
+        if (::ioctl(out, FICLONE, in) == 0) {
+            return copy_method::reflink;
+        }
+
+        switch (copy_in_kernel(size, [&](std::size_t n) { return ::copy_file_range(in, nullptr, out, nullptr, n, 0); })) {
+        case step_result::done: return copy_method::copy_file_range;
+        case step_result::failed: return std::unexpected(last_error());
+        case step_result::unsupported: break;
+        }
+
+        switch (copy_in_kernel(size, [&](std::size_t n) { return ::sendfile(out, in, nullptr, n); })) {
+        case step_result::done: return copy_method::sendfile;
+        case step_result::failed: return std::unexpected(last_error());
+        case step_result::unsupported: break;
+        }
+    }
+
+    if (auto copied = copy_buffered(in, out); !copied) {
+        return std::unexpected(copied.error());
+    }
+    return copy_method::buffered;
+}
+
+} // namespace
+#endif
+
+std::expected<copy_method, std::error_code> copy_file_contents(const fs::path &from, const fs::path &to) {
+#if defined(__linux__)
+    FdGuard in{::open(from.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (in.fd < 0) {
+        return std::unexpected(last_error());
+    }
+    struct stat st {};
+    if (::fstat(in.fd, &st) != 0) {
+        return std::unexpected(last_error());
+    }
+
+    // Truncated only once it is known not to be the source, which O_TRUNC would have emptied
+    FdGuard     out{::open(to.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0666)};
+    struct stat out_st {};
+    if (out.fd < 0 || ::fstat(out.fd, &out_st) != 0) {
+        return std::unexpected(last_error());
+    }
+    if (out_st.st_dev == st.st_dev && out_st.st_ino == st.st_ino) {
+        return std::unexpected(std::make_error_code(std::errc::file_exists)); // As fs::copy_file reports it
+    }
+    if (S_ISREG(out_st.st_mode) && ::ftruncate(out.fd, 0) != 0) {
+        return std::unexpected(last_error());
+    }
+
+    auto copied = copy_into(in.fd, st, out.fd);
+
+    // Closing can report a failed write-back (NFS, quotas), which makes the copy fail too
+    if (::close(std::exchange(out.fd, -1)) != 0 && copied) {
+        return std::unexpected(last_error());
+    }
+    return copied;
+#else
+    std::error_code ec;
+    fs::copy_file(from, to, fs::copy_options::overwrite_existing, ec);
+    if (ec) {
+        return std::unexpected(ec);
+    }
+    return copy_method::buffered;
+#endif
+}
+
+} // namespace cgen
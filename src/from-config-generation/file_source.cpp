@@ -0,0 +1,149 @@
+#include "cgen/file_source.h"
+
+#include "cgen/stats.h"
+
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+namespace cgen {
+namespace {
+
+#if defined(__unix__) || defined(__APPLE__)
+// Closes a descriptor on every return path
+struct FdGuard {
+    int fd;
+    ~FdGuard() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+
+// Read until EOF, for small files and files whose st_size cannot be trusted (e.g. procfs)
+std::expected<std::string, std::error_code> read_all(int fd, std::size_t size_hint) {
+    std::string content;
+    // One byte past the expected size, so reaching EOF at that size does not grow the buffer just to read 0
+    content.resize(size_hint != 0 ? size_hint + 1 : 4096);
+
+    std::size_t filled = 0;
+    for (;;) {
+        if (filled == content.size()) {
+            content.resize(content.size() * 2);
+        }
+        ssize_t count = ::read(fd, content.data() + filled, content.size() - filled);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return std::unexpected(std::error_code(errno, std::generic_category()));
+        }
+        if (count == 0) {
+            break;
+        }
+        filled += static_cast<std::size_t>(count);
+    }
+    content.resize(filled);
+    return content;
+}
+#endif
+
+} // namespace
+
+FileSource::FileSource(FileSource &&other) noexcept
+    : mapped_(std::exchange(other.mapped_, nullptr)), mappedSize_(std::exchange(other.mappedSize_, 0)), buffer_(std::move(other.buffer_)) {
+}
+
+FileSource &FileSource::operator=(FileSource &&other) noexcept {
+    if (this != &other) {
+        release();
+        mapped_     = std::exchange(other.mapped_, nullptr);
+        mappedSize_ = std::exchange(other.mappedSize_, 0);
+        buffer_     = std::move(other.buffer_);
+    }
+    return *this;
+}
+
+FileSource::~FileSource() { release(); }
+
+void FileSource::release() noexcept {
+#if defined(__unix__) || defined(__APPLE__)
+    if (mapped_) {
+        ::munmap(mapped_, mappedSize_);
+    }
+#endif
+    mapped_     = nullptr;
+    mappedSize_ = 0;
+}
+
+FileSource FileSource::fromString(std::string content) {
+    FileSource source;
+    source.buffer_ = std::move(content);
+    return source;
+}
+
+std::expected<FileSource, std::error_code> FileSource::open(const fs::path &path) { return load(path, true); }
+
+std::expected<FileSource, std::error_code> FileSource::read(const fs::path &path) { return load(path, false); }
+
+std::expected<FileSource, std::error_code> FileSource::load(const fs::path &path, bool allow_mapping) {
+    ScopedTimer timer(stats_phase::read);
+#if defined(__unix__) || defined(__APPLE__)
+    FdGuard guard{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (guard.fd < 0) {
+        return std::unexpected(std::error_code(errno, std::generic_category()));
+    }
+
+    struct stat st {};
+    if (::fstat(guard.fd, &st) != 0) {
+        return std::unexpected(std::error_code(errno, std::generic_category()));
+    }
+
+    auto size = static_cast<std::size_t>(st.st_size);
+    if (allow_mapping && S_ISREG(st.st_mode) && size >= mmap_threshold) {
+        void *mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, guard.fd, 0);
+        if (mapped != MAP_FAILED) {
+            ::madvise(mapped, size, MADV_SEQUENTIAL); // One front-to-back pass per compile
+            FileSource source;
+            source.mapped_     = mapped;
+            source.mappedSize_ = size;
+            count_stat(stats_counter::files_read);
+            count_stat(stats_counter::bytes_read, size);
+            return source;
+        }
+        // The filesystem cannot map this file, read it instead
+    }
+
+    auto content = read_all(guard.fd, S_ISREG(st.st_mode) ? size : 0);
+    if (!content) {
+        return std::unexpected(content.error());
+    }
+    count_stat(stats_counter::files_read);
+    count_stat(stats_counter::bytes_read, content->size());
+    return fromString(std::move(content.value()));
+#else
+    (void)allow_mapping;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return std::unexpected(std::make_error_code(std::errc::no_such_file_or_directory));
+    }
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (in.bad()) {
+        return std::unexpected(std::make_error_code(std::errc::io_error));
+    }
+    count_stat(stats_counter::files_read);
+    count_stat(stats_counter::bytes_read, content.size());
+    return fromString(std::move(content));
+#endif
+}
+
+} // namespace cgen
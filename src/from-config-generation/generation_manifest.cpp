@@ -0,0 +1,214 @@
+#include "cgen/generation_manifest.h"
+
+#include "cgen/file_source.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <fmt/core.h>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace cgen {
+namespace {
+
+constexpr const char *manifest_file_name = ".cgen-manifest";
+constexpr const char *manifest_header    = "cgen-manifest 1";
+
+constexpr std::uint64_t prime1 = 11400714785074694791ULL;
+constexpr std::uint64_t prime2 = 14029467366897019727ULL;
+constexpr std::uint64_t prime3 = 1609587929392839161ULL;
+constexpr std::uint64_t prime4 = 9650029242287828579ULL;
+constexpr std::uint64_t prime5 = 2870177450012600261ULL;
+
+// Little-endian loads, so digests stored in a manifest do not depend on the host
+std::uint64_t read64(const char *p) {
+    std::uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return std::endian::native == std::endian::little ? value : std::byteswap(value);
+}
+
+std::uint32_t read32(const char *p) {
+    std::uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return std::endian::native == std::endian::little ? value : std::byteswap(value);
+}
+
+std::uint64_t mix_round(std::uint64_t acc, std::uint64_t input) { return std::rotl(acc + input * prime2, 31) * prime1; }
+
+std::uint64_t merge_round(std::uint64_t acc, std::uint64_t lane) { return (acc ^ mix_round(0, lane)) * prime1 + prime4; }
+
+} // namespace
+
+ContentHasher::ContentHasher() : lanes_{prime1 + prime2, prime2, 0, 0 - prime1} {}
+
+void ContentHasher::consumeStripe(const char *stripe) {
+    for (std::size_t i = 0; i < lanes_.size(); ++i) {
+        lanes_[i] = mix_round(lanes_[i], read64(stripe + 8 * i));
+    }
+}
+
+void ContentHasher::update(std::string_view data) {
+    total_ += data.size();
+
+    const char *p   = data.data();
+    const char *end = p + data.size();
+    if (buffered_ > 0) {
+        std::size_t take = std::min<std::size_t>(buffer_.size() - buffered_, data.size());
+        std::memcpy(buffer_.data() + buffered_, p, take);
+        buffered_ += take;
+        p += take;
+        if (buffered_ < buffer_.size()) {
+            return;
+        }
+        consumeStripe(buffer_.data());
+        buffered_ = 0;
+    }
+    for (; end - p >= static_cast<std::ptrdiff_t>(buffer_.size()); p += buffer_.size()) {
+        consumeStripe(p);
+    }
+    std::memcpy(buffer_.data(), p, static_cast<std::size_t>(end - p));
+    buffered_ = static_cast<std::size_t>(end - p);
+}
+
+std::uint64_t ContentHasher::digest() const {
+    std::uint64_t hash;
+    if (total_ >= buffer_.size()) {
+        hash = std::rotl(lanes_[0], 1) + std::rotl(lanes_[1], 7) + std::rotl(lanes_[2], 12) + std::rotl(lanes_[3], 18);
+        for (auto lane : lanes_) {
+            hash = merge_round(hash, lane);
+        }
+    } else {
+        hash = prime5;
+    }
+    hash += total_;
+
+    const char *p   = buffer_.data();
+    const char *end = p + buffered_;
+    for (; end - p >= 8; p += 8) {
+        hash = std::rotl(hash ^ mix_round(0, read64(p)), 27) * prime1 + prime4;
+    }
+    if (end - p >= 4) {
+        hash = std::rotl(hash ^ (static_cast<std::uint64_t>(read32(p)) * prime1), 23) * prime2 + prime3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        hash = std::rotl(hash ^ (static_cast<std::uint64_t>(static_cast<unsigned char>(*p)) * prime5), 11) * prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+std::uint64_t hash_content(std::string_view data) {
+    ContentHasher hasher;
+    hasher.update(data);
+    return hasher.digest();
+}
+
+std::expected<std::uint64_t, std::error_code> hash_file(const fs::path &path) {
+    auto source_or = FileSource::open(path);
+    if (!source_or) {
+        return std::unexpected(source_or.error());
+    }
+    return hash_content(source_or->view());
+}
+
+std::optional<OutputStamp> output_stamp(const fs::path &path) {
+    std::error_code ec;
+    auto            status = fs::status(path, ec);
+    if (ec || !fs::is_regular_file(status)) {
+        return std::nullopt;
+    }
+    auto size  = fs::file_size(path, ec);
+    auto mtime = ec ? fs::file_time_type{} : fs::last_write_time(path, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    auto mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+    return OutputStamp{size, static_cast<std::int64_t>(mtime_ns)};
+}
+
+fs::path GenerationManifest::manifestPath(const fs::path &output_dir) { return output_dir / manifest_file_name; }
+
+GenerationManifest GenerationManifest::load(const fs::path &output_dir) {
+    GenerationManifest manifest;
+    std::ifstream      in(manifestPath(output_dir));
+    std::string        line;
+    if (!in || !std::getline(in, line) || line != manifest_header) {
+        return manifest;
+    }
+
+    // F <template hash> <values hash> <output hash> <size> <mtime> <relative path, to the end of the line>
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string        tag;
+        ManifestEntry      entry;
+        if (!(fields >> tag >> std::hex >> entry.template_hash >> entry.values_hash >> entry.output_hash >> std::dec >> entry.stamp.size >>
+              entry.stamp.mtime_ns) ||
+            tag != "F" || fields.get() != ' ') {
+            return GenerationManifest{}; // A damaged manifest is no better than none
+        }
+        std::string relative;
+        std::getline(fields, relative);
+        if (relative.empty()) {
+            return GenerationManifest{};
+        }
+        manifest.entries_[relative] = entry;
+    }
+    return manifest;
+}
+
+std::expected<void, std::error_code> GenerationManifest::save(const fs::path &output_dir) const {
+    fs::path path      = manifestPath(output_dir);
+    fs::path temp_path = path;
+    temp_path += fmt::format(".tmp{}", std::random_device{}());
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        if (!out) {
+            return std::unexpected(std::make_error_code(std::errc::io_error));
+        }
+        out << manifest_header << '\n';
+        for (const auto &[relative, entry] : entries_) {
+            out << fmt::format("F {:016x} {:016x} {:016x} {} {} {}\n", entry.template_hash, entry.values_hash, entry.output_hash,
+                               entry.stamp.size, entry.stamp.mtime_ns, relative);
+        }
+        if (!out.flush()) {
+            out.close();
+            std::error_code ec;
+            fs::remove(temp_path, ec);
+            return std::unexpected(std::make_error_code(std::errc::io_error));
+        }
+    }
+    std::error_code ec;
+    fs::rename(temp_path, path, ec);
+    if (ec) {
+        std::error_code ignored;
+        fs::remove(temp_path, ignored);
+        return std::unexpected(ec);
+    }
+    return {};
+}
+
+const ManifestEntry *GenerationManifest::find(const fs::path &relative) const {
+    auto it = entries_.find(relative.generic_string());
+    return it == entries_.end() ? nullptr : &it->second;
+}
+
+void GenerationManifest::record(const fs::path &relative, const ManifestEntry &entry) {
+    std::string key = relative.generic_string();
+    if (key.empty() || key.find('\n') != std::string::npos) {
+        return; // Cannot be stored on one line, such a file is simply regenerated every time
+    }
+    entries_[std::move(key)] = entry;
+}
+
+void GenerationManifest::forget(const fs::path &relative) { entries_.erase(relative.generic_string()); }
+
+} // namespace cgen
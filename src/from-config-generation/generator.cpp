@@ -0,0 +1,811 @@
+#include "cgen/generator.h"
+
+#include "cgen/file_copy.h"
+#include "cgen/file_source.h"
+#include "cgen/staging.h"
+#include "cgen/stats.h"
+#include "cgen/template_index.h"
+#include "cgen/template_layers.h"
+#include "cgen/trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fmt/core.h>
+#include <fstream>
+#include <unordered_set>
+
+namespace cgen {
+namespace {
+
+// Rendered output is collected into chunks of this size before it is written
+constexpr std::size_t write_chunk_size = 64 * 1024;
+
+// A message printed once generation finishes, in the order it was planned
+struct Report {
+    std::string message;
+    bool        is_error = false;
+};
+
+void print_reports(const std::vector<Report> &reports, bool errors_only = false) {
+    for (const auto &report : reports) {
+        if (!report.message.empty() && (report.is_error || !errors_only)) {
+            fmt::print(report.is_error ? stderr : stdout, "{}", report.message);
+        }
+    }
+}
+
+// Compile an entry name that contains placeholders, other names are used as they are
+std::optional<CompiledTemplate> compile_name(std::string_view name, const PlaceholderProcessor &processor, PreparedTemplate &prepared) {
+    if (!processor.scanner().next(name, 0)) {
+        return std::nullopt;
+    }
+    prepared.templated_names = true;
+    return processor.compile(std::string(name));
+}
+
+// Record the output directories in pre-order and the files directly beneath each of them
+void plan_directory(const std::shared_ptr<Directory> &dir_entry, const fs::path &relative_parent, std::size_t parent,
+                    const PlaceholderProcessor &processor, PreparedTemplate &prepared) {
+    // The virtual "." directory means files/dirs are at the current level
+    bool     is_virtual = dir_entry->name == ".";
+    fs::path relative   = is_virtual ? relative_parent : relative_parent / dir_entry->name;
+
+    std::size_t index = prepared.directories.size();
+    prepared.directories.push_back({relative, parent, prepared.files.size(), dir_entry->files.size(),
+                                    is_virtual ? std::nullopt : compile_name(dir_entry->name, processor, prepared)});
+
+    for (const auto &file_name : dir_entry->files) {
+        // dir_entry->path is the canonical path to the source directory of this entry
+        auto name_template = compile_name(file_name, processor, prepared);
+        prepared.files.push_back({dir_entry->path / file_name, relative / file_name, std::nullopt, std::move(name_template)});
+    }
+
+    for (const auto &sub_dir_entry : dir_entry->directories) {
+        plan_directory(sub_dir_entry, relative, index, processor, prepared);
+    }
+}
+
+// Same as plan_directory for a flat tree: nodes are already in pre-order, so node i becomes directory i
+void plan_tree(const DirectoryTree &tree, const PlaceholderProcessor &processor, PreparedTemplate &prepared) {
+    prepared.directories.reserve(tree.nodes().size());
+    prepared.files.reserve(tree.files().size());
+
+    for (std::size_t i = 0; i < tree.nodes().size(); ++i) {
+        const auto &node   = tree.nodes()[i];
+        std::size_t parent = node.parent == DirectoryTree::no_parent ? PreparedDirectory::no_parent : node.parent;
+
+        fs::path                        relative; // Empty for the root, whose files are at the top level of the project
+        std::optional<CompiledTemplate> name;
+        if (parent != PreparedDirectory::no_parent) {
+            relative = prepared.directories[parent].relative / tree.name(node.name);
+            name     = compile_name(tree.name(node.name), processor, prepared);
+        }
+
+        prepared.directories.push_back({relative, parent, prepared.files.size(), node.file_count, std::move(name)});
+
+        fs::path source_dir = tree.rootPath() / relative;
+        for (std::size_t f = node.first_file; f < node.first_file + node.file_count; ++f) {
+            std::string_view file_name     = tree.name(tree.files()[f]);
+            auto             name_template = compile_name(file_name, processor, prepared);
+            std::uint32_t    layer         = tree.fileLayer(f); // Files of a composed tree may come from an overlay
+            fs::path         source = layer == 0 ? source_dir / file_name : tree.layerRoot(layer) / relative / file_name;
+            prepared.files.push_back({std::move(source), relative / file_name, std::nullopt, std::move(name_template)});
+        }
+    }
+}
+
+// Render a templated entry name, empty if the values do not turn it into a single path component
+std::optional<std::string> render_name(const CompiledTemplate &name, const SymbolValues &values) {
+    std::string rendered = name.render(values);
+    if (!is_single_path_component(rendered)) {
+        return std::nullopt;
+    }
+    return rendered;
+}
+
+// Compile a template file from contents that were already read, or report why they could not be
+void compile_source(PreparedFile &file, std::expected<FileSource, std::error_code> source_or, const PlaceholderProcessor &processor,
+                    Report &report) {
+    try {
+        if (!source_or) {
+            report = {fmt::format("Warning: Could not open template file for reading: {} ({})\n", file.source.string(),
+                                  source_or.error().message()),
+                      true};
+            return;
+        }
+        file.content = processor.compile(std::move(source_or.value()));
+    } catch (const std::exception &e) {
+        report = {fmt::format("Error reading template file {}: {}\n", file.source.string(), e.what()), true};
+    }
+}
+
+void compile_file(PreparedFile &file, const PlaceholderProcessor &processor, bool resident, Report &report) {
+    TraceScope trace("prepare file", "template", file.source);
+    try {
+        compile_source(file, resident ? FileSource::read(file.source) : FileSource::open(file.source), processor, report);
+    } catch (const std::exception &e) {
+        report = {fmt::format("Error reading template file {}: {}\n", file.source.string(), e.what()), true};
+    }
+}
+
+// Render `file` into memory for a batched write, verbatim files are written from their source as they are
+void render_to_buffer(const PreparedFile &file, const SymbolValues &values, std::string &buffer, Report &report) {
+    TraceScope trace("render file", "output", file.relative);
+    try {
+        if (file.content->rendersVerbatim(values)) {
+            return;
+        }
+        ScopedTimer timer(stats_phase::render);
+        file.content->render(values, buffer); // Sized exactly, in place of whatever the buffer held before
+    } catch (const std::exception &e) {
+        report = {fmt::format("Error rendering file {}: {}\n", file.source.string(), e.what()), true};
+    }
+}
+
+/**
+ * Render `file` into `destination`, feeding the bytes written to `hasher` if one is given. A
+ * resident template writes verbatim files from its own copy, which is what the hash describes.
+ */
+void render_file(const PreparedFile &file, const fs::path &destination, const SymbolValues &values, bool resident, Report &report,
+                 ContentHasher *hasher = nullptr) {
+    TraceScope trace("write file", "output", destination);
+    try {
+        // Nothing to substitute: let the kernel copy the bytes instead of rendering them
+        if (!resident && file.content->rendersVerbatim(values)) {
+            ScopedTimer timer(stats_phase::copy);
+            if (hasher) {
+                hasher->update(file.content->source());
+            }
+            auto copied_or = copy_file_contents(file.source, destination);
+            if (!copied_or) {
+                report = {fmt::format("Error: Could not copy {} to {}: {}\n", file.source.string(), destination.string(),
+                                      copied_or.error().message()),
+                          true};
+                return;
+            }
+            count_stat(stats_counter::files_written);
+            count_stat(stats_counter::bytes_written, file.content->source().size());
+            report = {fmt::format("Generated file: {}\n", destination.string()), false};
+            return;
+        }
+
+        std::ofstream out_file_stream;
+        {
+            ScopedTimer timer(stats_phase::write);
+            out_file_stream.open(destination);
+        }
+        if (!out_file_stream) {
+            report = {fmt::format("Error: Could not open output file for writing: {}\n", destination.string()), true};
+            return;
+        }
+
+        // Stream segments into the file a chunk at a time, the rendered output is never held in memory as a whole
+        std::uint64_t written = 0;
+        {
+            ScopedTimer render_timer(stats_phase::render);
+            auto        write_out = [&out_file_stream, &render_timer](std::string_view bytes) {
+                auto start = std::chrono::steady_clock::now();
+                {
+                    ScopedTimer timer(stats_phase::write);
+                    out_file_stream.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+                }
+                render_timer.exclude(std::chrono::steady_clock::now() - start);
+            };
+
+            std::string chunk;
+            chunk.reserve(write_chunk_size);
+            file.content->render(values, [&chunk, &written, &write_out, hasher](std::string_view piece) {
+                written += piece.size();
+                if (hasher) {
+                    hasher->update(piece);
+                }
+                if (chunk.size() + piece.size() > write_chunk_size) {
+                    write_out(chunk);
+                    chunk.clear();
+                }
+                if (piece.size() >= write_chunk_size) {
+                    write_out(piece); // e.g. a long literal span, written without copying it
+                } else {
+                    chunk += piece;
+                }
+            });
+            write_out(chunk);
+        }
+        {
+            ScopedTimer timer(stats_phase::write);
+            out_file_stream.close();
+        }
+        if (!out_file_stream) {
+            report = {fmt::format("Error: Could not write output file: {}\n", destination.string()), true};
+            return;
+        }
+        count_stat(stats_counter::files_written);
+        count_stat(stats_counter::bytes_written, written);
+        report = {fmt::format("Generated file: {}\n", destination.string()), false};
+
+    } catch (const std::exception &e) {
+        report = {fmt::format("Error processing file {} to {}: {}\n", file.source.string(), destination.string(), e.what()), true};
+    }
+}
+
+// Hash of the placeholder names a template uses and the values bound to them, in slot order
+std::uint64_t hash_values(const CompiledTemplate &content, const SymbolValues &values) {
+    ContentHasher hasher;
+    for (std::size_t slot = 0; slot < content.slots().size(); ++slot) {
+        std::string_view value = values.get(content.symbols()[slot]);
+        hasher.update(content.slots()[slot]);
+        if (!values.contains(content.symbols()[slot])) {
+            hasher.update(std::string_view("\0u", 2)); // Unbound, the placeholder is kept verbatim
+            continue;
+        }
+        // The value is length-prefixed, so no two bindings feed the hasher the same bytes
+        hasher.update(fmt::format("{}{}:", '\0', value.size()));
+        hasher.update(value);
+    }
+    return hasher.digest();
+}
+
+/**
+ * Bring one output up to date: skip it if its inputs and the file on disk match `previous`, leave
+ * it untouched if rendering would produce the same bytes, and write it otherwise. `entry` receives
+ * the manifest entry describing the output afterwards, and stays empty if the file failed.
+ */
+void update_file(const PreparedFile &file, const fs::path &destination, const SymbolValues &values, bool resident,
+                 const ManifestEntry *previous, std::optional<ManifestEntry> &entry, Report &report) {
+    TraceScope trace("update file", "output", destination);
+    try {
+        ManifestEntry current;
+        current.template_hash = hash_content(file.content->source());
+        current.values_hash   = hash_values(*file.content, values);
+
+        auto stamp = output_stamp(destination);
+        if (previous && stamp && previous->template_hash == current.template_hash && previous->values_hash == current.values_hash) {
+            // Same inputs, so the output is still valid unless someone changed the file since
+            if (*stamp == previous->stamp || hash_file(destination) == previous->output_hash) {
+                current.output_hash = previous->output_hash;
+                current.stamp       = *stamp;
+                entry               = current;
+                report              = {fmt::format("Unchanged file: {}\n", destination.string()), false};
+                count_stat(stats_counter::files_unchanged);
+                return;
+            }
+        }
+
+        // Render against the existing output first, identical bytes are not written again
+        if (stamp) {
+            if (auto existing_or = FileSource::open(destination)) {
+                std::string_view existing  = existing_or->view();
+                std::size_t      compared  = 0;
+                bool             identical = true;
+                ContentHasher    hasher;
+                file.content->render(values, [&](std::string_view piece) {
+                    hasher.update(piece);
+                    identical = identical && compared + piece.size() <= existing.size() &&
+                                existing.compare(compared, piece.size(), piece) == 0;
+                    compared += piece.size();
+                });
+                if (identical && compared == existing.size()) {
+                    current.output_hash = hasher.digest();
+                    current.stamp       = *stamp;
+                    entry               = current;
+                    report              = {fmt::format("Unchanged file: {}\n", destination.string()), false};
+                    count_stat(stats_counter::files_unchanged);
+                    return;
+                }
+            }
+        }
+
+        ContentHasher hasher;
+        render_file(file, destination, values, resident, report, &hasher);
+        if (report.is_error) {
+            return;
+        }
+        if (auto written = output_stamp(destination)) {
+            current.output_hash = hasher.digest();
+            current.stamp       = *written;
+            entry               = current;
+        }
+    } catch (const std::exception &e) {
+        report = {fmt::format("Error processing file {} to {}: {}\n", file.source.string(), destination.string(), e.what()), true};
+    }
+}
+
+// A ring for the io_uring backend; none for the blocking one, or where io_uring is unavailable (e.g. forbidden by seccomp)
+std::optional<IoRing> open_ring(io_backend io) {
+    if (io != io_backend::io_uring) {
+        return std::nullopt;
+    }
+    auto ring_or = IoRing::create();
+    if (!ring_or) {
+        return std::nullopt;
+    }
+    return std::move(ring_or.value());
+}
+
+/**
+ * Read the given files through `ring` in batches and compile each batch on the pool, which works
+ * on one batch while the ring reads the next.
+ */
+void read_and_compile_batches(PreparedTemplate &prepared, const std::vector<std::size_t> &files, const PlaceholderProcessor &processor,
+                              ThreadPool &pool, IoRing &ring, std::vector<Report> &reports) {
+    std::vector<fs::path> paths;
+    for (std::size_t begin = 0; begin < files.size(); begin += ring.batchSize()) {
+        std::size_t end = std::min(begin + ring.batchSize(), files.size());
+        paths.clear();
+        for (std::size_t i = begin; i < end; ++i) {
+            paths.push_back(prepared.files[files[i]].source);
+        }
+
+        std::vector<std::expected<std::string, std::error_code>> contents;
+        {
+            TraceScope  trace("read batch", "template");
+            ScopedTimer timer(stats_phase::read);
+            contents = ring.readFiles(paths);
+        }
+        for (std::size_t i = begin; i < end; ++i) {
+            auto content_or = std::move(contents[i - begin]);
+            if (content_or) {
+                count_stat(stats_counter::files_read);
+                count_stat(stats_counter::bytes_read, content_or->size());
+            }
+            pool.submit([&prepared, &processor, &reports, &files, i, content_or = std::move(content_or)]() mutable {
+                auto      &file = prepared.files[files[i]];
+                TraceScope trace("prepare file", "template", file.source);
+                file.content.reset();
+                if (content_or) {
+                    compile_source(file, FileSource::fromString(std::move(content_or.value())), processor, reports[i]);
+                } else {
+                    compile_source(file, std::unexpected(content_or.error()), processor, reports[i]);
+                }
+            });
+        }
+    }
+    pool.wait();
+}
+
+// Read and compile the given planned files on the pool, then report unreadable files once
+std::expected<void, generate_status> compile_files(PreparedTemplate &prepared, const std::vector<std::size_t> &files,
+                                                   const PlaceholderProcessor &processor, ThreadPool &pool,
+                                                   io_backend io = io_backend::blocking) {
+    std::vector<Report> reports(files.size());
+    try {
+        if (auto ring = open_ring(io)) {
+            read_and_compile_batches(prepared, files, processor, pool, *ring, reports);
+        } else {
+            for (std::size_t i = 0; i < files.size(); ++i) {
+                pool.submit([&prepared, &processor, &reports, &files, i] {
+                    auto &file = prepared.files[files[i]];
+                    file.content.reset();
+                    compile_file(file, processor, prepared.resident, reports[i]);
+                });
+            }
+            pool.wait();
+        }
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "Error preparing template: {}\n", e.what());
+        return std::unexpected(generate_status::error);
+    }
+
+    print_reports(reports);
+    return {};
+}
+
+std::expected<void, generate_status> compile_files(PreparedTemplate &prepared, const PlaceholderProcessor &processor, ThreadPool &pool,
+                                                   io_backend io) {
+    std::vector<std::size_t> files(prepared.files.size());
+    for (std::size_t f = 0; f < files.size(); ++f) {
+        files[f] = f;
+    }
+    return compile_files(prepared, files, processor, pool, io);
+}
+
+/**
+ * Render the files of `tasks` into memory on the pool and write them to `destinations` through
+ * `ring` in batches, the pool renders the next batch while the ring writes the current one.
+ * Two batches' worth of buffers are reused as arenas, so rendering stops allocating once each has
+ * grown to the files it holds.
+ *
+ * With `entries`, each file's manifest entry is hashed on the pool along with its render and
+ * completed with the output's stamp once its batch is written; it stays empty if the file failed.
+ */
+void render_and_write_batches(const PreparedTemplate &prepared, const std::vector<std::size_t> &tasks,
+                              const std::vector<fs::path> &destinations, const SymbolValues &values, ThreadPool &pool, IoRing &ring,
+                              std::vector<Report> &reports, const std::vector<std::size_t> &file_reports,
+                              std::vector<std::optional<ManifestEntry>> *entries) {
+    std::size_t              batch = ring.batchSize();
+    std::vector<std::string> buffers(std::min(2 * batch, tasks.size())); // Task t renders into buffers[t % buffers.size()]
+    auto                     contents_of = [&](std::size_t t) {
+        const auto &content = *prepared.files[tasks[t]].content;
+        return content.rendersVerbatim(values) ? content.source() : std::string_view(buffers[t % buffers.size()]);
+    };
+    auto render_batch = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; ++t) {
+            pool.submit([&prepared, &values, &tasks, &buffers, &reports, &file_reports, &contents_of, entries, t] {
+                std::size_t f      = tasks[t];
+                Report     &report = reports[file_reports[f]];
+                render_to_buffer(prepared.files[f], values, buffers[t % buffers.size()], report);
+                if (entries && !report.is_error) {
+                    const auto   &content = *prepared.files[f].content;
+                    ManifestEntry entry;
+                    entry.template_hash = hash_content(content.source());
+                    entry.values_hash   = hash_values(content, values);
+                    entry.output_hash   = hash_content(contents_of(t));
+                    (*entries)[f]       = entry;
+                }
+            });
+        }
+    };
+
+    render_batch(0, std::min(batch, tasks.size()));
+    pool.wait();
+
+    std::vector<fs::path>         paths;
+    std::vector<std::string_view> contents;
+    std::vector<std::size_t>      written;
+    for (std::size_t begin = 0; begin < tasks.size(); begin += batch) {
+        std::size_t end = std::min(begin + batch, tasks.size());
+        render_batch(end, std::min(end + batch, tasks.size()));
+
+        paths.clear();
+        contents.clear();
+        written.clear();
+        for (std::size_t t = begin; t < end; ++t) {
+            if (reports[file_reports[tasks[t]]].is_error) {
+                continue; // Rendering failed
+            }
+            paths.push_back(destinations[t]);
+            contents.push_back(contents_of(t));
+            written.push_back(t);
+        }
+
+        std::vector<std::error_code> errors;
+        {
+            TraceScope  trace("write batch", "output");
+            ScopedTimer timer(stats_phase::write);
+            errors = ring.writeFiles(paths, contents);
+        }
+        for (std::size_t i = 0; i < written.size(); ++i) {
+            std::size_t f      = tasks[written[i]];
+            Report     &report = reports[file_reports[f]];
+            if (entries && (*entries)[f]) {
+                auto stamp = errors[i] ? std::nullopt : output_stamp(paths[i]);
+                if (stamp) {
+                    (*entries)[f]->stamp = *stamp;
+                } else {
+                    (*entries)[f].reset();
+                }
+            }
+            if (errors[i]) {
+                report = {fmt::format("Error: Could not write output file: {} ({})\n", paths[i].string(), errors[i].message()), true};
+                continue;
+            }
+            count_stat(stats_counter::files_written);
+            count_stat(stats_counter::bytes_written, contents[i].size());
+            report = {fmt::format("Generated file: {}\n", paths[i].string()), false};
+        }
+        pool.wait();
+    }
+}
+
+// Generate every file of the template, or only those marked in `selected`
+std::expected<void, generate_status> generate_files(const PreparedTemplate &prepared, const fs::path &output_base_path,
+                                                    const std::unordered_map<std::string, std::string> &value_map, ThreadPool &pool,
+                                                    GenerationManifest *manifest, const std::vector<bool> *selected, bool report_files,
+                                                    io_backend io = io_backend::blocking) {
+    ScopedTimer timer(stats_phase::generate);
+
+    // Bound once per project, every file then looks its placeholders up by symbol id
+    SymbolValues values = prepared.symbols->bind(value_map);
+
+    // One report slot per directory followed by one per file in it, i.e. tree order
+    std::vector<Report>                       reports;
+    std::vector<std::size_t>                  file_reports(prepared.files.size(), 0);
+    std::vector<bool>                         created(prepared.directories.size(), false);
+    std::vector<std::size_t>                  tasks;
+    std::vector<std::optional<ManifestEntry>> entries(manifest ? prepared.files.size() : 0);
+
+    // Output paths for this project's values, only needed when some names contain placeholders
+    std::vector<fs::path>           directory_paths(prepared.templated_names ? prepared.directories.size() : 0);
+    std::vector<fs::path>           file_paths(prepared.templated_names ? prepared.files.size() : 0);
+    std::unordered_set<std::string> claimed_paths;
+    auto file_path = [&prepared, &file_paths](std::size_t f) -> const fs::path & {
+        return prepared.templated_names ? file_paths[f] : prepared.files[f].relative;
+    };
+
+    try {
+        // 1. Directories first, so every file task finds its parent in place
+        for (std::size_t i = 0; i < prepared.directories.size(); ++i) {
+            const auto &dir = prepared.directories[i];
+            if (dir.parent != PreparedDirectory::no_parent && !created[dir.parent]) {
+                continue; // Its parent could not be created
+            }
+
+            if (prepared.templated_names && !dir.relative.empty()) {
+                // Only this name is rendered, the parent's output path is already resolved
+                fs::path parent_path = dir.parent == PreparedDirectory::no_parent ? fs::path{} : directory_paths[dir.parent];
+                if (!dir.name) {
+                    directory_paths[i] = parent_path / dir.relative.filename();
+                } else if (auto rendered = render_name(*dir.name, values)) {
+                    directory_paths[i] = parent_path / *rendered;
+                } else {
+                    reports.push_back({fmt::format("Error: Placeholder values turn directory {} into an invalid name, skipping it\n",
+                                                   dir.relative.string()),
+                                       true});
+                    continue;
+                }
+            }
+            const fs::path &relative = prepared.templated_names ? directory_paths[i] : dir.relative;
+
+            fs::path output_dir_path = output_base_path / relative;
+            if (!relative.empty() && !fs::exists(output_dir_path)) {
+                if (!fs::create_directories(output_dir_path)) {
+                    reports.push_back({fmt::format("Error: Could not create directory: {}\n", output_dir_path.string()), true});
+                    continue;
+                }
+                reports.push_back({fmt::format("Created directory: {}\n", output_dir_path.string()), false});
+            }
+            created[i] = true;
+
+            for (std::size_t f = dir.first_file; f < dir.first_file + dir.file_count; ++f) {
+                const auto &file = prepared.files[f];
+                if (!file.content) {
+                    continue;
+                }
+                if (prepared.templated_names) {
+                    auto rendered = file.name ? render_name(*file.name, values) : file.relative.filename().string();
+                    if (!rendered) {
+                        reports.push_back({fmt::format("Error: Placeholder values turn file {} into an invalid name, skipping it\n",
+                                                       file.relative.string()),
+                                           true});
+                        continue;
+                    }
+                    file_paths[f] = relative / *rendered;
+                    // Two template files rendered to one path would be written concurrently
+                    if (!claimed_paths.insert(file_paths[f].generic_string()).second) {
+                        reports.push_back({fmt::format("Error: {} is also generated from another template file, skipping {}\n",
+                                                       (output_base_path / file_paths[f]).string(), file.source.string()),
+                                           true});
+                        continue;
+                    }
+                }
+                if (selected && !(*selected)[f]) {
+                    continue; // Path still claimed above, so clashes are reported the same way as in a full generation
+                }
+                file_reports[f] = reports.size();
+                reports.emplace_back();
+                tasks.push_back(f);
+            }
+        }
+
+        // 2. Render and write every file as an independent task, or in batches through io_uring
+        std::optional<IoRing> ring = open_ring(io);
+        if (ring) {
+            std::vector<fs::path> destinations;
+            destinations.reserve(tasks.size());
+            for (std::size_t f : tasks) {
+                destinations.push_back(output_base_path / file_path(f));
+            }
+            render_and_write_batches(prepared, tasks, destinations, values, pool, *ring, reports, file_reports,
+                                     manifest ? &entries : nullptr);
+            tasks.clear();
+        }
+        for (std::size_t f : tasks) {
+            pool.submit([&prepared, &output_base_path, &values, &reports, &file_reports, &entries, &file_path, manifest, f] {
+                const auto     &file     = prepared.files[f];
+                const fs::path &relative = file_path(f);
+                if (manifest) {
+                    // Lookups only, the manifest is not modified until every task has finished
+                    update_file(file, output_base_path / relative, values, prepared.resident, manifest->find(relative), entries[f],
+                                reports[file_reports[f]]);
+                } else {
+                    render_file(file, output_base_path / relative, values, prepared.resident, reports[file_reports[f]]);
+                }
+            });
+        }
+        pool.wait();
+    } catch (const std::exception &e) {
+        print_reports(reports, !report_files);
+        fmt::print(stderr, "Error generating project into {}: {}\n", output_base_path.string(), e.what());
+        return std::unexpected(generate_status::error);
+    }
+
+    // 3. Report in tree order, independent of task completion order
+    print_reports(reports, !report_files);
+
+    if (manifest) {
+        if (!selected) {
+            manifest->clear();
+        }
+        for (std::size_t f = 0; f < entries.size(); ++f) {
+            if (entries[f]) {
+                manifest->record(file_path(f), *entries[f]);
+            } else if (selected && (*selected)[f]) {
+                manifest->forget(file_path(f)); // It failed, so its previous output is no longer known to be current
+            }
+        }
+    }
+    return {};
+}
+
+} // namespace
+
+std::expected<DirectoryTree, scan_status> load_template_tree(const std::string &template_name, const std::string &templates_base_dir,
+                                                             const GenerateOptions &options, ThreadPool *pool) {
+    std::optional<ThreadPool> scan_pool;
+    if (!pool && !options.use_index) {
+        pool = &scan_pool.emplace(options.jobs);
+    }
+    auto scan_layer = [&](const std::string &name) -> std::expected<DirectoryTree, scan_status> {
+        if (!options.use_index) {
+            return scan_template_directory(name, templates_base_dir, flat_tree, *pool);
+        }
+        auto index_or = TemplateIndex::open(name, templates_base_dir);
+        if (!index_or) {
+            return std::unexpected(index_or.error());
+        }
+        return index_or->tree();
+    };
+
+    std::vector<std::string> overlays;
+    for (const auto &overlay : options.overlays) {
+        if (overlay != template_name && std::find(overlays.begin(), overlays.end(), overlay) == overlays.end()) {
+            overlays.push_back(overlay);
+        }
+    }
+    std::error_code ec;
+    if (options.common_layer && template_name != common_layer_name &&
+        std::find(overlays.begin(), overlays.end(), common_layer_name) == overlays.end() &&
+        fs::is_directory(fs::path(templates_base_dir) / common_layer_name, ec)) {
+        overlays.push_back(common_layer_name);
+    }
+
+    auto tree_or = scan_layer(template_name);
+    if (!tree_or || overlays.empty()) {
+        return tree_or;
+    }
+    if (overlays.size() + 1 > DirectoryTree::max_layers) {
+        fmt::print(stderr, "Error: A template can be composed with at most {} overlays.\n", DirectoryTree::max_layers - 1);
+        return std::unexpected(scan_status::error);
+    }
+
+    // Scanned once and composed once, so every output file is read from the one layer it comes from
+    std::vector<DirectoryTree> layers;
+    layers.push_back(std::move(tree_or.value()));
+    for (const auto &overlay : overlays) {
+        auto layer_or = scan_layer(overlay);
+        if (!layer_or) {
+            fmt::print(stderr, "Error: Could not scan overlay '{}' of template '{}'.\n", overlay, template_name);
+            return std::unexpected(layer_or.error());
+        }
+        layers.push_back(std::move(layer_or.value()));
+    }
+    return compose_layers(layers);
+}
+
+std::expected<PreparedTemplate, generate_status>
+prepare_template(const std::set<std::shared_ptr<Directory>, CompareDirectoryByName<Directory>> &top_level_entries,
+                 const PlaceholderProcessor &processor, ThreadPool &pool, io_backend io, bool resident) {
+    ScopedTimer      timer(stats_phase::prepare);
+    PreparedTemplate prepared;
+    prepared.symbols  = processor.symbols();
+    prepared.resident = resident;
+    for (const auto &top_level_dir_entry : top_level_entries) {
+        plan_directory(top_level_dir_entry, fs::path{}, PreparedDirectory::no_parent, processor, prepared);
+    }
+
+    auto compiled_or = compile_files(prepared, processor, pool, io);
+    if (!compiled_or) {
+        return std::unexpected(compiled_or.error());
+    }
+    return prepared;
+}
+
+std::expected<PreparedTemplate, generate_status> prepare_template(const DirectoryTree &tree, const PlaceholderProcessor &processor,
+                                                                  ThreadPool &pool, io_backend io, bool resident) {
+    ScopedTimer      timer(stats_phase::prepare);
+    PreparedTemplate prepared;
+    prepared.symbols  = processor.symbols();
+    prepared.resident = resident;
+    plan_tree(tree, processor, prepared);
+
+    auto compiled_or = compile_files(prepared, processor, pool, io);
+    if (!compiled_or) {
+        return std::unexpected(compiled_or.error());
+    }
+    return prepared;
+}
+
+std::expected<void, generate_status> recompile_files(PreparedTemplate &prepared, const std::vector<std::size_t> &files,
+                                                     const PlaceholderProcessor &processor, ThreadPool &pool) {
+    return compile_files(prepared, files, processor, pool);
+}
+
+std::expected<void, generate_status> generate_project(const PreparedTemplate &prepared, const fs::path &output_base_path,
+                                                      const std::unordered_map<std::string, std::string> &values, ThreadPool &pool,
+                                                      GenerationManifest *manifest, bool report_files, io_backend io) {
+    return generate_files(prepared, output_base_path, values, pool, manifest, nullptr, report_files, io);
+}
+
+std::expected<void, generate_status> regenerate_files(const PreparedTemplate &prepared, const std::vector<std::size_t> &files,
+                                                      const fs::path &output_base_path,
+                                                      const std::unordered_map<std::string, std::string> &values, ThreadPool &pool,
+                                                      GenerationManifest *manifest) {
+    std::vector<bool> selected(prepared.files.size(), false);
+    for (std::size_t f : files) {
+        selected[f] = true;
+    }
+    return generate_files(prepared, output_base_path, values, pool, manifest, &selected, true);
+}
+
+std::expected<void, generate_status> generate_incremental(const PreparedTemplate &prepared, const fs::path &output_base_path,
+                                                          const std::unordered_map<std::string, std::string> &values, ThreadPool &pool) {
+    auto manifest     = GenerationManifest::load(output_base_path);
+    auto generated_or = generate_project(prepared, output_base_path, values, pool, &manifest);
+    if (!generated_or) {
+        return generated_or;
+    }
+    if (auto saved_or = manifest.save(output_base_path); !saved_or) {
+        fmt::print(stderr, "Warning: Could not write {}: {}\n", GenerationManifest::manifestPath(output_base_path).string(),
+                   saved_or.error().message());
+    }
+    return {};
+}
+
+std::expected<void, generate_status>
+generate_project(const std::set<std::shared_ptr<Directory>, CompareDirectoryByName<Directory>> &top_level_entries,
+                 const fs::path &output_base_path, const PlaceholderProcessor &processor,
+                 const std::unordered_map<std::string, std::string> &values, const GenerateOptions &options) {
+    ThreadPool pool(options.jobs);
+
+    auto prepared_or = prepare_template(top_level_entries, processor, pool, options.io);
+    if (!prepared_or) {
+        return std::unexpected(prepared_or.error());
+    }
+    if (options.staging) {
+        return generate_staged(prepared_or.value(), output_base_path, values, pool, options.io);
+    }
+    if (options.incremental) {
+        return generate_incremental(prepared_or.value(), output_base_path, values, pool);
+    }
+    return generate_project(prepared_or.value(), output_base_path, values, pool, nullptr, true, options.io);
+}
+
+std::expected<void, generate_status> generate_project(const DirectoryTree &tree, const fs::path &output_base_path,
+                                                      const PlaceholderProcessor &processor,
+                                                      const std::unordered_map<std::string, std::string> &values,
+                                                      const GenerateOptions &options) {
+    ThreadPool pool(options.jobs);
+
+    auto prepared_or = prepare_template(tree, processor, pool, options.io);
+    if (!prepared_or) {
+        return std::unexpected(prepared_or.error());
+    }
+    if (options.staging) {
+        return generate_staged(prepared_or.value(), output_base_path, values, pool, options.io);
+    }
+    if (options.incremental) {
+        return generate_incremental(prepared_or.value(), output_base_path, values, pool);
+    }
+    return generate_project(prepared_or.value(), output_base_path, values, pool, nullptr, true, options.io);
+}
+
+bool is_single_path_component(std::string_view name) {
+    bool has_separator = name.find_first_of(std::string_view("/\\\0", 3)) != std::string_view::npos;
+    return !name.empty() && name != "." && name != ".." && !has_separator && !fs::path(name).has_root_path();
+}
+
+std::expected<fs::path, generate_status> ensure_output_directory(const fs::path &output_dir) {
+    fs::path output_base_path = fs::absolute(output_dir);
+    if (!fs::exists(output_base_path)) {
+        if (!fs::create_directories(output_base_path)) {
+            fmt::print(stderr, "Error: Could not create output directory: {}\n", output_base_path.string());
+            return std::unexpected(generate_status::error);
+        }
+    } else if (!fs::is_directory(output_base_path)) {
+        fmt::print(stderr, "Error: Output path exists but is not a directory: {}\n", output_base_path.string());
+        return std::unexpected(generate_status::error);
+    }
+    return output_base_path;
+}
+
+} // namespace cgen
@@ -0,0 +1,416 @@
+#include "cgen/io_ring.h"
+
+#include <algorithm>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define CGEN_HAVE_IO_URING 1
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace cgen {
+
+#if defined(CGEN_HAVE_IO_URING)
+namespace {
+
+std::error_code errno_code(int error) { return std::error_code(error, std::generic_category()); }
+
+int io_uring_setup(unsigned entries, io_uring_params *params) { return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params)); }
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+// The ring indices are shared with the kernel, which reads and writes them concurrently
+unsigned load_acquire(unsigned *index) { return std::atomic_ref<unsigned>(*index).load(std::memory_order_acquire); }
+void     store_release(unsigned *index, unsigned value) { std::atomic_ref<unsigned>(*index).store(value, std::memory_order_release); }
+
+// Operations readFiles and writeFiles are built from, all available since Linux 5.6
+constexpr std::uint8_t required_operations[] = {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE};
+
+std::uint64_t address(const void *pointer) { return reinterpret_cast<std::uintptr_t>(pointer); }
+
+// Read until EOF, for files whose size statx cannot tell (e.g. procfs)
+std::expected<std::string, std::error_code> read_to_end(int fd) {
+    std::string content;
+    char        buffer[4096];
+    for (;;) {
+        ssize_t count = ::read(fd, buffer, sizeof(buffer));
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return std::unexpected(errno_code(errno));
+        }
+        if (count == 0) {
+            return content;
+        }
+        content.append(buffer, static_cast<std::size_t>(count));
+    }
+}
+
+} // namespace
+
+struct IoRing::Ring {
+    int           fd        = -1;
+    unsigned      entries   = 0;
+    void         *sqMap     = MAP_FAILED;
+    std::size_t   sqMapSize = 0;
+    void         *cqMap     = MAP_FAILED;
+    std::size_t   cqMapSize = 0;
+    io_uring_sqe *sqes      = static_cast<io_uring_sqe *>(MAP_FAILED);
+    std::size_t   sqesSize  = 0;
+    unsigned     *sqTail    = nullptr;
+    unsigned     *sqMask    = nullptr;
+    unsigned     *sqArray   = nullptr;
+    unsigned     *cqHead    = nullptr;
+    unsigned     *cqTail    = nullptr;
+    unsigned     *cqMask    = nullptr;
+    io_uring_cqe *cqes      = nullptr;
+    unsigned      queued    = 0; // Entries filled in but not yet handed to the kernel
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) {
+            ::munmap(sqes, sqesSize);
+        }
+        if (cqMap != MAP_FAILED && cqMap != sqMap) {
+            ::munmap(cqMap, cqMapSize);
+        }
+        if (sqMap != MAP_FAILED) {
+            ::munmap(sqMap, sqMapSize);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    // Queue an operation, at most `entries` may be queued before the next run()
+    io_uring_sqe &push(std::uint8_t opcode, std::uint64_t user_data) {
+        unsigned      tail  = *sqTail; // Only this thread moves the tail
+        unsigned      index = tail & *sqMask;
+        io_uring_sqe &sqe   = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode     = opcode;
+        sqe.user_data  = user_data;
+        sqArray[index] = index;
+        store_release(sqTail, tail + 1);
+        ++queued;
+        return sqe;
+    }
+
+    // Submit everything queued and wait until all of it completed, calling `complete(user_data, result)` for each
+    template <typename Complete> std::error_code run(Complete complete) {
+        unsigned expected  = queued;
+        unsigned completed = 0;
+        while (completed < expected) {
+            int submitted = io_uring_enter(fd, queued, 1, IORING_ENTER_GETEVENTS);
+            if (submitted < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno_code(errno);
+            }
+            queued -= static_cast<unsigned>(submitted);
+
+            unsigned head = *cqHead;
+            for (unsigned tail = load_acquire(cqTail); head != tail; ++head) {
+                const io_uring_cqe &cqe = cqes[head & *cqMask];
+                complete(cqe.user_data, cqe.res);
+                ++completed;
+            }
+            store_release(cqHead, head);
+        }
+        return {};
+    }
+
+    // Close descriptors, reporting the files whose close failed (e.g. a deferred NFS write error)
+    template <typename Failed> std::error_code closeAll(const std::vector<int> &fds, Failed failed) {
+        for (std::size_t i = 0; i < fds.size(); ++i) {
+            if (fds[i] >= 0) {
+                push(IORING_OP_CLOSE, i).fd = fds[i];
+            }
+        }
+        return run([&](std::uint64_t i, int result) {
+            if (result < 0) {
+                failed(i, errno_code(-result));
+            }
+        });
+    }
+};
+
+IoRing::IoRing(std::unique_ptr<Ring> ring) : ring_(std::move(ring)) {}
+IoRing::IoRing(IoRing &&other) noexcept            = default;
+IoRing &IoRing::operator=(IoRing &&other) noexcept = default;
+IoRing::~IoRing()                                  = default;
+
+std::expected<IoRing, std::error_code> IoRing::create(unsigned entries) {
+    io_uring_params params{};
+    auto            ring = std::make_unique<Ring>();
+    ring->fd             = io_uring_setup(entries, &params);
+    if (ring->fd < 0) {
+        return std::unexpected(errno_code(errno));
+    }
+    ring->entries = params.sq_entries;
+
+    // Kernels before 5.6 have io_uring but not every operation used here
+    std::vector<std::uint64_t> probe_storage((sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op)) / sizeof(std::uint64_t) + 1);
+    auto                      *probe = reinterpret_cast<io_uring_probe *>(probe_storage.data());
+    if (io_uring_register(ring->fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+        return std::unexpected(errno_code(errno));
+    }
+    for (std::uint8_t operation : required_operations) {
+        if (operation > probe->last_op || !(probe->ops[operation].flags & IO_URING_OP_SUPPORTED)) {
+            return std::unexpected(std::make_error_code(std::errc::function_not_supported));
+        }
+    }
+
+    ring->sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_map = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_map) {
+        ring->sqMapSize = ring->cqMapSize = std::max(ring->sqMapSize, ring->cqMapSize);
+    }
+    ring->sqMap = ::mmap(nullptr, ring->sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sqMap == MAP_FAILED) {
+        return std::unexpected(errno_code(errno));
+    }
+    ring->cqMap = single_map ? ring->sqMap
+                             : ::mmap(nullptr, ring->cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                                      IORING_OFF_CQ_RING);
+    if (ring->cqMap == MAP_FAILED) {
+        return std::unexpected(errno_code(errno));
+    }
+    ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    ring->sqes     = static_cast<io_uring_sqe *>(
+        ::mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES));
+    if (ring->sqes == MAP_FAILED) {
+        return std::unexpected(errno_code(errno));
+    }
+
+    auto *sq      = static_cast<char *>(ring->sqMap);
+    auto *cq      = static_cast<char *>(ring->cqMap);
+    ring->sqTail  = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    ring->sqMask  = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    ring->sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    ring->cqHead  = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    ring->cqTail  = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    ring->cqMask  = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    ring->cqes    = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    return IoRing(std::move(ring));
+}
+
+// Reading a file takes two queued operations (openat and statx), so a batch is half the ring
+std::size_t IoRing::batchSize() const { return ring_->entries / 2; }
+
+std::vector<std::expected<std::string, std::error_code>> IoRing::readFiles(std::span<const fs::path> paths) {
+    std::vector<std::expected<std::string, std::error_code>> results(paths.size());
+    std::vector<int>                                         fds;
+    std::vector<struct statx>                                stats;
+    std::vector<std::size_t>                                 filled;
+    std::vector<std::size_t>                                 reading;
+
+    for (std::size_t begin = 0; begin < paths.size(); begin += batchSize()) {
+        std::size_t count = std::min(batchSize(), paths.size() - begin);
+        fds.assign(count, -1);
+        stats.assign(count, {});
+        filled.assign(count, 0);
+        reading.clear();
+        auto fail = [&](std::size_t i, std::error_code ec) {
+            if (results[begin + i]) {
+                results[begin + i] = std::unexpected(ec);
+            }
+        };
+
+        // 1. Open every file of the batch and look up its size
+        for (std::size_t i = 0; i < count; ++i) {
+            const char *path = paths[begin + i].c_str();
+            auto       &open = ring_->push(IORING_OP_OPENAT, i << 1);
+            open.fd          = AT_FDCWD;
+            open.addr        = address(path);
+            open.open_flags  = O_RDONLY | O_CLOEXEC;
+
+            auto &stat = ring_->push(IORING_OP_STATX, i << 1 | 1);
+            stat.fd    = AT_FDCWD;
+            stat.addr  = address(path);
+            stat.len   = STATX_TYPE | STATX_SIZE;
+            stat.off   = address(&stats[i]);
+        }
+        std::error_code ec = ring_->run([&](std::uint64_t data, int result) {
+            std::size_t i = data >> 1;
+            if (result < 0) {
+                fail(i, errno_code(-result));
+            } else if (!(data & 1)) {
+                fds[i] = result;
+            }
+        });
+
+        // 2. Read every file in one go, a short read queues the rest of that file for the next round
+        for (std::size_t i = 0; i < count && !ec; ++i) {
+            if (fds[i] < 0 || !results[begin + i]) {
+                continue;
+            }
+            if (!S_ISREG(stats[i].stx_mode) || stats[i].stx_size == 0) {
+                results[begin + i] = read_to_end(fds[i]); // The size is unknown, e.g. on procfs
+                continue;
+            }
+            results[begin + i]->resize(stats[i].stx_size);
+            reading.push_back(i);
+        }
+        while (!reading.empty() && !ec) {
+            for (std::size_t i : reading) {
+                std::string &content = *results[begin + i];
+                auto        &read    = ring_->push(IORING_OP_READ, i);
+                read.fd              = fds[i];
+                read.addr            = address(content.data() + filled[i]);
+                read.len             = static_cast<std::uint32_t>(std::min<std::size_t>(content.size() - filled[i], 1U << 30));
+                read.off             = filled[i];
+            }
+            reading.clear();
+            ec = ring_->run([&](std::uint64_t i, int result) {
+                std::string &content = *results[begin + i];
+                if (result < 0) {
+                    fail(i, errno_code(-result));
+                } else if (result == 0) {
+                    content.resize(filled[i]); // The file shrank since statx
+                } else if ((filled[i] += static_cast<std::size_t>(result)) < content.size()) {
+                    reading.push_back(i);
+                }
+            });
+        }
+
+        // 3. Close the batch
+        if (!ec) {
+            ec = ring_->closeAll(fds, [](std::size_t, std::error_code) {});
+        } else {
+            for (int fd : fds) {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+            }
+        }
+        if (ec) {
+            // The ring itself failed, the files it left are reported with that error
+            for (std::size_t i = 0; i < count; ++i) {
+                fail(i, ec);
+            }
+        }
+    }
+    return results;
+}
+
+std::vector<std::error_code> IoRing::writeFiles(std::span<const fs::path> paths, std::span<const std::string_view> contents) {
+    std::vector<std::error_code> errors(paths.size());
+    std::vector<int>             fds;
+    std::vector<std::size_t>     written;
+    std::vector<std::size_t>     writing;
+
+    for (std::size_t begin = 0; begin < paths.size(); begin += batchSize()) {
+        std::size_t count = std::min(batchSize(), paths.size() - begin);
+        fds.assign(count, -1);
+        written.assign(count, 0);
+        writing.clear();
+        auto fail = [&](std::size_t i, std::error_code ec) {
+            if (!errors[begin + i]) {
+                errors[begin + i] = ec;
+            }
+        };
+
+        // 1. Create or truncate every file of the batch
+        for (std::size_t i = 0; i < count; ++i) {
+            auto &open      = ring_->push(IORING_OP_OPENAT, i);
+            open.fd         = AT_FDCWD;
+            open.addr       = address(paths[begin + i].c_str());
+            open.open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+            open.len        = 0666; // Reduced by the umask, like std::ofstream
+        }
+        std::error_code ec = ring_->run([&](std::uint64_t i, int result) {
+            if (result < 0) {
+                fail(i, errno_code(-result));
+            } else {
+                fds[i] = result;
+                if (!contents[begin + i].empty()) {
+                    writing.push_back(i);
+                }
+            }
+        });
+
+        // 2. Write every file in one go, a short write queues the rest of that file for the next round
+        while (!writing.empty() && !ec) {
+            for (std::size_t i : writing) {
+                std::string_view content = contents[begin + i];
+                auto            &write   = ring_->push(IORING_OP_WRITE, i);
+                write.fd                 = fds[i];
+                write.addr               = address(content.data() + written[i]);
+                write.len                = static_cast<std::uint32_t>(std::min<std::size_t>(content.size() - written[i], 1U << 30));
+                write.off                = written[i];
+            }
+            writing.clear();
+            ec = ring_->run([&](std::uint64_t i, int result) {
+                if (result < 0) {
+                    fail(i, errno_code(-result));
+                } else if (result == 0) {
+                    fail(i, std::make_error_code(std::errc::io_error));
+                } else if ((written[i] += static_cast<std::size_t>(result)) < contents[begin + i].size()) {
+                    writing.push_back(i);
+                }
+            });
+        }
+
+        // 3. Close the batch, where some filesystems report write errors
+        if (!ec) {
+            ec = ring_->closeAll(fds, fail);
+        } else {
+            for (int fd : fds) {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+            }
+        }
+        if (ec) {
+            for (std::size_t i = 0; i < count; ++i) {
+                fail(i, ec);
+            }
+        }
+    }
+    return errors;
+}
+
+#else
+
+struct IoRing::Ring {};
+
+IoRing::IoRing(std::unique_ptr<Ring> ring) : ring_(std::move(ring)) {}
+IoRing::IoRing(IoRing &&other) noexcept            = default;
+IoRing &IoRing::operator=(IoRing &&other) noexcept = default;
+IoRing::~IoRing()                                  = default;
+
+std::expected<IoRing, std::error_code> IoRing::create(unsigned) {
+    return std::unexpected(std::make_error_code(std::errc::function_not_supported));
+}
+
+std::size_t IoRing::batchSize() const { return 0; }
+
+std::vector<std::expected<std::string, std::error_code>> IoRing::readFiles(std::span<const fs::path> paths) {
+    std::unexpected<std::error_code> unsupported(std::make_error_code(std::errc::function_not_supported));
+    return std::vector<std::expected<std::string, std::error_code>>(paths.size(), unsupported);
+}
+
+std::vector<std::error_code> IoRing::writeFiles(std::span<const fs::path> paths, std::span<const std::string_view>) {
+    return std::vector<std::error_code>(paths.size(), std::make_error_code(std::errc::function_not_supported));
+}
+
+#endif
+
+} // namespace cgen
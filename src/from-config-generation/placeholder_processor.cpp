@@ -1,30 +1,102 @@
 #include "cgen/placeholder_processor.h"
-#include <sstream>
+#include "cgen/stats.h"
+#include <algorithm>
+#include <optional>
 #include <unordered_set>
 
 namespace cgen {
+namespace {
+
+enum class directive_kind { if_true, if_false, else_branch, end_if, each, end_each };
+
+// A block directive such as `@if NAME@` or `@each ITEM in LIST@`, with the names it refers to
+struct Directive {
+    directive_kind   kind;
+    std::string_view name; // Condition or loop variable
+    std::string_view list; // List of an `each` loop
+};
+
+bool is_name(std::string_view word) {
+    return !word.empty() && std::all_of(word.begin(), word.end(), PlaceholderScanner::isBodyChar);
+}
+
+// Parse a directive body like "each DEP in DEPENDENCIES", nullopt if it is not a valid directive
+std::optional<Directive> parse_directive(std::string_view body) {
+    std::vector<std::string_view> words;
+    for (std::size_t pos = 0; pos < body.size();) {
+        std::size_t end = std::min(body.find(' ', pos), body.size());
+        if (end > pos) {
+            words.push_back(body.substr(pos, end - pos));
+        }
+        pos = end + 1;
+    }
+
+    if (words.size() == 1) {
+        if (words[0] == "else") {
+            return Directive{directive_kind::else_branch, {}, {}};
+        }
+        if (words[0] == "endif") {
+            return Directive{directive_kind::end_if, {}, {}};
+        }
+        if (words[0] == "endeach") {
+            return Directive{directive_kind::end_each, {}, {}};
+        }
+    } else if (words.size() == 2 && words[0] == "if") {
+        bool negated = words[1].starts_with('!');
+        if (is_name(words[1].substr(negated ? 1 : 0))) {
+            return Directive{negated ? directive_kind::if_false : directive_kind::if_true, words[1].substr(negated ? 1 : 0), {}};
+        }
+    } else if (words.size() == 4 && words[0] == "each" && words[2] == "in" && is_name(words[1]) && is_name(words[3])) {
+        return Directive{directive_kind::each, words[1], words[3]};
+    }
+    return std::nullopt;
+}
+
+// The text a directive removes: its whole line if nothing else is on it, otherwise just the directive
+std::pair<std::size_t, std::size_t> directive_span(std::string_view text, std::size_t literalStart, std::size_t begin,
+                                                   std::size_t end) {
+    std::size_t lineBegin = begin;
+    while (lineBegin > literalStart && (text[lineBegin - 1] == ' ' || text[lineBegin - 1] == '\t')) {
+        --lineBegin;
+    }
+    std::size_t lineEnd = end;
+    while (lineEnd < text.size() && (text[lineEnd] == ' ' || text[lineEnd] == '\t' || text[lineEnd] == '\r')) {
+        ++lineEnd;
+    }
+    bool startsLine = lineBegin == 0 || text[lineBegin - 1] == '\n';
+    if (!startsLine || (lineEnd < text.size() && text[lineEnd] != '\n')) {
+        return {begin, end};
+    }
+    return {lineBegin, lineEnd < text.size() ? lineEnd + 1 : lineEnd};
+}
+
+// A block whose end directive has not been seen yet
+struct OpenBlock {
+    bool          isLoop;
+    std::uint32_t jump;         // The conditional jump or the loop's `next` segment
+    std::uint32_t elseJump = 0; // Jump over the else branch, if there is one
+    bool          hasElse  = false;
+};
+
+} // namespace
 
 PlaceholderProcessor::PlaceholderProcessor(std::initializer_list<PlaceholderStyle> styles)
-    : allStyles_(styles.begin(), styles.end()) {
+    : allStyles_(styles.begin(), styles.end()), scanner_(buildDelimiters()) {
 }
 
-std::vector<std::string> PlaceholderProcessor::extractPlaceholders(const std::string& content) const {
+std::vector<std::string> PlaceholderProcessor::extractPlaceholders(std::string_view content) const {
     std::vector<std::string> placeholders;
     std::unordered_set<std::string> uniquePlaceholders; // To avoid duplicates
     
-    auto regex = buildCombinedRegex();
-    
-    std::sregex_iterator begin(content.begin(), content.end(), regex);
-    std::sregex_iterator end;
-    
-    for (std::sregex_iterator i = begin; i != end; ++i) {
-        std::smatch match = *i;
-        std::string placeholder = extractPlaceholderName(match.str());
+    std::size_t pos = 0;
+    while (auto match = scanner_.next(content, pos)) {
+        std::string placeholder(match->name(content));
         
-        if (!placeholder.empty() && uniquePlaceholders.find(placeholder) == uniquePlaceholders.end()) {
+        if (uniquePlaceholders.find(placeholder) == uniquePlaceholders.end()) {
             placeholders.push_back(placeholder);
             uniquePlaceholders.insert(placeholder);
         }
+        pos = match->offset + match->length;
     }
     
     return placeholders;
@@ -32,63 +104,98 @@ std::vector<std::string> PlaceholderProcessor::extractPlaceholders(const std::st
 
 std::string PlaceholderProcessor::replacePlaceholders(
     const std::string& content,
-    const std::unordered_map<std::string, std::string>& values
+    const std::unordered_map<std::string, std::string>& values,
+    bool directives
 ) const {
-    std::string result = content;
-    auto regex = buildCombinedRegex();
-    
-    // First pass: collect all placeholders with their full match text
-    std::vector<std::pair<std::string, std::string>> replacements;
-    
-    std::sregex_iterator begin(content.begin(), content.end(), regex);
-    std::sregex_iterator end;
-    
-    for (std::sregex_iterator i = begin; i != end; ++i) {
-        std::smatch match = *i;
-        std::string fullMatch = match.str();
-        std::string placeholder = extractPlaceholderName(fullMatch);
-        
-        auto it = values.find(placeholder);
-        if (it != values.end()) {
-            replacements.emplace_back(fullMatch, it->second);
-        }
-    }
-    
-    // Second pass: apply replacements from longest to shortest to avoid partial replacements
-    std::sort(replacements.begin(), replacements.end(), 
-              [](const auto& a, const auto& b) { 
-                  return a.first.length() > b.first.length(); 
-              });
-    
-    for (const auto& [oldText, newText] : replacements) {
-        // Use simple string replacement for exact matches
-        size_t pos = 0;
-        while ((pos = result.find(oldText, pos)) != std::string::npos) {
-            result.replace(pos, oldText.length(), newText);
-            pos += newText.length();
-        }
-    }
-    
-    return result;
+    return compile(content, directives).render(values);
 }
 
-std::regex PlaceholderProcessor::buildRegexForStyle(PlaceholderStyle style) const {
-    auto [prefix, suffix] = getStyleDelimiters(style);
-    
-    // Escape prefix and suffix for regex
-    auto escapeRegex = [](const std::string& str) {
-        std::string escaped;
-        for (char c : str) {
-            if (c == '{' || c == '}' || c == '$' || c == '@' || c == '#' || c == '%' || c == '\\') {
-                escaped += '\\';
-            }
-            escaped += c;
+CompiledTemplate PlaceholderProcessor::compile(std::string content, bool directives) const {
+    return compile(FileSource::fromString(std::move(content)), directives);
+}
+
+CompiledTemplate PlaceholderProcessor::compile(FileSource source, bool directives) const {
+    ScopedTimer timer(stats_phase::compile);
+    CompiledTemplate compiled;
+    compiled.source_ = std::move(source);
+    std::string_view text = compiled.source();
+
+    std::unordered_map<std::uint32_t, std::uint32_t> slotIds; // Symbol id to slot
+    auto slotOf = [&](std::string_view name) {
+        std::uint32_t symbol = symbols_->intern(name);
+        auto [it, inserted] = slotIds.try_emplace(symbol, static_cast<std::uint32_t>(compiled.slots_.size()));
+        if (inserted) {
+            compiled.slots_.emplace_back(name);
+            compiled.symbols_.push_back(symbol);
         }
-        return escaped;
+        return it->second;
     };
-    
-    std::string pattern = escapeRegex(prefix) + "([A-Z0-9_]+)" + escapeRegex(suffix);
-    return std::regex(pattern);
+
+    // Directives are found in the same scan as placeholders and turned into jumps right away
+    std::vector<OpenBlock> blocks;
+    auto closeBlock = [&compiled](const OpenBlock &block) {
+        if (block.isLoop) {
+            compiled.addControl(segment_op::jump, CompiledTemplate::literal, block.jump);
+        }
+        compiled.patchTarget(block.hasElse ? block.elseJump : block.jump);
+    };
+    std::size_t literalStart = 0;
+    std::size_t searchFrom = 0;
+    std::size_t matches = 0;
+    while (auto match = directives ? scanner_.nextToken(text, searchFrom) : scanner_.next(text, searchFrom)) {
+        if (!match->directive) {
+            ++matches;
+            std::uint32_t slot = slotOf(match->name(text));
+            compiled.addLiteral(literalStart, match->offset - literalStart);
+            compiled.addPlaceholder(match->offset, match->length, slot);
+            literalStart = searchFrom = match->offset + match->length;
+            continue;
+        }
+
+        auto directive = parse_directive(match->name(text));
+        bool inIf = !blocks.empty() && !blocks.back().isLoop;
+        bool inLoop = !blocks.empty() && blocks.back().isLoop;
+        if (!directive || (directive->kind == directive_kind::else_branch && (!inIf || blocks.back().hasElse)) ||
+            (directive->kind == directive_kind::end_if && !inIf) || (directive->kind == directive_kind::end_each && !inLoop)) {
+            searchFrom = match->offset + 1; // Plain text, which may still contain a placeholder
+            continue;
+        }
+
+        auto [begin, end] = directive_span(text, literalStart, match->offset, match->offset + match->length);
+        compiled.addLiteral(literalStart, begin - literalStart);
+        literalStart = searchFrom = end;
+        switch (directive->kind) {
+        case directive_kind::if_true:
+            blocks.push_back({false, compiled.addControl(segment_op::jump_unless, slotOf(directive->name))});
+            break;
+        case directive_kind::if_false:
+            blocks.push_back({false, compiled.addControl(segment_op::jump_if, slotOf(directive->name))});
+            break;
+        case directive_kind::else_branch:
+            blocks.back().elseJump = compiled.addControl(segment_op::jump, CompiledTemplate::literal);
+            blocks.back().hasElse = true;
+            compiled.patchTarget(blocks.back().jump);
+            break;
+        case directive_kind::each: {
+            std::uint32_t list = slotOf(directive->list);
+            compiled.addControl(segment_op::each, list);
+            blocks.push_back({true, compiled.addControl(segment_op::next, slotOf(directive->name))});
+            break;
+        }
+        case directive_kind::end_if:
+        case directive_kind::end_each:
+            closeBlock(blocks.back());
+            blocks.pop_back();
+            break;
+        }
+    }
+    compiled.addLiteral(literalStart, text.size() - literalStart);
+    for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+        closeBlock(*it); // Left open, they end with the template
+    }
+    count_stat(stats_counter::placeholders_matched, matches);
+
+    return compiled;
 }
 
 std::pair<std::string, std::string> PlaceholderProcessor::getStyleDelimiters(PlaceholderStyle style) const {
@@ -104,49 +211,13 @@ std::pair<std::string, std::string> PlaceholderProcessor::getStyleDelimiters(Pla
     }
 }
 
-std::regex PlaceholderProcessor::buildCombinedRegex() const {
-    // Build pattern alternation for all styles
-    std::stringstream pattern;
-    
-    for (size_t i = 0; i < allStyles_.size(); ++i) {
-        auto [prefix, suffix] = getStyleDelimiters(allStyles_[i]);
-        
-        // Escape prefix and suffix for regex
-        auto escapeRegex = [](const std::string& str) {
-            std::string escaped;
-            for (char c : str) {
-                if (c == '{' || c == '}' || c == '$' || c == '@' || c == '#' || c == '%' || c == '\\') {
-                    escaped += '\\';
-                }
-                escaped += c;
-            }
-            return escaped;
-        };
-        
-        pattern << escapeRegex(prefix) << "([A-Z0-9_]+)" << escapeRegex(suffix);
-        
-        if (i < allStyles_.size() - 1) {
-            pattern << "|";
-        }
-    }
-    
-    return std::regex(pattern.str());
-}
-
-std::string PlaceholderProcessor::extractPlaceholderName(const std::string& match) const {
-    // Try each style to extract the placeholder name
+std::string PlaceholderProcessor::buildDelimiters() const {
+    // Every supported style opens and closes with the same single character
+    std::string delimiters;
     for (auto style : allStyles_) {
-        auto [prefix, suffix] = getStyleDelimiters(style);
-        
-        if (match.size() >= prefix.size() + suffix.size() && 
-            match.substr(0, prefix.size()) == prefix && 
-            match.substr(match.size() - suffix.size()) == suffix) {
-            
-            return match.substr(prefix.size(), match.size() - prefix.size() - suffix.size());
-        }
+        delimiters += getStyleDelimiters(style).first.front();
     }
-    
-    return "";
+    return delimiters;
 }
 
 } // namespace cgen
\ No newline at end of file
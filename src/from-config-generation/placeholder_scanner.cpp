@@ -0,0 +1,185 @@
+#include "cgen/placeholder_scanner.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define CGEN_SCANNER_SSE2 1
+#if defined(__GNUC__) || defined(__clang__)
+#define CGEN_SCANNER_AVX2 1
+#endif
+#endif
+
+namespace cgen {
+namespace {
+
+using find_fn = std::size_t (*)(const char *data, std::size_t size, std::size_t from, const char *delimiters, std::size_t count,
+                                const bool *table);
+
+std::size_t find_scalar(const char *data, std::size_t size, std::size_t from, const char *delimiters, std::size_t count,
+                        const bool *table) {
+    if (from >= size) {
+        return std::string_view::npos;
+    }
+    if (count == 1) {
+        const void *hit = std::memchr(data + from, delimiters[0], size - from);
+        return hit ? static_cast<std::size_t>(static_cast<const char *>(hit) - data) : std::string_view::npos;
+    }
+    for (std::size_t i = from; i < size; ++i) {
+        if (table[static_cast<unsigned char>(data[i])]) {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+#ifdef CGEN_SCANNER_SSE2
+std::size_t find_sse2(const char *data, std::size_t size, std::size_t from, const char *delimiters, std::size_t count,
+                      const bool *table) {
+    // Unused delimiter lanes repeat the first delimiter so the compare sequence stays branch-free
+    const __m128i d0 = _mm_set1_epi8(delimiters[0]);
+    const __m128i d1 = _mm_set1_epi8(count > 1 ? delimiters[1] : delimiters[0]);
+    const __m128i d2 = _mm_set1_epi8(count > 2 ? delimiters[2] : delimiters[0]);
+    const __m128i d3 = _mm_set1_epi8(count > 3 ? delimiters[3] : delimiters[0]);
+
+    std::size_t i = from;
+    for (; i + 16 <= size; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const __m128i hits  = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, d0), _mm_cmpeq_epi8(chunk, d1)),
+                                           _mm_or_si128(_mm_cmpeq_epi8(chunk, d2), _mm_cmpeq_epi8(chunk, d3)));
+        const auto    mask  = static_cast<unsigned>(_mm_movemask_epi8(hits));
+        if (mask != 0) {
+            return i + static_cast<std::size_t>(std::countr_zero(mask));
+        }
+    }
+    return find_scalar(data, size, i, delimiters, count, table);
+}
+#endif
+
+#ifdef CGEN_SCANNER_AVX2
+__attribute__((target("avx2"))) std::size_t find_avx2(const char *data, std::size_t size, std::size_t from, const char *delimiters,
+                                                      std::size_t count, const bool *table) {
+    const __m256i d0 = _mm256_set1_epi8(delimiters[0]);
+    const __m256i d1 = _mm256_set1_epi8(count > 1 ? delimiters[1] : delimiters[0]);
+    const __m256i d2 = _mm256_set1_epi8(count > 2 ? delimiters[2] : delimiters[0]);
+    const __m256i d3 = _mm256_set1_epi8(count > 3 ? delimiters[3] : delimiters[0]);
+
+    std::size_t i = from;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        const __m256i hits  = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, d0), _mm256_cmpeq_epi8(chunk, d1)),
+                                              _mm256_or_si256(_mm256_cmpeq_epi8(chunk, d2), _mm256_cmpeq_epi8(chunk, d3)));
+        const auto    mask  = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+        if (mask != 0) {
+            return i + static_cast<std::size_t>(std::countr_zero(mask));
+        }
+    }
+    return find_sse2(data, size, i, delimiters, count, table);
+}
+#endif
+
+// Pick the widest implementation the running CPU supports, once per process
+find_fn select_find() {
+#ifdef CGEN_SCANNER_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return &find_avx2;
+    }
+#endif
+#ifdef CGEN_SCANNER_SSE2
+    return &find_sse2;
+#else
+    return &find_scalar;
+#endif
+}
+
+// Length of the directive whose opening delimiter is at `pos`, including both delimiters, or 0
+std::size_t directiveLength(std::string_view text, std::size_t pos) {
+    const char  delimiter = text[pos];
+    std::size_t end       = pos + 1;
+    std::size_t limit     = std::min(text.size(), pos + 1 + PlaceholderScanner::max_directive_length);
+    while (end < limit && text[end] >= 'a' && text[end] <= 'z') {
+        ++end;
+    }
+    if (end == pos + 1) {
+        return 0;
+    }
+    while (end < limit && text[end] != delimiter) {
+        char c = text[end];
+        if (!PlaceholderScanner::isBodyChar(c) && !(c >= 'a' && c <= 'z') && c != ' ' && c != '!') {
+            return 0;
+        }
+        ++end;
+    }
+    return end < limit && text[end] == delimiter ? end + 1 - pos : 0;
+}
+
+} // namespace
+
+PlaceholderScanner::PlaceholderScanner(std::string_view delimiters) {
+    for (char c : delimiters) {
+        if (count_ == max_delimiters || isDelimiter_[static_cast<unsigned char>(c)]) {
+            continue;
+        }
+        delimiters_[count_++]                       = c;
+        isDelimiter_[static_cast<unsigned char>(c)] = true;
+    }
+}
+
+const std::array<bool, 256> &PlaceholderScanner::bodyTable() {
+    static const std::array<bool, 256> table = [] {
+        std::array<bool, 256> t{};
+        for (char c = 'A'; c <= 'Z'; ++c) {
+            t[static_cast<unsigned char>(c)] = true;
+        }
+        for (char c = '0'; c <= '9'; ++c) {
+            t[static_cast<unsigned char>(c)] = true;
+        }
+        t[static_cast<unsigned char>('_')] = true;
+        return t;
+    }();
+    return table;
+}
+
+std::size_t PlaceholderScanner::findDelimiter(std::string_view text, std::size_t from) const {
+    if (count_ == 0) {
+        return std::string_view::npos;
+    }
+    static const find_fn find_delimiter = select_find();
+    return find_delimiter(text.data(), text.size(), from, delimiters_.data(), count_, isDelimiter_.data());
+}
+
+template <bool with_directives> std::optional<PlaceholderMatch> PlaceholderScanner::scan(std::string_view text, std::size_t from) const {
+    const auto &body = bodyTable();
+
+    std::size_t pos = from;
+    while ((pos = findDelimiter(text, pos)) != std::string_view::npos) {
+        const char  delimiter = text[pos];
+        std::size_t end       = pos + 1;
+        while (end < text.size() && body[static_cast<unsigned char>(text[end])]) {
+            ++end;
+        }
+        if (end > pos + 1 && end < text.size() && text[end] == delimiter) {
+            return PlaceholderMatch{pos, end + 1 - pos};
+        }
+        if constexpr (with_directives) {
+            if (end == pos + 1) {
+                if (std::size_t length = directiveLength(text, pos)) {
+                    return PlaceholderMatch{pos, length, true};
+                }
+            }
+        }
+        // Body characters are never delimiters, so the next candidate cannot start before `end`
+        pos = end > pos + 1 ? end : pos + 1;
+    }
+    return std::nullopt;
+}
+
+std::optional<PlaceholderMatch> PlaceholderScanner::next(std::string_view text, std::size_t from) const { return scan<false>(text, from); }
+
+std::optional<PlaceholderMatch> PlaceholderScanner::nextToken(std::string_view text, std::size_t from) const {
+    return scan<true>(text, from);
+}
+
+} // namespace cgen
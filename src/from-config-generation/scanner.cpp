@@ -1,13 +1,30 @@
 #include "cgen/scanner.h"
 
-namespace cgen {
+#include "cgen/stats.h"
+#include "cgen/trace.h"
 
-std::expected<std::set<std::shared_ptr<Directory>, CompareDirectoryByName<Directory>>, scan_status>
-scan_template_directory(const std::string &template_name, const std::string &templates_base_dir) {
+#include <algorithm>
 
-    std::set<std::shared_ptr<Directory>, CompareDirectoryByName<Directory>> top_level_dirs_result;
-    fs::path template_dir_input = fs::path(templates_base_dir) / template_name;
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cgen {
+namespace {
 
+// fs::weakly_canonical, timed as its own phase: it stats every component of the path
+fs::path canonicalize(const fs::path &path, std::error_code &ec) {
+    ScopedTimer timer(stats_phase::canonicalize);
+    return fs::weakly_canonical(path, ec);
+}
+
+// Check that the template directory exists and return its canonical path
+std::expected<fs::path, scan_status> resolve_template_root(const fs::path &template_dir_input) {
     std::error_code ec;
 
     // Check if the template directory exists
@@ -31,13 +48,245 @@ scan_template_directory(const std::string &template_name, const std::string &tem
     }
 
     // Canonicalize the root template directory path for consistent lookups
-    fs::path canonical_template_dir_root = fs::weakly_canonical(template_dir_input, ec);
+    fs::path canonical_template_dir_root = canonicalize(template_dir_input, ec);
     if (ec) {
         fmt::print(stderr, "Error canonicalizing template directory path {}: {}. Using non-canonical path as fallback.\n",
                    template_dir_input.string(), ec.message());
         canonical_template_dir_root = template_dir_input;
-        ec.clear(); // Clear error and proceed with the potentially non-canonical path
     }
+    return canonical_template_dir_root;
+}
+
+// List one directory into the tree, files first and then each subdirectory, both in name order
+void scan_flat_directory(const fs::path &path, DirectoryTree &tree) {
+    TraceScope trace("list directory", "scan", path);
+    std::vector<std::string>                  files;
+    std::vector<std::pair<std::string, bool>> directories; // Name and whether it is a symlink
+
+    std::error_code        ec;
+    fs::directory_iterator iter(path, fs::directory_options::skip_permission_denied, ec);
+    if (ec) {
+        fmt::print(stderr, "Error reading directory {}: {}. Skipping.\n", path.string(), ec.message());
+        return;
+    }
+
+    for (fs::directory_iterator end_iter; iter != end_iter; iter.increment(ec)) {
+        if (ec) {
+            fmt::print(stderr, "Error reading directory {}: {}. Skipping the rest of it.\n", path.string(), ec.message());
+            break;
+        }
+        const auto &entry = *iter;
+
+        bool is_file = entry.is_regular_file(ec); // is_regular_file follows symlinks
+        if (ec) {
+            fmt::print(stderr, "Error checking type of {}: {}. Skipping.\n", entry.path().string(), ec.message());
+            ec.clear();
+            continue;
+        }
+        if (is_file) {
+            files.push_back(entry.path().filename().string());
+            continue;
+        }
+
+        bool is_subdir = entry.is_directory(ec); // is_directory follows symlinks
+        if (ec) {
+            fmt::print(stderr, "Error checking type of {}: {}. Skipping.\n", entry.path().string(), ec.message());
+            ec.clear();
+            continue;
+        }
+        if (is_subdir) {
+            bool is_symlink = entry.is_symlink(ec);
+            directories.emplace_back(entry.path().filename().string(), is_symlink && !ec);
+            ec.clear();
+        }
+        // Other types (dangling symlinks, block devices, sockets, etc.) are ignored.
+    }
+
+    std::sort(files.begin(), files.end());
+    std::sort(directories.begin(), directories.end());
+    count_stat(stats_counter::directories_scanned);
+    count_stat(stats_counter::files_scanned, files.size());
+
+    for (const auto &file_name : files) {
+        tree.addFile(file_name);
+    }
+    for (const auto &[dir_name, is_symlink] : directories) {
+        tree.openDirectory(dir_name);
+        if (!is_symlink) { // Like recursive_directory_iterator, do not follow directory symlinks
+            scan_flat_directory(path / dir_name, tree);
+        }
+        tree.closeDirectory();
+    }
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+// A directory listed by the parallel scanner, filled in by exactly one task
+struct ListedDirectory {
+    struct Subdirectory {
+        std::string                      name;
+        bool                             is_symlink = false;
+        std::unique_ptr<ListedDirectory> listing; // Null for symlinks, which are not descended into
+    };
+
+    std::vector<std::string>  files;
+    std::vector<Subdirectory> directories;
+    std::vector<std::string>  errors; // Printed in tree order once the scan is done
+};
+
+// An open directory, kept open until every subdirectory task has opened its own descriptor from it
+struct OpenDirectory {
+    DIR *stream = nullptr; // Null for the working directory the root is opened from
+    int  fd     = AT_FDCWD;
+
+    ~OpenDirectory() {
+        if (stream) {
+            ::closedir(stream);
+        }
+    }
+};
+
+enum class entry_kind { file, directory, directory_symlink, other };
+
+// Type of a directory entry, following symlinks like fs::is_regular_file and fs::is_directory do
+entry_kind classify_entry(int dir_fd, const dirent &entry, std::error_code &ec) {
+    bool is_symlink = false;
+    switch (entry.d_type) {
+    case DT_REG: return entry_kind::file;
+    case DT_DIR: return entry_kind::directory;
+    case DT_LNK: is_symlink = true; break;
+    case DT_UNKNOWN: {
+        // Some filesystems (older XFS, some NFS servers) do not report types in readdir
+        struct stat st {};
+        if (::fstatat(dir_fd, entry.d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            ec = std::error_code(errno, std::generic_category());
+            return entry_kind::other;
+        }
+        if (S_ISREG(st.st_mode)) {
+            return entry_kind::file;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            return entry_kind::directory;
+        }
+        is_symlink = S_ISLNK(st.st_mode);
+        break;
+    }
+    default: break;
+    }
+    if (!is_symlink) {
+        return entry_kind::other;
+    }
+
+    struct stat target {};
+    if (::fstatat(dir_fd, entry.d_name, &target, 0) != 0) {
+        return entry_kind::other; // Dangling
+    }
+    if (S_ISREG(target.st_mode)) {
+        return entry_kind::file;
+    }
+    return S_ISDIR(target.st_mode) ? entry_kind::directory_symlink : entry_kind::other;
+}
+
+// Open and list one directory, then submit a task for each of its subdirectories
+void list_directory_task(std::shared_ptr<OpenDirectory> parent, std::string name, fs::path path, ListedDirectory &listing,
+                         ThreadPool &pool) {
+    TraceScope trace("list directory", "scan", path);
+
+    int fd = ::openat(parent->fd, name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    parent.reset(); // The last subdirectory to get here closes the parent
+    if (fd < 0) {
+        if (errno != EACCES) { // Skipped silently, like fs::directory_options::skip_permission_denied
+            listing.errors.push_back(fmt::format("Error reading directory {}: {}. Skipping.\n", path.string(), std::strerror(errno)));
+        }
+        return;
+    }
+    auto directory    = std::make_shared<OpenDirectory>();
+    directory->stream = ::fdopendir(fd);
+    if (!directory->stream) {
+        listing.errors.push_back(fmt::format("Error reading directory {}: {}. Skipping.\n", path.string(), std::strerror(errno)));
+        ::close(fd);
+        return;
+    }
+    directory->fd = fd;
+
+    for (;;) {
+        errno               = 0;
+        const dirent *entry = ::readdir(directory->stream);
+        if (!entry) {
+            if (errno != 0) {
+                listing.errors.push_back(
+                    fmt::format("Error reading directory {}: {}. Skipping the rest of it.\n", path.string(), std::strerror(errno)));
+            }
+            break;
+        }
+        std::string_view entry_name = entry->d_name;
+        if (entry_name == "." || entry_name == "..") {
+            continue;
+        }
+
+        std::error_code ec;
+        switch (classify_entry(fd, *entry, ec)) {
+        case entry_kind::file: listing.files.emplace_back(entry_name); break;
+        case entry_kind::directory: listing.directories.push_back({std::string(entry_name), false, nullptr}); break;
+        case entry_kind::directory_symlink: listing.directories.push_back({std::string(entry_name), true, nullptr}); break;
+        case entry_kind::other:
+            if (ec) {
+                listing.errors.push_back(
+                    fmt::format("Error checking type of {}: {}. Skipping.\n", (path / entry_name).string(), ec.message()));
+            }
+            break;
+        }
+    }
+
+    std::sort(listing.files.begin(), listing.files.end());
+    std::sort(listing.directories.begin(), listing.directories.end(), [](const auto &lhs, const auto &rhs) { return lhs.name < rhs.name; });
+    count_stat(stats_counter::directories_scanned);
+    count_stat(stats_counter::files_scanned, listing.files.size());
+
+    for (auto &subdirectory : listing.directories) {
+        if (subdirectory.is_symlink) {
+            continue; // Like recursive_directory_iterator, do not follow directory symlinks
+        }
+        subdirectory.listing = std::make_unique<ListedDirectory>();
+        pool.submit([directory, &subdirectory, path = path / subdirectory.name, &pool]() mutable {
+            list_directory_task(std::move(directory), subdirectory.name, std::move(path), *subdirectory.listing, pool);
+        });
+    }
+}
+
+// Append a finished listing to the tree, in the order scan_flat_directory would have produced it
+void merge_listing(const ListedDirectory &listing, DirectoryTree &tree) {
+    for (const auto &error : listing.errors) {
+        fmt::print(stderr, "{}", error);
+    }
+    for (const auto &file_name : listing.files) {
+        tree.addFile(file_name);
+    }
+    for (const auto &subdirectory : listing.directories) {
+        tree.openDirectory(subdirectory.name);
+        if (subdirectory.listing) {
+            merge_listing(*subdirectory.listing, tree);
+        }
+        tree.closeDirectory();
+    }
+}
+#endif
+
+} // namespace
+
+std::expected<std::set<std::shared_ptr<Directory>, CompareDirectoryByName<Directory>>, scan_status>
+scan_template_directory(const std::string &template_name, const std::string &templates_base_dir) {
+    ScopedTimer timer(stats_phase::scan);
+
+    std::set<std::shared_ptr<Directory>, CompareDirectoryByName<Directory>> top_level_dirs_result;
+    fs::path template_dir_input = fs::path(templates_base_dir) / template_name;
+
+    auto canonical_root_or = resolve_template_root(template_dir_input);
+    if (!canonical_root_or) {
+        return std::unexpected(canonical_root_or.error());
+    }
+    const fs::path canonical_template_dir_root = canonical_root_or.value();
+
+    std::error_code ec;
 
     // Maps a canonical directory path to its corresponding Directory object
     std::map<fs::path, std::shared_ptr<Directory>> created_directories_map;
@@ -53,7 +302,7 @@ scan_template_directory(const std::string &template_name, const std::string &tem
             const fs::path &raw_current_path = entry.path(); // Path from iterator, may not be canonical
 
             // Get canonical path for the current entry (for map keys and Directory::path)
-            fs::path current_canonical_path = fs::weakly_canonical(raw_current_path, ec);
+            fs::path current_canonical_path = canonicalize(raw_current_path, ec);
             if (ec) {
                 fmt::print(stderr, "Error canonicalizing entry path {}: {}. Skipping entry.\n", raw_current_path.string(), ec.message());
                 ec.clear(); // Clear error and skip this problematic entry
@@ -62,7 +311,7 @@ scan_template_directory(const std::string &template_name, const std::string &tem
 
             // Get canonical path for the parent (for map lookups)
             fs::path parent_raw_path       = raw_current_path.parent_path();
-            fs::path parent_canonical_path = fs::weakly_canonical(
+            fs::path parent_canonical_path = canonicalize(
                 parent_raw_path, ec); // parent_raw_path could be empty if raw_current_path is a root.
                                       // For entries from recursive_directory_iterator rooted at canonical_template_dir_root,
                                       // parent_path should be valid or equal to canonical_template_dir_root.
@@ -82,6 +331,7 @@ scan_template_directory(const std::string &template_name, const std::string &tem
 
             if (is_file) {
                 std::string filename = raw_current_path.filename().string(); // Use filename from raw path for Directory::name
+                count_stat(stats_counter::files_scanned);
 
                 if (parent_canonical_path == canonical_template_dir_root) {
                     // File is directly under the root template directory
@@ -112,6 +362,7 @@ scan_template_directory(const std::string &template_name, const std::string &tem
                 }
 
                 if (is_subdir) {
+                    count_stat(stats_counter::directories_scanned);
                     auto new_dir_node  = std::make_shared<Directory>();
                     new_dir_node->name = raw_current_path.filename().string(); // Name from original filename
                     new_dir_node->path = current_canonical_path;               // Store the canonical path of the subdir
@@ -165,4 +416,58 @@ scan_template_directory(const std::string &template_name, const std::string &tem
 
     return top_level_dirs_result;
 }
-} // namespace cgen
\ No newline at end of file
+
+std::expected<DirectoryTree, scan_status> scan_template_directory(const std::string &template_name, const std::string &templates_base_dir,
+                                                                  flat_tree_t) {
+    ScopedTimer timer(stats_phase::scan);
+
+    auto canonical_root_or = resolve_template_root(fs::path(templates_base_dir) / template_name);
+    if (!canonical_root_or) {
+        return std::unexpected(canonical_root_or.error());
+    }
+
+    DirectoryTree tree(canonical_root_or.value());
+    try {
+        tree.openDirectory("");
+        scan_flat_directory(tree.rootPath(), tree);
+        tree.closeDirectory();
+    } catch (const std::exception &e) { // e.g. std::bad_alloc
+        fmt::print(stderr, "General error during scan of {}: {}\n", tree.rootPath().string(), e.what());
+        return std::unexpected(scan_status::error);
+    }
+    return tree;
+}
+
+std::expected<DirectoryTree, scan_status> scan_template_directory(const std::string &template_name, const std::string &templates_base_dir,
+                                                                  flat_tree_t, ThreadPool &pool) {
+#if defined(__unix__) || defined(__APPLE__)
+    ScopedTimer timer(stats_phase::scan);
+
+    auto canonical_root_or = resolve_template_root(fs::path(templates_base_dir) / template_name);
+    if (!canonical_root_or) {
+        return std::unexpected(canonical_root_or.error());
+    }
+
+    DirectoryTree tree(canonical_root_or.value());
+    try {
+        ListedDirectory root;
+        pool.submit([&root, &tree, &pool] {
+            list_directory_task(std::make_shared<OpenDirectory>(), tree.rootPath().string(), tree.rootPath(), root, pool);
+        });
+        pool.wait();
+
+        tree.openDirectory("");
+        merge_listing(root, tree);
+        tree.closeDirectory();
+    } catch (const std::exception &e) { // e.g. std::bad_alloc
+        fmt::print(stderr, "General error during scan of {}: {}\n", tree.rootPath().string(), e.what());
+        return std::unexpected(scan_status::error);
+    }
+    return tree;
+#else
+    (void)pool;
+    return scan_template_directory(template_name, templates_base_dir, flat_tree);
+#endif
+}
+
+} // namespace cgen
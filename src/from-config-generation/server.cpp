@@ -0,0 +1,455 @@
+#include "cgen/server.h"
+
+#include "cgen/staging.h"
+#include "cgen/template_cache.h"
+#include "cgen/thread_pool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace cgen {
+namespace {
+
+constexpr std::string_view request_header   = "cgen-request 1";
+constexpr std::size_t      max_request_size = 1024 * 1024;
+
+// Paths and values travel on a single line
+std::string escape(std::string_view text) {
+    std::string escaped;
+    for (char c : text) {
+        switch (c) {
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\r': escaped += "\\r"; break;
+        default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::optional<std::string> unescape(std::string_view text) {
+    std::string unescaped;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (text[i] != '\\') {
+            unescaped += text[i];
+            continue;
+        }
+        if (++i == text.size()) {
+            return std::nullopt;
+        }
+        switch (text[i]) {
+        case '\\': unescaped += '\\'; break;
+        case 'n': unescaped += '\n'; break;
+        case 'r': unescaped += '\r'; break;
+        default: return std::nullopt;
+        }
+    }
+    return unescaped;
+}
+
+// Split "key rest of line" at the first space
+std::pair<std::string_view, std::string_view> split_field(std::string_view line) {
+    auto space = line.find(' ');
+    if (space == std::string_view::npos) {
+        return {line, {}};
+    }
+    return {line.substr(0, space), line.substr(space + 1)};
+}
+
+} // namespace
+
+std::string encode_request(const ServerRequest &request) {
+    std::string text = fmt::format("{}\n", request_header);
+    switch (request.command) {
+    case server_command::ping: text += "ping\n"; break;
+    case server_command::shutdown: text += "shutdown\n"; break;
+    case server_command::generate: {
+        text += fmt::format("generate {}\n", escape(request.template_name));
+        text += fmt::format("output {}\n", escape(request.output_dir.string()));
+        text += fmt::format("incremental {}\n", request.incremental ? 1 : 0);
+        text += fmt::format("staging {}\n", request.staging ? 1 : 0);
+        if (request.io) {
+            text += fmt::format("io {}\n", *request.io == io_backend::io_uring ? "io_uring" : "blocking");
+        }
+
+        // Sorted, so equal requests are encoded identically
+        std::vector<std::pair<std::string, std::string>> values(request.values.begin(), request.values.end());
+        std::sort(values.begin(), values.end());
+        for (const auto &[name, value] : values) {
+            text += fmt::format("value {} {}\n", escape(name), escape(value));
+        }
+        break;
+    }
+    }
+    text += "end\n";
+    return text;
+}
+
+std::optional<ServerRequest> decode_request(std::string_view text) {
+    std::vector<std::string_view> lines;
+    while (!text.empty()) {
+        auto newline = text.find('\n');
+        if (newline == std::string_view::npos) {
+            return std::nullopt; // Every line, including the last, ends with a line break
+        }
+        lines.push_back(text.substr(0, newline));
+        text.remove_prefix(newline + 1);
+    }
+    if (lines.size() < 3 || lines.front() != request_header || lines.back() != "end") {
+        return std::nullopt;
+    }
+
+    ServerRequest request;
+    auto [command, name] = split_field(lines[1]);
+    if (command == "ping" && name.empty()) {
+        request.command = server_command::ping;
+    } else if (command == "shutdown" && name.empty()) {
+        request.command = server_command::shutdown;
+    } else if (command == "generate") {
+        auto template_name = unescape(name);
+        if (!template_name || template_name->empty()) {
+            return std::nullopt;
+        }
+        request.command       = server_command::generate;
+        request.template_name = std::move(*template_name);
+    } else {
+        return std::nullopt;
+    }
+
+    for (std::size_t i = 2; i + 1 < lines.size(); ++i) {
+        auto [key, rest] = split_field(lines[i]);
+        if (request.command != server_command::generate) {
+            return std::nullopt;
+        }
+        if (key == "output") {
+            auto output = unescape(rest);
+            if (!output) {
+                return std::nullopt;
+            }
+            request.output_dir = std::move(*output);
+        } else if (key == "incremental" && (rest == "0" || rest == "1")) {
+            request.incremental = rest == "1";
+        } else if (key == "staging" && (rest == "0" || rest == "1")) {
+            request.staging = rest == "1";
+        } else if (key == "io" && (rest == "blocking" || rest == "io_uring")) {
+            request.io = rest == "io_uring" ? io_backend::io_uring : io_backend::blocking;
+        } else if (key == "value") {
+            auto [value_name, value_text] = split_field(rest);
+            auto value_name_unescaped     = unescape(value_name);
+            auto value                    = unescape(value_text);
+            if (!value_name_unescaped || value_name_unescaped->empty() || !value) {
+                return std::nullopt;
+            }
+            request.values[std::move(*value_name_unescaped)] = std::move(*value);
+        } else {
+            return std::nullopt;
+        }
+    }
+    if (request.command == server_command::generate && request.output_dir.empty()) {
+        return std::nullopt;
+    }
+    return request;
+}
+
+fs::path default_socket_path() {
+    if (const char *runtime_dir = std::getenv("XDG_RUNTIME_DIR"); runtime_dir && *runtime_dir) {
+        return fs::path(runtime_dir) / "cgen.sock";
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    return fs::temp_directory_path() / fmt::format("cgen-{}.sock", ::getuid());
+#else
+    return fs::temp_directory_path() / "cgen.sock";
+#endif
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+namespace {
+
+#if defined(MSG_NOSIGNAL)
+constexpr int send_flags = MSG_NOSIGNAL; // A client that hung up must not kill the server
+#else
+constexpr int send_flags = 0;
+#endif
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+extern "C" void request_stop(int) { stop_requested = 1; }
+
+std::error_code last_error() { return std::error_code(errno, std::generic_category()); }
+
+std::optional<sockaddr_un> socket_address(const fs::path &path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const std::string native = path.string();
+    if (native.empty() || native.size() >= sizeof(address.sun_path)) {
+        return std::nullopt;
+    }
+    std::copy(native.begin(), native.end(), address.sun_path);
+    return address;
+}
+
+bool send_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t sent = ::send(fd, data.data(), data.size(), send_flags);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(sent));
+    }
+    return true;
+}
+
+// Read until the peer stops sending, `done` reports a complete message, or `limit` bytes arrived
+template <typename Done> bool receive(int fd, std::string &data, std::size_t limit, Done &&done) {
+    char buffer[4096];
+    while (!done(data)) {
+        ssize_t received = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0) {
+            return false;
+        }
+        if (received == 0) {
+            return true;
+        }
+        data.append(buffer, static_cast<std::size_t>(received));
+        if (data.size() > limit) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void set_timeouts(int fd, int seconds) {
+    timeval timeout{seconds, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+bool valid_template_name(const std::string &name) {
+    // Same rule as list_templates, and never a path leading out of the templates directory
+    return !name.empty() && !name.starts_with('_') && !name.starts_with('.') && name.find_first_of("/\\") == std::string::npos;
+}
+
+struct Server {
+    const ServeOptions         &options;
+    const PlaceholderProcessor &processor;
+    ThreadPool                  pool;
+    TemplateCache               cache;
+    bool                        stopping = false;
+
+    Server(const ServeOptions &serve_options, const PlaceholderProcessor &placeholder_processor)
+        : options(serve_options), processor(placeholder_processor), pool(serve_options.generate.jobs),
+          cache(serve_options.templates_base_dir, placeholder_processor, serve_options.generate) {}
+
+    // The single line answered to a request
+    std::string execute(const ServerRequest &request) {
+        switch (request.command) {
+        case server_command::ping: return "ok\n";
+        case server_command::shutdown: stopping = true; return "ok\n";
+        case server_command::generate: break;
+        }
+
+        if (!valid_template_name(request.template_name)) {
+            return fmt::format("error invalid template name '{}'\n", escape(request.template_name));
+        }
+        if (!request.output_dir.is_absolute()) {
+            return fmt::format("error output directory '{}' is not absolute\n", escape(request.output_dir.string()));
+        }
+        if (request.incremental && request.staging) {
+            return "error staging replaces the whole output and cannot be combined with incremental generation\n";
+        }
+
+        fmt::print("Generating project from template '{}' into directory '{}'\n", request.template_name, request.output_dir.string());
+        auto prepared_or = cache.get(request.template_name, pool);
+        if (!prepared_or) {
+            return fmt::format("error template '{}' could not be prepared\n", escape(request.template_name));
+        }
+        auto output_base_path_or = ensure_output_directory(request.output_dir);
+        if (!output_base_path_or) {
+            return fmt::format("error output directory '{}' could not be created\n", escape(request.output_dir.string()));
+        }
+        io_backend io = request.io.value_or(options.generate.io);
+        std::expected<void, generate_status> generated_or;
+        if (request.incremental) {
+            generated_or = generate_incremental(*prepared_or.value(), output_base_path_or.value(), request.values, pool);
+        } else if (request.staging) {
+            generated_or = generate_staged(*prepared_or.value(), output_base_path_or.value(), request.values, pool, io);
+        } else {
+            generated_or = generate_project(*prepared_or.value(), output_base_path_or.value(), request.values, pool, nullptr, true, io);
+        }
+        std::fflush(stdout);
+        return generated_or ? "ok\n" : "error generation failed, see the server log\n";
+    }
+
+    void handle(int client) {
+        set_timeouts(client, 30);
+        std::string data;
+        bool        complete = receive(client, data, max_request_size, [](const std::string &text) {
+            return text.ends_with("\nend\n"); // The last line of every request
+        });
+
+        std::string response;
+        if (auto request = complete ? decode_request(data) : std::nullopt) {
+            try {
+                response = execute(*request);
+            } catch (const std::exception &e) {
+                response = fmt::format("error {}\n", escape(e.what()));
+            }
+        } else {
+            response = "error malformed request\n";
+        }
+        send_all(client, response);
+    }
+};
+
+} // namespace
+
+std::expected<void, generate_status> serve(const ServeOptions &options, const PlaceholderProcessor &processor) {
+    auto address = socket_address(options.socket_path);
+    if (!address) {
+        fmt::print(stderr, "Error: Invalid socket path: {}\n", options.socket_path.string());
+        return std::unexpected(generate_status::error);
+    }
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        fmt::print(stderr, "Error: Could not create socket: {}\n", last_error().message());
+        return std::unexpected(generate_status::error);
+    }
+    ::fcntl(listener, F_SETFD, FD_CLOEXEC);
+
+    // A socket file left behind by a crashed server is replaced, a live server or any other file is not
+    std::error_code ec;
+    if (fs::exists(fs::symlink_status(options.socket_path, ec))) {
+        int  probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        bool live  = probe >= 0 && ::connect(probe, reinterpret_cast<const sockaddr *>(&*address), sizeof(*address)) == 0;
+        if (probe >= 0) {
+            ::close(probe);
+        }
+        if (live || !fs::is_socket(fs::symlink_status(options.socket_path, ec))) {
+            fmt::print(stderr, "Error: {} is {}\n", options.socket_path.string(), live ? "in use by a running server" : "not a socket");
+            ::close(listener);
+            return std::unexpected(generate_status::error);
+        }
+        fs::remove(options.socket_path, ec);
+    }
+
+    // The socket is created with mode 0600, so no other user can connect between bind() and a chmod()
+    mode_t previous_umask = ::umask(0177);
+    bool   bound          = ::bind(listener, reinterpret_cast<const sockaddr *>(&*address), sizeof(*address)) == 0;
+    int    bind_errno     = errno;
+    ::umask(previous_umask);
+    errno = bind_errno;
+    if (!bound || ::listen(listener, SOMAXCONN) != 0) {
+        fmt::print(stderr, "Error: Could not listen on {}: {}\n", options.socket_path.string(), last_error().message());
+        ::close(listener);
+        return std::unexpected(generate_status::error);
+    }
+
+    // No SA_RESTART, so a signal interrupts poll() and the loop can exit
+    struct sigaction stop_action {};
+    struct sigaction previous_int {};
+    struct sigaction previous_term {};
+    stop_action.sa_handler = request_stop;
+    sigemptyset(&stop_action.sa_mask);
+    stop_requested = 0;
+    ::sigaction(SIGINT, &stop_action, &previous_int);
+    ::sigaction(SIGTERM, &stop_action, &previous_term);
+
+    std::expected<void, generate_status> result;
+    try {
+        Server server(options, processor);
+        fmt::print("Serving templates from '{}' on {}\n", options.templates_base_dir, options.socket_path.string());
+        std::fflush(stdout);
+
+        while (!server.stopping && !stop_requested) {
+            pollfd fds[2] = {{listener, POLLIN, 0}, {server.cache.changeDescriptor(), POLLIN, 0}};
+            int    ready  = ::poll(fds, fds[1].fd >= 0 ? 2 : 1, -1);
+            if (ready < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                fmt::print(stderr, "Error: poll failed: {}\n", last_error().message());
+                result = std::unexpected(generate_status::error);
+                break;
+            }
+            if (fds[1].fd >= 0 && (fds[1].revents & POLLIN)) {
+                server.cache.processChanges();
+            }
+            if (fds[0].revents & POLLIN) {
+                int client = ::accept(listener, nullptr, nullptr);
+                if (client >= 0) {
+                    ::fcntl(client, F_SETFD, FD_CLOEXEC);
+                    server.handle(client);
+                    ::close(client);
+                }
+            }
+        }
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "Error: {}\n", e.what());
+        result = std::unexpected(generate_status::error);
+    }
+
+    ::sigaction(SIGINT, &previous_int, nullptr);
+    ::sigaction(SIGTERM, &previous_term, nullptr);
+    ::close(listener);
+    fs::remove(options.socket_path, ec);
+    fmt::print("Server on {} stopped\n", options.socket_path.string());
+    return result;
+}
+
+std::expected<void, generate_status> send_request(const fs::path &socket_path, const ServerRequest &request) {
+    auto address = socket_address(socket_path);
+    if (!address) {
+        fmt::print(stderr, "Error: Invalid socket path: {}\n", socket_path.string());
+        return std::unexpected(generate_status::error);
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr *>(&*address), sizeof(*address)) != 0) {
+        fmt::print(stderr, "Error: Could not connect to the cgen server at {}: {}\n", socket_path.string(), last_error().message());
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return std::unexpected(generate_status::error);
+    }
+
+    std::string response;
+    bool        delivered = send_all(fd, encode_request(request)) && ::shutdown(fd, SHUT_WR) == 0 &&
+                     receive(fd, response, max_request_size, [](const std::string &text) { return text.find('\n') != std::string::npos; });
+    ::close(fd);
+
+    if (!delivered || response.empty()) {
+        fmt::print(stderr, "Error: No answer from the cgen server at {}\n", socket_path.string());
+        return std::unexpected(generate_status::error);
+    }
+    if (response != "ok\n") {
+        std::string_view reason = std::string_view(response).substr(0, response.find('\n'));
+        reason.remove_prefix(reason.starts_with("error ") ? 6 : 0);
+        fmt::print(stderr, "Error: The cgen server could not complete the request: {}\n", reason);
+        return std::unexpected(generate_status::error);
+    }
+    return {};
+}
+#endif
+
+} // namespace cgen
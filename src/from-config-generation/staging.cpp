@@ -0,0 +1,211 @@
+#include "cgen/staging.h"
+
+#include "cgen/generation_manifest.h"
+#include "cgen/trace.h"
+
+#include <fmt/core.h>
+#include <optional>
+#include <random>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace cgen {
+namespace {
+
+std::error_code last_error() { return std::error_code(errno, std::generic_category()); }
+
+// An existing output may only be replaced if nothing would be lost that cgen did not generate
+bool is_replaceable(const fs::path &output_dir, std::error_code &ec) {
+    if (!fs::is_directory(output_dir, ec)) {
+        return false;
+    }
+    return fs::is_empty(output_dir, ec) || fs::exists(GenerationManifest::manifestPath(output_dir), ec);
+}
+
+// First entry of a previously generated output that replacing it would lose: anything its manifest does not list, or a
+// listed file that was changed since. Directories only count for what they contain.
+std::optional<fs::path> unmanaged_entry(const fs::path &output_dir, std::error_code &ec) {
+    GenerationManifest manifest      = GenerationManifest::load(output_dir);
+    fs::path           manifest_path = GenerationManifest::manifestPath(output_dir);
+    for (fs::recursive_directory_iterator it(output_dir, ec), end; !ec && it != end; it.increment(ec)) {
+        fs::file_status status = it->symlink_status(ec);
+        if (ec) {
+            break;
+        }
+        if (fs::is_directory(status) || it->path() == manifest_path) {
+            continue;
+        }
+
+        fs::path             relative = it->path().lexically_relative(output_dir);
+        const ManifestEntry *recorded = manifest.find(relative);
+        if (recorded == nullptr || !fs::is_regular_file(status)) {
+            return relative;
+        }
+        if (output_stamp(it->path()) == recorded->stamp) {
+            continue;
+        }
+        auto hash_or = hash_file(it->path());
+        if (!hash_or || *hash_or != recorded->output_hash) {
+            return relative;
+        }
+    }
+    return std::nullopt;
+}
+
+// Flush everything written below `dir` to disk
+std::expected<void, std::error_code> sync_tree(const fs::path &dir) {
+#if defined(__linux__)
+    // One syncfs flushes every file of the staging directory, instead of one fsync per file
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return std::unexpected(last_error());
+    }
+    int synced = ::syncfs(fd);
+    int error  = errno;
+    ::close(fd);
+    if (synced != 0) {
+        return std::unexpected(std::error_code(error, std::generic_category()));
+    }
+#elif defined(__unix__) || defined(__APPLE__)
+    (void)dir;
+    ::sync();
+#else
+    (void)dir;
+#endif
+    return {};
+}
+
+// Make a rename in `dir` durable
+void sync_directory(const fs::path &dir) {
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+#else
+    (void)dir;
+#endif
+}
+
+// Swap two directories in one step, false if the platform or filesystem cannot
+bool exchange_directories(const fs::path &a, const fs::path &b) {
+#if defined(__linux__) && defined(RENAME_EXCHANGE)
+    return ::renameat2(AT_FDCWD, a.c_str(), AT_FDCWD, b.c_str(), RENAME_EXCHANGE) == 0;
+#else
+    (void)a;
+    (void)b;
+    return false;
+#endif
+}
+
+// Move the staged project onto the output path, the previous project (if any) ends up in `staging_dir`
+std::expected<void, std::error_code> publish(const fs::path &staging_dir, const fs::path &output_dir) {
+    std::error_code ec;
+    if (!fs::exists(output_dir, ec)) {
+        fs::rename(staging_dir, output_dir, ec);
+        return ec ? std::unexpected(ec) : std::expected<void, std::error_code>();
+    }
+    if (exchange_directories(staging_dir, output_dir)) {
+        return {};
+    }
+
+    // Two renames: readers may briefly find no output at all, but never a partial one
+    fs::path previous = staging_dir;
+    previous += ".previous";
+    fs::rename(output_dir, previous, ec);
+    if (ec) {
+        return std::unexpected(ec);
+    }
+    fs::rename(staging_dir, output_dir, ec);
+    if (ec) {
+        std::error_code restore_ec;
+        fs::rename(previous, output_dir, restore_ec);
+        return std::unexpected(ec);
+    }
+    fs::rename(previous, staging_dir, ec); // So the caller removes it like an exchanged tree
+    return {};
+}
+
+} // namespace
+
+std::expected<void, generate_status> generate_staged(const PreparedTemplate &prepared, const fs::path &output_dir,
+                                                     const std::unordered_map<std::string, std::string> &values, ThreadPool &pool,
+                                                     io_backend io) {
+    fs::path output = fs::absolute(output_dir).lexically_normal();
+    if (!output.has_filename()) {
+        output = output.parent_path(); // A trailing separator
+    }
+
+    std::error_code ec;
+    if (fs::exists(output, ec)) {
+        if (!is_replaceable(output, ec)) {
+            fmt::print(stderr, "Error: {} is not empty and was not generated by cgen, refusing to replace it with a staged project\n",
+                       output.string());
+            return std::unexpected(generate_status::error);
+        }
+        if (auto kept = unmanaged_entry(output, ec); kept || ec) {
+            if (ec) {
+                fmt::print(stderr, "Error: Could not check {} before replacing it: {}\n", output.string(), ec.message());
+            } else {
+                fmt::print(stderr, "Error: {} was not generated by cgen or was changed since, refusing to replace {}\n",
+                           (output / *kept).string(), output.string());
+            }
+            return std::unexpected(generate_status::error);
+        }
+    }
+
+    fs::path staging_dir =
+        output.parent_path() / fmt::format(".{}.cgen-staging-{:08x}", output.filename().string(), std::random_device{}());
+    if (!fs::create_directory(staging_dir, ec) || ec) {
+        fmt::print(stderr, "Error: Could not create staging directory {}: {}\n", staging_dir.string(),
+                   ec ? ec.message() : std::string("it already exists"));
+        return std::unexpected(generate_status::error);
+    }
+    auto discard = [&staging_dir] {
+        std::error_code remove_ec;
+        fs::remove_all(staging_dir, remove_ec);
+    };
+
+    GenerationManifest manifest;
+    auto               generated_or = generate_project(prepared, staging_dir, values, pool, &manifest, false, io);
+    if (!generated_or) {
+        discard();
+        return generated_or;
+    }
+    if (auto saved_or = manifest.save(staging_dir); !saved_or) {
+        fmt::print(stderr, "Error: Could not write {}: {}\n", GenerationManifest::manifestPath(staging_dir).string(),
+                   saved_or.error().message());
+        discard();
+        return std::unexpected(generate_status::error);
+    }
+
+    {
+        TraceScope trace("sync", "staging", staging_dir);
+        if (auto synced_or = sync_tree(staging_dir); !synced_or) {
+            fmt::print(stderr, "Error: Could not flush {} to disk: {}\n", staging_dir.string(), synced_or.error().message());
+            discard();
+            return std::unexpected(generate_status::error);
+        }
+    }
+
+    TraceScope trace("publish", "staging", output);
+    if (auto published_or = publish(staging_dir, output); !published_or) {
+        fmt::print(stderr, "Error: Could not move {} into place at {}: {}\n", staging_dir.string(), output.string(),
+                   published_or.error().message());
+        discard();
+        return std::unexpected(generate_status::error);
+    }
+    sync_directory(output.parent_path());
+    discard(); // Now the previous project, if there was one
+
+    fmt::print("Generated {} files into {}\n", manifest.size(), output.string());
+    return {};
+}
+
+} // namespace cgen
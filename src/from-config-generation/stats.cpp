@@ -0,0 +1,108 @@
+#include "cgen/stats.h"
+
+#include <fmt/core.h>
+#include <fstream>
+#include <optional>
+#include <string_view>
+
+namespace cgen {
+namespace {
+
+constexpr std::array<std::string_view, stats_phase_count> phase_names = {"scan",   "canonicalize", "read", "compile", "prepare",
+                                                                         "render", "write",        "copy", "generate"};
+
+constexpr std::array<std::string_view, stats_counter_count> counter_names = {
+    "directories_scanned", "files_scanned", "files_read",    "bytes_read",     "placeholders_matched", "placeholders_substituted",
+    "files_written",       "bytes_written", "files_unchanged"};
+
+// Phases that run on the worker pool, or on the calling thread beside it with io_uring; their times add up over all threads
+bool is_worker_phase(stats_phase phase) {
+    return phase == stats_phase::read || phase == stats_phase::compile || phase == stats_phase::render || phase == stats_phase::write ||
+           phase == stats_phase::copy;
+}
+
+struct ProcessIo {
+    std::uint64_t read_syscalls  = 0;
+    std::uint64_t write_syscalls = 0;
+};
+
+// Read and write system calls of this process so far, as counted by the kernel
+std::optional<ProcessIo> process_io() {
+    std::ifstream in("/proc/self/io");
+    if (!in) {
+        return std::nullopt;
+    }
+    ProcessIo     io;
+    bool          found = false;
+    std::string   key;
+    std::uint64_t value = 0;
+    while (in >> key >> value) {
+        if (key == "syscr:") {
+            io.read_syscalls = value;
+            found            = true;
+        } else if (key == "syscw:") {
+            io.write_syscalls = value;
+        }
+    }
+    return found ? std::optional<ProcessIo>(io) : std::nullopt;
+}
+
+double milliseconds(std::chrono::nanoseconds elapsed) { return static_cast<double>(elapsed.count()) / 1e6; }
+
+} // namespace
+
+void Statistics::reset() {
+    for (auto &counter : counters_) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    for (auto &time : nanoseconds_) {
+        time.store(0, std::memory_order_relaxed);
+    }
+}
+
+Statistics &statistics() {
+    static Statistics instance;
+    return instance;
+}
+
+std::string_view phase_name(stats_phase phase) { return phase_names[static_cast<std::size_t>(phase)]; }
+
+std::string format_stats(const Statistics &stats, std::chrono::nanoseconds wall_time, stats_format format) {
+    auto        io = process_io();
+    std::string out;
+
+    if (format == stats_format::json) {
+        out += fmt::format("{{\"wall_ms\": {:.3f}, \"phases_ms\": {{", milliseconds(wall_time));
+        for (std::size_t i = 0; i < stats_phase_count; ++i) {
+            auto phase = static_cast<stats_phase>(i);
+            out += fmt::format("{}\"{}\": {:.3f}", i == 0 ? "" : ", ", phase_names[i], milliseconds(stats.time(phase)));
+        }
+        out += "}, \"counters\": {";
+        for (std::size_t i = 0; i < stats_counter_count; ++i) {
+            out += fmt::format("{}\"{}\": {}", i == 0 ? "" : ", ", counter_names[i], stats.count(static_cast<stats_counter>(i)));
+        }
+        out += "}";
+        if (io) {
+            out += fmt::format(", \"process\": {{\"read_syscalls\": {}, \"write_syscalls\": {}}}", io->read_syscalls, io->write_syscalls);
+        }
+        out += "}\n";
+        return out;
+    }
+
+    out += fmt::format("Statistics (wall time {:.3f} ms)\n", milliseconds(wall_time));
+    for (std::size_t i = 0; i < stats_phase_count; ++i) {
+        auto phase = static_cast<stats_phase>(i);
+        out += fmt::format("  {:<26}{:>12.3f} ms{}\n", phase_names[i], milliseconds(stats.time(phase)),
+                           is_worker_phase(phase) ? "  (summed over threads)" : "");
+    }
+    for (std::size_t i = 0; i < stats_counter_count; ++i) {
+        out += fmt::format("  {:<26}{:>12}\n", counter_names[i], stats.count(static_cast<stats_counter>(i)));
+    }
+    if (io) {
+        out += fmt::format("  {:<26}{:>12}\n", "read_syscalls", io->read_syscalls);
+        out += fmt::format("  {:<26}{:>12}\n", "write_syscalls", io->write_syscalls);
+    }
+    return out;
+}
+
+} // namespace cgen
@@ -0,0 +1,165 @@
+#include "cgen/streaming_renderer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+namespace cgen {
+
+StreamingRenderer::StreamingRenderer(const PlaceholderProcessor &processor, const std::unordered_map<std::string, std::string> &values,
+                                     RenderSink sink)
+    : scanner_(processor.scanner()), values_(values), sink_(std::move(sink)) {}
+
+std::size_t StreamingRenderer::process(std::string_view text) {
+    std::size_t pos = 0;
+    while (auto match = scanner_.next(text, pos)) {
+        if (match->offset > pos) {
+            sink_(text.substr(pos, match->offset - pos));
+        }
+        name_.assign(match->name(text));
+        auto it = values_.find(name_);
+        sink_(it != values_.end() ? std::string_view(it->second) : text.substr(match->offset, match->length));
+        pos = match->offset + match->length;
+    }
+
+    // A delimiter followed only by name characters may still be closed by the next chunk
+    std::size_t run = text.size();
+    while (run > pos && PlaceholderScanner::isBodyChar(text[run - 1])) {
+        --run;
+    }
+    std::size_t keep = text.size();
+    if (run > pos && scanner_.isDelimiter(text[run - 1]) && text.size() - (run - 1) < max_token_length) {
+        keep = run - 1;
+    }
+
+    if (keep > pos) {
+        sink_(text.substr(pos, keep - pos));
+    }
+    return keep;
+}
+
+void StreamingRenderer::write(std::string_view chunk) {
+    if (!pending_.empty()) {
+        // Decide the held-back token with at most one token's worth of the new chunk
+        std::size_t borrowed = std::min(chunk.size(), max_token_length);
+        pending_.append(chunk.substr(0, borrowed));
+        pending_.erase(0, process(pending_));
+        if (borrowed == chunk.size()) {
+            return;
+        }
+        // The new tail is shorter than max_token_length, so it lies entirely in the borrowed bytes
+        assert(pending_.size() <= borrowed);
+        chunk.remove_prefix(borrowed - pending_.size());
+        pending_.clear();
+    }
+
+    std::size_t consumed = process(chunk);
+    pending_.assign(chunk.substr(consumed));
+}
+
+void StreamingRenderer::finish() {
+    if (!pending_.empty()) {
+        sink_(pending_);
+        pending_.clear();
+    }
+}
+
+std::expected<void, std::error_code> render_stream(const PlaceholderProcessor &processor, std::istream &in,
+                                                   const std::unordered_map<std::string, std::string> &values, const RenderSink &sink,
+                                                   std::size_t chunk_size) {
+    StreamingRenderer renderer(processor, values, sink);
+    std::string       buffer(std::max<std::size_t>(chunk_size, 1), '\0');
+    while (in) {
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (auto count = in.gcount(); count > 0) {
+            renderer.write(std::string_view(buffer.data(), static_cast<std::size_t>(count)));
+        }
+    }
+    if (in.bad()) {
+        return std::unexpected(std::make_error_code(std::errc::io_error));
+    }
+    renderer.finish();
+    return {};
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+namespace {
+
+std::error_code write_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t count = ::write(fd, data.data(), data.size());
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return std::error_code(errno, std::generic_category());
+        }
+        data.remove_prefix(static_cast<std::size_t>(count));
+    }
+    return {};
+}
+
+} // namespace
+
+std::expected<void, std::error_code> render_stream(const PlaceholderProcessor &processor, int in_fd, int out_fd,
+                                                   const std::unordered_map<std::string, std::string> &values, std::size_t chunk_size) {
+    chunk_size = std::max<std::size_t>(chunk_size, 1);
+
+    // Output pieces are collected into one chunk-sized buffer, so small literals and values cost no syscall
+    std::string     output;
+    std::error_code error;
+    output.reserve(chunk_size);
+    auto flush = [&] {
+        if (!error) {
+            error = write_all(out_fd, output);
+        }
+        output.clear();
+    };
+
+    StreamingRenderer renderer(processor, values, [&](std::string_view piece) {
+        if (error) {
+            return;
+        }
+        if (output.size() + piece.size() > chunk_size) {
+            flush();
+        }
+        if (piece.size() >= chunk_size) {
+            error = write_all(out_fd, piece); // Large values bypass the buffer
+        } else {
+            output.append(piece);
+        }
+    });
+
+    std::string input(chunk_size, '\0');
+    for (;;) {
+        ssize_t count = ::read(in_fd, input.data(), input.size());
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return std::unexpected(std::error_code(errno, std::generic_category()));
+        }
+        if (count == 0) {
+            break;
+        }
+        renderer.write(std::string_view(input.data(), static_cast<std::size_t>(count)));
+        if (error) {
+            return std::unexpected(error);
+        }
+    }
+
+    renderer.finish();
+    flush();
+    if (error) {
+        return std::unexpected(error);
+    }
+    return {};
+}
+#endif
+
+} // namespace cgen
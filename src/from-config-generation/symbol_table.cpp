@@ -0,0 +1,53 @@
+#include "cgen/symbol_table.h"
+
+#include <mutex>
+
+namespace cgen {
+
+std::uint32_t SymbolTable::intern(std::string_view name) {
+    {
+        std::shared_lock lock(mutex_);
+        if (auto it = ids_.find(name); it != ids_.end()) {
+            return it->second;
+        }
+    }
+    std::unique_lock lock(mutex_);
+    if (auto it = ids_.find(name); it != ids_.end()) {
+        return it->second; // Interned by another thread in between
+    }
+    auto id = static_cast<std::uint32_t>(names_.size());
+    names_.emplace_back(name);
+    ids_.emplace(names_.back(), id);
+    return id;
+}
+
+std::optional<std::uint32_t> SymbolTable::find(std::string_view name) const {
+    std::shared_lock lock(mutex_);
+    if (auto it = ids_.find(name); it != ids_.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+std::string_view SymbolTable::name(std::uint32_t id) const {
+    std::shared_lock lock(mutex_);
+    return names_.at(id);
+}
+
+std::size_t SymbolTable::size() const {
+    std::shared_lock lock(mutex_);
+    return names_.size();
+}
+
+SymbolValues SymbolTable::bind(const std::unordered_map<std::string, std::string> &values) const {
+    std::shared_lock lock(mutex_);
+    SymbolValues     bound(names_.size());
+    for (const auto &[name, value] : values) {
+        if (auto it = ids_.find(std::string_view(name)); it != ids_.end()) {
+            bound.values_[it->second] = value;
+        }
+    }
+    return bound;
+}
+
+} // namespace cgen
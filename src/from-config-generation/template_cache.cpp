@@ -0,0 +1,182 @@
+#include "cgen/template_cache.h"
+
+#include <fmt/core.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace cgen {
+namespace {
+
+#if defined(__linux__)
+// Anything that can change the tree or the contents of a template
+constexpr std::uint32_t watch_mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF |
+                                     IN_MOVE_SELF | IN_ONLYDIR;
+#endif
+
+} // namespace
+
+TemplateCache::TemplateCache(std::string templates_base_dir, const PlaceholderProcessor &processor, GenerateOptions options)
+    : templatesBaseDir_(std::move(templates_base_dir)), processor_(processor), options_(options) {
+#if defined(__linux__)
+    inotify_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_ < 0) {
+        fmt::print(stderr, "Warning: inotify is unavailable, templates will not be cached\n");
+    }
+#endif
+}
+
+TemplateCache::~TemplateCache() {
+#if defined(__linux__)
+    if (inotify_ >= 0) {
+        ::close(inotify_);
+    }
+#endif
+}
+
+std::expected<const PreparedTemplate *, generate_status> TemplateCache::get(const std::string &template_name, ThreadPool &pool) {
+    processChanges();
+    if (auto it = entries_.find(template_name); it != entries_.end()) {
+        return &it->second.prepared;
+    }
+
+    auto tree_or = load_template_tree(template_name, templatesBaseDir_, options_, &pool);
+    if (!tree_or) {
+        fmt::print(stderr, "Error scanning template directory '{}'.\n", template_name);
+        return std::unexpected(generate_status::error);
+    }
+
+    // Watch before the files are read, so an edit made while preparing is not missed
+    auto watches = watch(template_name, tree_or.value());
+    if (watches.empty()) {
+        auto prepared_or = prepare_template(tree_or.value(), processor_, pool, options_.io, true);
+        if (!prepared_or) {
+            return std::unexpected(prepared_or.error());
+        }
+        uncached_ = std::move(prepared_or.value());
+        return &uncached_;
+    }
+
+    auto &entry   = entries_[template_name];
+    entry.watches = std::move(watches);
+
+    auto prepared_or = prepare_template(tree_or.value(), processor_, pool, options_.io, true);
+    if (!prepared_or) {
+        invalidate(template_name);
+        return std::unexpected(prepared_or.error());
+    }
+    entry.prepared = std::move(prepared_or.value());
+    return &entry.prepared;
+}
+
+std::vector<int> TemplateCache::watch(const std::string &template_name, const DirectoryTree &tree) {
+    std::vector<int> watches;
+#if defined(__linux__)
+    if (inotify_ < 0) {
+        return watches;
+    }
+
+    // A composed template goes stale when any of its layers changes, so every layer's directories are watched
+    std::vector<fs::path> relative(tree.nodes().size());
+    std::vector<fs::path> paths;
+    for (std::size_t i = 0; i < tree.nodes().size(); ++i) {
+        const auto &node = tree.nodes()[i];
+        if (node.parent != DirectoryTree::no_parent) {
+            relative[i] = relative[node.parent] / tree.name(node.name);
+        }
+        for (std::size_t layer = 0; layer < tree.layerCount(); ++layer) {
+            if (tree.nodeLayers(i) & (std::uint32_t{1} << layer)) {
+                paths.push_back(tree.layerRoot(layer) / relative[i]);
+            }
+        }
+    }
+
+    for (const auto &path : paths) {
+        int wd = ::inotify_add_watch(inotify_, path.c_str(), watch_mask);
+        if (wd < 0) {
+            // Typically the per-user watch limit: a partly watched template could go stale
+            fmt::print(stderr, "Warning: Could not watch {} ({}), template '{}' will not be cached\n", path.string(),
+                       std::error_code(errno, std::generic_category()).message(), template_name);
+            for (int added : watches) {
+                auto owners = watchOwners_.find(added);
+                if (owners != watchOwners_.end() && owners->second.size() == 1) {
+                    ::inotify_rm_watch(inotify_, added);
+                    watchOwners_.erase(owners);
+                } else if (owners != watchOwners_.end()) {
+                    owners->second.erase(template_name);
+                }
+            }
+            return {};
+        }
+        watches.push_back(wd);
+        watchOwners_[wd].insert(template_name);
+    }
+#else
+    (void)template_name;
+    (void)tree;
+#endif
+    return watches;
+}
+
+void TemplateCache::invalidate(const std::string &template_name) {
+    auto it = entries_.find(template_name);
+    if (it == entries_.end()) {
+        return;
+    }
+    for (int wd : it->second.watches) {
+        auto owners = watchOwners_.find(wd);
+        if (owners == watchOwners_.end()) {
+            continue;
+        }
+        owners->second.erase(template_name);
+        if (owners->second.empty()) {
+#if defined(__linux__)
+            ::inotify_rm_watch(inotify_, wd);
+#endif
+            watchOwners_.erase(owners);
+        }
+    }
+    entries_.erase(it);
+}
+
+void TemplateCache::processChanges() {
+#if defined(__linux__)
+    if (inotify_ < 0) {
+        return;
+    }
+    alignas(inotify_event) char buffer[16 * 1024];
+    for (;;) {
+        ssize_t length = ::read(inotify_, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break; // EAGAIN: no more pending events
+        }
+        for (char *p = buffer; p < buffer + length;) {
+            const auto *event = reinterpret_cast<const inotify_event *>(p);
+            p += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost, so any template may be stale
+                while (!entries_.empty()) {
+                    invalidate(entries_.begin()->first);
+                }
+                continue;
+            }
+            auto owners = watchOwners_.find(event->wd);
+            if (owners == watchOwners_.end()) {
+                continue;
+            }
+            std::set<std::string> names = owners->second; // invalidate() modifies the owner sets
+            if (event->mask & IN_IGNORED) {
+                watchOwners_.erase(owners); // The kernel already removed this watch
+            }
+            for (const auto &name : names) {
+                invalidate(name);
+            }
+        }
+    }
+#endif
+}
+
+} // namespace cgen
@@ -0,0 +1,413 @@
+#include "cgen/template_index.h"
+
+#include "cgen/stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fmt/core.h>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <random>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/stat.h>
+#endif
+
+namespace cgen {
+namespace {
+
+constexpr const char *index_file_name = ".cgen-index";
+constexpr const char *index_header    = "cgen-index 1";
+
+std::optional<IndexStamp> stat_path(const fs::path &path) {
+#if defined(__unix__) || defined(__APPLE__)
+    struct stat st {};
+    if (::stat(path.c_str(), &st) != 0) {
+        return std::nullopt;
+    }
+#if defined(__APPLE__)
+    const auto &mtime = st.st_mtimespec;
+#else
+    const auto &mtime = st.st_mtim;
+#endif
+    return IndexStamp{static_cast<std::int64_t>(mtime.tv_sec) * 1'000'000'000 + mtime.tv_nsec, static_cast<std::uint64_t>(st.st_ino),
+                      static_cast<std::uint64_t>(st.st_size)};
+#else
+    std::error_code ec;
+    auto            mtime = fs::last_write_time(path, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    std::uint64_t size = fs::is_regular_file(path, ec) ? fs::file_size(path, ec) : 0;
+    return IndexStamp{static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count()), 0,
+                      ec ? 0 : size};
+#endif
+}
+
+// Names are stored as single space-separated tokens
+std::string escape(const std::string &name) {
+    if (name.empty()) {
+        return "\\e";
+    }
+    std::string escaped;
+    for (char c : name) {
+        switch (c) {
+        case '\\': escaped += "\\\\"; break;
+        case ' ': escaped += "\\s"; break;
+        case '\t': escaped += "\\t"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\r': escaped += "\\r"; break;
+        default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::optional<std::string> unescape(const std::string &token) {
+    if (token == "\\e") {
+        return std::string{};
+    }
+    std::string name;
+    for (std::size_t i = 0; i < token.size(); ++i) {
+        if (token[i] != '\\') {
+            name += token[i];
+            continue;
+        }
+        if (++i == token.size()) {
+            return std::nullopt;
+        }
+        switch (token[i]) {
+        case '\\': name += '\\'; break;
+        case 's': name += ' '; break;
+        case 't': name += '\t'; break;
+        case 'n': name += '\n'; break;
+        case 'r': name += '\r'; break;
+        default: return std::nullopt;
+        }
+    }
+    return name;
+}
+
+void write_directory(const IndexedDirectory &dir, std::vector<std::string> &lines) {
+    lines.push_back(fmt::format("D {} {} {} {} {} {} {}", escape(dir.name), dir.stamp.mtime_ns, dir.stamp.inode, dir.stamp.size,
+                                dir.is_symlink ? 1 : 0, dir.files.size(), dir.directories.size()));
+    for (const auto &file : dir.files) {
+        lines.push_back(fmt::format("F {} {} {} {}", escape(file.name), file.stamp.mtime_ns, file.stamp.inode, file.stamp.size));
+    }
+    for (const auto &sub_dir : dir.directories) {
+        write_directory(sub_dir, lines);
+    }
+}
+
+bool read_directory(const std::vector<std::string> &lines, std::size_t &cursor, IndexedDirectory &dir) {
+    if (cursor >= lines.size()) {
+        return false;
+    }
+    std::istringstream line(lines[cursor++]);
+    std::string        tag, name;
+    int                is_symlink = 0;
+    std::size_t        file_count = 0, dir_count = 0;
+    if (!(line >> tag >> name >> dir.stamp.mtime_ns >> dir.stamp.inode >> dir.stamp.size >> is_symlink >> file_count >> dir_count) ||
+        tag != "D") {
+        return false;
+    }
+    auto unescaped = unescape(name);
+    if (!unescaped) {
+        return false;
+    }
+    dir.name       = std::move(*unescaped);
+    dir.is_symlink = is_symlink != 0;
+
+    dir.files.resize(file_count);
+    for (auto &file : dir.files) {
+        if (cursor >= lines.size()) {
+            return false;
+        }
+        std::istringstream file_line(lines[cursor++]);
+        if (!(file_line >> tag >> name >> file.stamp.mtime_ns >> file.stamp.inode >> file.stamp.size) || tag != "F") {
+            return false;
+        }
+        auto file_name = unescape(name);
+        if (!file_name) {
+            return false;
+        }
+        file.name = std::move(*file_name);
+    }
+
+    dir.directories.resize(dir_count);
+    for (auto &sub_dir : dir.directories) {
+        if (!read_directory(lines, cursor, sub_dir)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Every template section of an index file, keyed by template name, as raw lines
+std::map<std::string, std::vector<std::string>> read_index_file(const fs::path &path) {
+    std::map<std::string, std::vector<std::string>> sections;
+    std::ifstream                                   in(path);
+    std::string                                     line;
+    if (!in || !std::getline(in, line) || line != index_header) {
+        return sections;
+    }
+
+    std::vector<std::string> *current = nullptr;
+    while (std::getline(in, line)) {
+        if (line.starts_with("T ")) {
+            auto name = unescape(line.substr(2));
+            current   = name ? &sections[*name] : nullptr;
+        } else if (current) {
+            current->push_back(std::move(line));
+        }
+    }
+    return sections;
+}
+
+bool write_index_file(const fs::path &path, const std::map<std::string, std::vector<std::string>> &sections) {
+    fs::path temp_path = path;
+    temp_path += fmt::format(".tmp{}", std::random_device{}());
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out << index_header << '\n';
+        for (const auto &[name, lines] : sections) {
+            out << "T " << escape(name) << '\n';
+            for (const auto &line : lines) {
+                out << line << '\n';
+            }
+        }
+        if (!out.flush()) {
+            out.close();
+            std::error_code ec;
+            fs::remove(temp_path, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(temp_path, path, ec);
+    if (ec) {
+        fs::remove(temp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+struct RefreshCounters {
+    std::size_t directories = 0;
+    std::size_t files       = 0;
+};
+
+// Cached entries are sorted by name, so each listed entry is found with a binary search
+template <typename Entries> auto find_cached(Entries &entries, const std::string &name) -> decltype(entries.data()) {
+    auto it = std::lower_bound(entries.begin(), entries.end(), name,
+                               [](const auto &entry, const std::string &key) { return entry.name < key; });
+    return it != entries.end() && it->name == name ? &*it : nullptr;
+}
+
+// Bring a cached directory in sync with the filesystem, listing it again only if its own stamp changed.
+// `index_dir` is where the index file lives, its own files are never part of a template.
+void refresh_directory(IndexedDirectory &dir, const fs::path &path, const fs::path &index_dir, RefreshCounters &counters) {
+    if (dir.is_symlink) {
+        return;
+    }
+
+    auto stamp = stat_path(path);
+    if (!stamp) {
+        dir.files.clear();
+        dir.directories.clear();
+        return;
+    }
+
+    if (*stamp != dir.stamp) {
+        ++counters.directories;
+
+        std::vector<IndexedFile>      files;
+        std::vector<IndexedDirectory> directories;
+        std::error_code               ec;
+        for (fs::directory_iterator it(path, fs::directory_options::skip_permission_denied, ec), end; !ec && it != end; it.increment(ec)) {
+            const auto &entry = *it;
+            std::string name  = entry.path().filename().string();
+
+            if (path == index_dir && name.starts_with(index_file_name)) {
+                continue;
+            }
+
+            // The cached names are left in place, so the cached vectors stay sorted for the next lookup
+            std::error_code type_ec;
+            if (entry.is_regular_file(type_ec)) { // is_regular_file follows symlinks
+                const IndexedFile *cached = find_cached(dir.files, name);
+                files.push_back({name, cached ? cached->stamp : IndexStamp{}});
+            } else if (entry.is_directory(type_ec)) {
+                bool              is_symlink = entry.is_symlink(type_ec);
+                IndexedDirectory *cached     = find_cached(dir.directories, name);
+                if (cached && cached->is_symlink == is_symlink) {
+                    directories.push_back({name, cached->stamp, is_symlink, std::move(cached->files), std::move(cached->directories)});
+                } else {
+                    directories.push_back({name, {}, is_symlink, {}, {}});
+                }
+            }
+            // Other types (broken symlinks, sockets, devices, ...) are ignored, as in scan_template_directory
+        }
+        if (ec) {
+            fmt::print(stderr, "Error listing directory {}: {}\n", path.string(), ec.message());
+        }
+
+        std::sort(files.begin(), files.end(), [](const auto &a, const auto &b) { return a.name < b.name; });
+        std::sort(directories.begin(), directories.end(), [](const auto &a, const auto &b) { return a.name < b.name; });
+        dir.files       = std::move(files);
+        dir.directories = std::move(directories);
+        dir.stamp       = *stamp;
+    }
+
+    // Directory mtimes do not change when a file is edited in place, so files are always stat'ed
+    std::erase_if(dir.files, [&](IndexedFile &file) {
+        auto file_stamp = stat_path(path / file.name);
+        if (!file_stamp) {
+            return true;
+        }
+        if (*file_stamp != file.stamp) {
+            ++counters.files;
+            file.stamp = *file_stamp;
+        }
+        return false;
+    });
+
+    for (auto &sub_dir : dir.directories) {
+        refresh_directory(sub_dir, path / sub_dir.name, index_dir, counters);
+    }
+}
+
+std::shared_ptr<Directory> to_directory(const IndexedDirectory &dir, const fs::path &path) {
+    auto node  = std::make_shared<Directory>();
+    node->name = dir.name;
+    if (dir.is_symlink) {
+        std::error_code ec;
+        node->path = fs::weakly_canonical(path, ec);
+        if (ec) {
+            node->path = path;
+        }
+    } else {
+        node->path = path;
+    }
+    for (const auto &file : dir.files) {
+        node->files.insert(file.name);
+    }
+    for (const auto &sub_dir : dir.directories) {
+        node->directories.insert(to_directory(sub_dir, path / sub_dir.name));
+    }
+    return node;
+}
+
+// Append the contents of a cached directory to a flat tree, both keep entries sorted by name
+void add_to_tree(const IndexedDirectory &dir, DirectoryTree &tree) {
+    for (const auto &file : dir.files) {
+        tree.addFile(file.name);
+    }
+    for (const auto &sub_dir : dir.directories) {
+        tree.openDirectory(sub_dir.name);
+        add_to_tree(sub_dir, tree);
+        tree.closeDirectory();
+    }
+}
+
+} // namespace
+
+fs::path TemplateIndex::indexPath(const std::string &templates_base_dir) { return fs::path(templates_base_dir) / index_file_name; }
+
+std::expected<TemplateIndex, scan_status> TemplateIndex::open(const std::string &template_name, const std::string &templates_base_dir) {
+    ScopedTimer timer(stats_phase::scan);
+
+    fs::path        template_dir_input = fs::path(templates_base_dir) / template_name;
+    std::error_code ec;
+
+    if (!fs::is_directory(template_dir_input, ec) || ec) {
+        if (ec) {
+            fmt::print(stderr, "Error checking if path is a directory {}: {}\n", template_dir_input.string(), ec.message());
+        } else {
+            fmt::print(stderr, "Error: Template directory not found: {}\n", template_dir_input.string());
+        }
+        return std::unexpected(scan_status::error);
+    }
+
+    TemplateIndex index;
+    index.rootPath_ = fs::weakly_canonical(template_dir_input, ec);
+    if (ec) {
+        index.rootPath_ = template_dir_input;
+    }
+
+    const fs::path index_file = indexPath(templates_base_dir);
+    auto           sections   = read_index_file(index_file);
+    auto           section    = sections.find(template_name);
+    if (section != sections.end()) {
+        std::size_t cursor = 0;
+        if (!read_directory(section->second, cursor, index.root_) || cursor != section->second.size()) {
+            index.root_ = IndexedDirectory{}; // Corrupt section, rebuild from scratch
+        }
+    }
+
+    RefreshCounters counters;
+    try {
+        refresh_directory(index.root_, index.rootPath_, fs::weakly_canonical(index_file.parent_path()), counters);
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "Error indexing template {}: {}\n", index.rootPath_.string(), e.what());
+        return std::unexpected(scan_status::error);
+    }
+    index.refreshedDirectories_ = counters.directories;
+    index.refreshedFiles_       = counters.files;
+
+    if (section == sections.end() || counters.directories != 0 || counters.files != 0) {
+        std::vector<std::string> lines;
+        write_directory(index.root_, lines);
+        sections[template_name] = std::move(lines);
+        if (!write_index_file(index_file, sections)) {
+            fmt::print(stderr, "Warning: Could not update template index {}\n", index_file.string());
+        }
+    }
+
+    return index;
+}
+
+std::set<std::shared_ptr<Directory>, CompareDirectoryByName<Directory>> TemplateIndex::directories() const {
+    std::set<std::shared_ptr<Directory>, CompareDirectoryByName<Directory>> top_level_dirs;
+    for (const auto &sub_dir : root_.directories) {
+        top_level_dirs.insert(to_directory(sub_dir, rootPath_ / sub_dir.name));
+    }
+    // Files directly under the template root are grouped into a virtual "." directory
+    if (!root_.files.empty()) {
+        auto dot_dir  = std::make_shared<Directory>();
+        dot_dir->name = ".";
+        dot_dir->path = rootPath_;
+        for (const auto &file : root_.files) {
+            dot_dir->files.insert(file.name);
+        }
+        top_level_dirs.insert(dot_dir);
+    }
+    return top_level_dirs;
+}
+
+DirectoryTree TemplateIndex::tree() const {
+    DirectoryTree tree(rootPath_);
+    tree.openDirectory("");
+    add_to_tree(root_, tree);
+    tree.closeDirectory();
+    return tree;
+}
+
+const IndexedFile *TemplateIndex::findFile(const fs::path &relative) const {
+    const IndexedDirectory *dir = &root_;
+    fs::path                parent = relative.parent_path();
+    for (const auto &component : parent) {
+        dir = find_cached(dir->directories, component.string());
+        if (!dir) {
+            return nullptr;
+        }
+    }
+    return find_cached(dir->files, relative.filename().string());
+}
+
+} // namespace cgen
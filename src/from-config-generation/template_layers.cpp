@@ -0,0 +1,87 @@
+#include "cgen/template_layers.h"
+
+#include "cgen/trace.h"
+
+#include <cassert>
+#include <map>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cgen {
+namespace {
+
+// A directory of one layer: layer index and node index in that layer's tree
+using LayerNode = std::pair<std::uint32_t, std::uint32_t>;
+
+// An entry of a composed directory and the layers it is taken from
+struct ComposedEntry {
+    bool                   is_directory = false;
+    std::uint32_t          file_layer   = 0;
+    std::vector<LayerNode> sources; // For directories, every layer that contains it
+};
+
+void compose_directory(std::span<const DirectoryTree> layers, const std::vector<LayerNode> &sources, DirectoryTree &composed) {
+    // Names point into the layers' name pools, which outlive the composition
+    std::map<std::string_view, ComposedEntry> entries;
+    for (const auto &[layer, index] : sources) {
+        const DirectoryTree &tree = layers[layer];
+        const auto          &node = tree.nodes()[index];
+        for (std::uint32_t f = node.first_file; f < node.first_file + node.file_count; ++f) {
+            entries.try_emplace(tree.name(tree.files()[f]), ComposedEntry{false, layer, {}});
+        }
+        for (std::uint32_t child = index + 1; child < node.subtree_end; child = tree.nodes()[child].subtree_end) {
+            auto [it, inserted] = entries.try_emplace(tree.name(tree.nodes()[child].name), ComposedEntry{true, layer, {}});
+            if (it->second.is_directory) {
+                it->second.sources.emplace_back(layer, child);
+            }
+            // Otherwise a file of a layer with higher precedence shadows this directory
+        }
+    }
+
+    // Every file first, then each subdirectory, both in name order as DirectoryTree requires
+    for (const auto &[name, entry] : entries) {
+        if (!entry.is_directory) {
+            composed.addFile(name, entry.file_layer);
+        }
+    }
+    for (const auto &[name, entry] : entries) {
+        if (!entry.is_directory) {
+            continue;
+        }
+        std::uint32_t mask = 0;
+        for (const auto &source : entry.sources) {
+            mask |= 1U << source.first;
+        }
+        composed.openDirectory(name, mask);
+        compose_directory(layers, entry.sources, composed);
+        composed.closeDirectory();
+    }
+}
+
+} // namespace
+
+DirectoryTree compose_layers(std::span<const DirectoryTree> layers) {
+    assert(!layers.empty() && layers.size() <= DirectoryTree::max_layers);
+    TraceScope trace("compose layers", "scan");
+
+    DirectoryTree composed(layers.front().rootPath());
+    for (std::size_t layer = 1; layer < layers.size(); ++layer) {
+        composed.addLayer(layers[layer].rootPath());
+    }
+
+    std::vector<LayerNode> roots;
+    std::uint32_t          mask = 0;
+    for (std::uint32_t layer = 0; layer < layers.size(); ++layer) {
+        if (!layers[layer].nodes().empty()) {
+            roots.emplace_back(layer, 0);
+            mask |= 1U << layer;
+        }
+    }
+    composed.openDirectory("", mask);
+    compose_directory(layers, roots, composed);
+    composed.closeDirectory();
+    return composed;
+}
+
+} // namespace cgen
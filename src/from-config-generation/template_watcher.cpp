@@ -0,0 +1,279 @@
+#include "cgen/template_watcher.h"
+
+#include <fmt/core.h>
+#include <unordered_set>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <thread>
+#include <unistd.h>
+#endif
+
+namespace cgen {
+namespace {
+
+#if defined(__linux__)
+// Writes, and anything that changes which files and directories the template has
+constexpr std::uint32_t watch_mask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF |
+                                     IN_ONLYDIR;
+
+// Time given to the rest of a burst of events, e.g. an editor writing a backup and then the file
+constexpr auto settle_delay = std::chrono::milliseconds(15);
+
+volatile std::sig_atomic_t watch_stop_requested = 0;
+
+extern "C" void stop_watching(int) { watch_stop_requested = 1; }
+#endif
+
+} // namespace
+
+TemplateWatcher::TemplateWatcher(std::string template_name, std::string templates_base_dir, fs::path output_base_path,
+                                 std::unordered_map<std::string, std::string> values, const PlaceholderProcessor &processor,
+                                 GenerateOptions options)
+    : templateName_(std::move(template_name)), templatesBaseDir_(std::move(templates_base_dir)),
+      outputBasePath_(std::move(output_base_path)), values_(std::move(values)), processor_(processor), options_(options),
+      pool_(options.jobs) {}
+
+TemplateWatcher::~TemplateWatcher() {
+#if defined(__linux__)
+    if (inotify_ >= 0) {
+        ::close(inotify_);
+    }
+#endif
+}
+
+std::expected<void, generate_status> TemplateWatcher::start() {
+    if (options_.incremental) {
+        manifest_ = GenerationManifest::load(outputBasePath_);
+    }
+#if defined(__linux__)
+    inotify_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_ < 0) {
+        fmt::print(stderr, "Error: Could not initialize inotify: {}\n", std::error_code(errno, std::generic_category()).message());
+        return std::unexpected(generate_status::error);
+    }
+#endif
+    auto rebuilt_or = rebuild();
+    if (!rebuilt_or) {
+        return std::unexpected(rebuilt_or.error());
+    }
+#if !defined(__linux__)
+    fmt::print(stderr, "Error: Watching templates needs inotify, which this platform does not provide\n");
+    return std::unexpected(generate_status::error);
+#endif
+    return {};
+}
+
+std::expected<std::size_t, generate_status> TemplateWatcher::rebuild() {
+    auto tree_or = load_template_tree(templateName_, templatesBaseDir_, options_, &pool_);
+    if (!tree_or) {
+        fmt::print(stderr, "Error scanning template directory '{}'.\n", templateName_);
+        return std::unexpected(generate_status::error);
+    }
+    rootPath_ = tree_or->rootPath();
+
+    // Watch before the files are read, so an edit made while preparing is not missed
+    if (!watchDirectories(tree_or.value())) {
+        return std::unexpected(generate_status::error);
+    }
+    // Resident, the files being watched are the ones being edited, and a mapping of one truncated under us would fault
+    auto prepared_or = prepare_template(tree_or.value(), processor_, pool_, options_.io, true);
+    if (!prepared_or) {
+        return std::unexpected(prepared_or.error());
+    }
+    prepared_ = std::move(prepared_or.value());
+
+    fileIndices_.clear();
+    for (std::size_t f = 0; f < prepared_.files.size(); ++f) {
+        fileIndices_.emplace(prepared_.files[f].source.string(), f);
+    }
+
+    auto generated_or = generate_project(prepared_, outputBasePath_, values_, pool_, &manifest_);
+    if (!generated_or) {
+        return std::unexpected(generated_or.error());
+    }
+    saveManifest();
+    return prepared_.files.size();
+}
+
+bool TemplateWatcher::watchDirectories(const DirectoryTree &tree) {
+#if defined(__linux__)
+    for (const auto &[wd, directory] : watches_) {
+        ::inotify_rm_watch(inotify_, wd); // The IN_IGNORED events this queues refer to unknown watches and are skipped
+    }
+    watches_.clear();
+
+    for (std::size_t i = 0; i < tree.nodes().size(); ++i) {
+        fs::path relative = tree.relativePath(i);
+        for (std::size_t layer = 0; layer < tree.layerCount(); ++layer) {
+            if ((tree.nodeLayers(i) & (std::uint32_t{1} << layer)) == 0) {
+                continue; // Overlays only need watching where they contribute
+            }
+            fs::path path = tree.layerRoot(layer) / relative;
+            int      wd   = ::inotify_add_watch(inotify_, path.c_str(), watch_mask);
+            if (wd < 0) {
+                fmt::print(stderr, "Error: Could not watch {}: {}\n", path.string(),
+                           std::error_code(errno, std::generic_category()).message());
+                return false;
+            }
+            watches_[wd] = std::move(path);
+        }
+    }
+#else
+    (void)tree;
+#endif
+    return true;
+}
+
+void TemplateWatcher::saveManifest() const {
+    if (!options_.incremental) {
+        return;
+    }
+    if (auto saved_or = manifest_.save(outputBasePath_); !saved_or) {
+        fmt::print(stderr, "Warning: Could not write {}: {}\n", GenerationManifest::manifestPath(outputBasePath_).string(),
+                   saved_or.error().message());
+    }
+}
+
+std::expected<std::size_t, generate_status> TemplateWatcher::processChanges() {
+#if defined(__linux__)
+    if (inotify_ < 0) {
+        return 0;
+    }
+
+    bool                            structural = false;
+    std::vector<std::size_t>        changed;
+    std::vector<bool>               is_changed(prepared_.files.size(), false);
+    std::unordered_set<std::string> moved; // Entries created, deleted or renamed, checked against the disk below
+    auto                            mark_changed = [&](std::size_t f) {
+        if (!is_changed[f]) {
+            is_changed[f] = true;
+            changed.push_back(f);
+        }
+    };
+
+    alignas(inotify_event) char buffer[16 * 1024];
+    for (;;) {
+        ssize_t length = ::read(inotify_, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break; // EAGAIN: no more pending events
+        }
+        for (char *p = buffer; p < buffer + length;) {
+            const auto *event = reinterpret_cast<const inotify_event *>(p);
+            p += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                structural = true; // Events were lost
+                continue;
+            }
+            auto watch = watches_.find(event->wd);
+            if (watch == watches_.end()) {
+                continue; // A watch removed by the last rebuild
+            }
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED | IN_ISDIR) || event->len == 0) {
+                structural = true;
+                continue;
+            }
+
+            std::string source = (watch->second / event->name).string();
+            if (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)) {
+                moved.insert(std::move(source));
+            } else if (auto file = fileIndices_.find(source); file != fileIndices_.end()) {
+                mark_changed(file->second);
+            }
+        }
+    }
+
+    // Editors often save by writing a temporary file and renaming it over the original, so only
+    // the end state of a batch counts: a file that is still there was replaced, a temporary file
+    // that is gone again did not change the template
+    for (const auto &source : moved) {
+        std::error_code ec;
+        bool            exists = fs::exists(fs::symlink_status(source, ec));
+        auto            file   = fileIndices_.find(source);
+        if (file != fileIndices_.end() && exists) {
+            mark_changed(file->second);
+        } else if (file != fileIndices_.end() || exists) {
+            structural = true;
+        }
+    }
+
+    if (structural) {
+        return rebuild();
+    }
+    if (changed.empty()) {
+        return 0;
+    }
+
+    auto compiled_or = recompile_files(prepared_, changed, processor_, pool_);
+    if (!compiled_or) {
+        return std::unexpected(compiled_or.error());
+    }
+    auto generated_or = regenerate_files(prepared_, changed, outputBasePath_, values_, pool_, &manifest_);
+    if (!generated_or) {
+        return std::unexpected(generated_or.error());
+    }
+    saveManifest();
+    return changed.size();
+#else
+    return 0;
+#endif
+}
+
+std::expected<void, generate_status> TemplateWatcher::run() {
+    auto started_or = start();
+    if (!started_or) {
+        return started_or;
+    }
+#if defined(__linux__)
+    // No SA_RESTART, so a signal interrupts poll() and the loop can exit
+    struct sigaction stop_action {};
+    struct sigaction previous_int {};
+    struct sigaction previous_term {};
+    stop_action.sa_handler = stop_watching;
+    sigemptyset(&stop_action.sa_mask);
+    watch_stop_requested = 0;
+    ::sigaction(SIGINT, &stop_action, &previous_int);
+    ::sigaction(SIGTERM, &stop_action, &previous_term);
+
+    fmt::print("Watching {} for changes, press Ctrl+C to stop\n", rootPath_.string());
+    std::fflush(stdout);
+
+    std::expected<void, generate_status> result;
+    while (!watch_stop_requested) {
+        pollfd fds[1] = {{inotify_, POLLIN, 0}};
+        int    ready  = ::poll(fds, 1, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fmt::print(stderr, "Error: poll failed: {}\n", std::error_code(errno, std::generic_category()).message());
+            result = std::unexpected(generate_status::error);
+            break;
+        }
+        std::this_thread::sleep_for(settle_delay);
+
+        auto start_time = std::chrono::steady_clock::now();
+        auto updated_or = processChanges();
+        if (updated_or && *updated_or > 0) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time);
+            fmt::print("Updated {} file(s) in {:.1f} ms\n", *updated_or, static_cast<double>(elapsed.count()) / 1000.0);
+        }
+        // A failed rebuild was reported, the next change may well fix the template
+        std::fflush(stdout);
+    }
+
+    ::sigaction(SIGINT, &previous_int, nullptr);
+    ::sigaction(SIGTERM, &previous_term, nullptr);
+    return result;
+#else
+    return {};
+#endif
+}
+
+} // namespace cgen
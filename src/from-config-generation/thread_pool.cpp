@@ -0,0 +1,127 @@
+#include "cgen/thread_pool.h"
+
+#include "cgen/trace.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+namespace cgen {
+namespace {
+
+// Identifies the pool and queue of the current worker thread, if any
+thread_local const ThreadPool *current_pool  = nullptr;
+thread_local std::size_t       current_index = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    queues_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    threads_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([this, i] { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto &thread : threads_) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        // Count the task before it becomes visible to other workers, otherwise a thief could finish
+        // it and decrement pending_ before it was incremented, letting wait() return early
+        std::lock_guard lock(mutex_);
+        const std::size_t index = current_pool == this ? current_index : next_++ % queues_.size();
+        ++queued_;
+        ++pending_;
+
+        std::lock_guard queue_lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    wake_.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [this] { return pending_ == 0; });
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+bool ThreadPool::tryPop(std::size_t index, std::function<void()> &task) {
+    {
+        auto            &own = *queues_[index];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (std::size_t offset = 1; offset < queues_.size(); ++offset) {
+        auto            &victim = *queues_[(index + offset) % queues_.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(std::size_t index) {
+    current_pool  = this;
+    current_index = index;
+    if (tracer().enabled()) {
+        tracer().nameThread("worker " + std::to_string(index));
+    }
+
+    while (true) {
+        std::function<void()> task;
+        if (tryPop(index, task)) {
+            {
+                std::lock_guard lock(mutex_);
+                --queued_;
+            }
+            std::exception_ptr error;
+            try {
+                task();
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard lock(mutex_);
+            if (error && !error_) {
+                error_ = error;
+            }
+            if (--pending_ == 0) {
+                idle_.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock lock(mutex_);
+        wake_.wait(lock, [this] { return stop_ || queued_ > 0; });
+        if (stop_ && queued_ == 0) {
+            return;
+        }
+    }
+}
+
+} // namespace cgen
@@ -0,0 +1,125 @@
+#include "cgen/trace.h"
+
+#include <algorithm>
+#include <fmt/core.h>
+#include <fstream>
+#include <iterator>
+
+namespace cgen {
+namespace {
+
+// Quote a string for JSON
+std::string json_string(std::string_view text) {
+    std::string out = "\"";
+    for (char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                out += fmt::format("\\u{:04x}", static_cast<unsigned>(c));
+            } else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+    return out;
+}
+
+// Trace timestamps are in microseconds
+std::string microseconds(std::int64_t nanoseconds) { return fmt::format("{}.{:03}", nanoseconds / 1000, nanoseconds % 1000); }
+
+} // namespace
+
+void Tracer::start() {
+    std::lock_guard lock(registryMutex_);
+    std::move(buffers_.begin(), buffers_.end(), std::back_inserter(retired_));
+    buffers_.clear();
+    epoch_.store(clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    session_.fetch_add(1, std::memory_order_relaxed);
+    enabled_.store(true, std::memory_order_relaxed);
+}
+
+Tracer::ThreadBuffer &Tracer::localBuffer() {
+    // Buffer registered by the calling thread, and the tracing session it belongs to
+    thread_local ThreadBuffer *local_buffer  = nullptr;
+    thread_local std::uint64_t local_session = 0;
+
+    std::uint64_t session = session_.load(std::memory_order_relaxed);
+    if (local_buffer && local_session == session) {
+        return *local_buffer;
+    }
+
+    std::lock_guard lock(registryMutex_);
+    auto            buffer = std::make_unique<ThreadBuffer>();
+    buffer->tid            = static_cast<std::uint32_t>(buffers_.size() + 1);
+    buffer->name           = fmt::format("thread {}", buffer->tid);
+    buffer->events.reserve(1024);
+    local_buffer  = buffer.get();
+    local_session = session;
+    buffers_.push_back(std::move(buffer));
+    return *buffers_.back();
+}
+
+void Tracer::record(std::string_view name, std::string_view category, clock::time_point begin, clock::time_point end, std::string detail) {
+    auto             &buffer = localBuffer();
+    clock::time_point epoch{clock::duration(epoch_.load(std::memory_order_relaxed))};
+    begin = std::max(begin, epoch); // A span that was already open when tracing started
+    end   = std::max(end, begin);
+    buffer.events.push_back({name, category, std::chrono::duration_cast<std::chrono::nanoseconds>(begin - epoch).count(),
+                             std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count(), std::move(detail)});
+}
+
+void Tracer::nameThread(std::string name) { localBuffer().name = std::move(name); }
+
+std::size_t Tracer::eventCount() const {
+    std::lock_guard lock(registryMutex_);
+    std::size_t     count = 0;
+    for (const auto &buffer : buffers_) {
+        count += buffer->events.size();
+    }
+    return count;
+}
+
+std::expected<void, std::error_code> Tracer::write(const fs::path &path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return std::unexpected(std::make_error_code(std::errc::io_error));
+    }
+
+    std::lock_guard lock(registryMutex_);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    for (const auto &buffer : buffers_) {
+        out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->tid
+            << ", \"args\": {\"name\": " << json_string(buffer->name) << "}}";
+        first = false;
+        for (const auto &event : buffer->events) {
+            out << ",\n{\"name\": " << json_string(event.name) << ", \"cat\": " << json_string(event.category)
+                << ", \"ph\": \"X\", \"ts\": " << microseconds(event.begin_ns) << ", \"dur\": " << microseconds(event.duration_ns)
+                << ", \"pid\": 1, \"tid\": " << buffer->tid;
+            if (!event.detail.empty()) {
+                out << ", \"args\": {\"file\": " << json_string(event.detail) << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+
+    out.close();
+    if (!out) {
+        return std::unexpected(std::make_error_code(std::errc::io_error));
+    }
+    return {};
+}
+
+Tracer &tracer() {
+    static Tracer instance;
+    return instance;
+}
+
+} // namespace cgen
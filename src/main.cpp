@@ -1,29 +1,121 @@
 #include "cgen/scanner.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cgen/batch.h>
+#include <cgen/generator.h>
 #include <cgen/placeholder_processor.h>
+#include <cgen/server.h>
+#include <cgen/stats.h>
+#include <cgen/trace.h>
+#include <cgen/template_layers.h>
+#include <cgen/template_watcher.h>
 #include <cxxopts.hpp>
 #include <expected>
 #include <filesystem>
 #include <fmt/core.h>
-#include <fstream>    // Added for file operations
-#include <functional> // Added for std::function
-#include <sstream>    // Added for std::stringstream
+#include <optional>
+#include <set>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace fs = std::filesystem;
 using namespace cgen;
 
+namespace {
+
+// Prints the statistics of the run once it goes out of scope, so every exit path of a command reports them
+class StatsReport {
+  public:
+    explicit StatsReport(std::optional<stats_format> format) : format_(format), start_(std::chrono::steady_clock::now()) {
+        statistics().enable(format_.has_value());
+    }
+    ~StatsReport() {
+        if (format_) {
+            fmt::print(stderr, "{}", format_stats(statistics(), std::chrono::steady_clock::now() - start_, *format_));
+        }
+    }
+    StatsReport(const StatsReport &)            = delete;
+    StatsReport &operator=(const StatsReport &) = delete;
+
+  private:
+    std::optional<stats_format>           format_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Records a trace of the run and writes it once it goes out of scope, after every worker pool has finished
+class TraceReport {
+  public:
+    explicit TraceReport(std::optional<fs::path> path) : path_(std::move(path)) {
+        if (path_) {
+            tracer().start();
+            tracer().nameThread("main");
+        }
+    }
+    ~TraceReport() {
+        if (!path_) {
+            return;
+        }
+        tracer().stop();
+        if (auto written_or = tracer().write(*path_); !written_or) {
+            fmt::print(stderr, "Error: Could not write trace {}: {}\n", path_->string(), written_or.error().message());
+        } else {
+            fmt::print(stderr, "Trace with {} events written to {}\n", tracer().eventCount(), path_->string());
+        }
+    }
+    TraceReport(const TraceReport &)            = delete;
+    TraceReport &operator=(const TraceReport &) = delete;
+
+  private:
+    std::optional<fs::path> path_;
+};
+
+// Values for trying a template out with --generate alone, a configuration passed with -i supplies real ones
+std::unordered_map<std::string, std::string> default_values() {
+    return {{"PROJECT_NAME", "MyGeneratedProject"}, {"AUTHOR_NAME", "CGen User"}, {"APP_NAME", "DefaultApp"}};
+}
+
+} // namespace
+
 int main(int argc, char *argv[]) {
     try {
         // Parse the command line arguments
         cxxopts::Options options("cgen", "C++ Project Generator");
         options.add_options()("h,help", "Print help")("l,list", "List available templates", cxxopts::value<bool>()->default_value("false"))(
             "g,generate", "Generate project from template", cxxopts::value<std::string>()) // Added --generate
+            ("i,input", "Generate the project described by a TOML configuration file (repeatable)",
+             cxxopts::value<std::vector<std::string>>())
             ("o,output", "Output directory", cxxopts::value<std::string>()->default_value("."))(
                 "gui", "Run the terminal user interface",
-                cxxopts::value<bool>()->default_value("false"))("templates", "Custom templates directory", cxxopts::value<std::string>());
+                cxxopts::value<bool>()->default_value("false"))("templates", "Custom templates directory", cxxopts::value<std::string>())(
+                "j,jobs", "Worker threads used for generation (0 = hardware concurrency)",
+                cxxopts::value<std::size_t>()->default_value("0"))("b,batch", "Generate every project listed in a TOML batch manifest",
+                                                                   cxxopts::value<std::string>())(
+                "index", "Cache the scanned template tree in <templates>/.cgen-index", cxxopts::value<bool>()->default_value("false"))(
+                "overlay", "Compose the template with this template directory, whose files the template's own override (repeatable)",
+                cxxopts::value<std::vector<std::string>>())(
+                "package-manager", "Add the dependency setup of a package manager: 'cpm', 'vcpkg' or 'xrepo'",
+                cxxopts::value<std::string>())(
+                "no-common", "Do not compose the template with the shared files in <templates>/_common",
+                cxxopts::value<bool>()->default_value("false"))(
+                "incremental", "Only rewrite outputs whose template or values changed, tracked in <output>/.cgen-manifest",
+                cxxopts::value<bool>()->default_value("false"))(
+                "io", "How files are read and written: 'blocking', or 'io_uring' to batch them (falls back to blocking where unavailable)",
+                cxxopts::value<std::string>()->default_value("blocking"))(
+                "staging", "Build the project in a staging directory next to the output and move it into place with one rename",
+                cxxopts::value<bool>()->default_value("false"))(
+                "watch", "After generating, watch the template and re-render the files that change until interrupted",
+                cxxopts::value<bool>()->default_value("false"))(
+                "trace", "Write a Chrome/Perfetto trace of every phase and file to this JSON file", cxxopts::value<std::string>())(
+                "stats", "Print where the time went to stderr when done, as a table or with --stats=json as JSON",
+                cxxopts::value<std::string>()->implicit_value("text"))(
+                "socket", "Socket of 'cgen serve'; with --generate the project is generated by that server",
+                cxxopts::value<std::string>())("command", "'serve' runs a generator daemon with warm template caches",
+                                               cxxopts::value<std::string>());
+        options.parse_positional({"command"});
+        options.positional_help("[serve]");
 
         auto result = options.parse(argc, argv);
 
@@ -31,6 +123,71 @@ int main(int argc, char *argv[]) {
             fmt::print("{}\n", options.help());
             return 0;
         }
+
+        if (result["staging"].as<bool>() && (result["incremental"].as<bool>() || result["watch"].as<bool>())) {
+            fmt::print(stderr, "Error: --staging replaces the whole output and cannot be combined with --incremental or --watch.\n");
+            return 1;
+        }
+
+        std::string io_name = result["io"].as<std::string>();
+        if (io_name != "blocking" && io_name != "io_uring") {
+            fmt::print(stderr, "Error: Unknown I/O backend '{}', expected 'blocking' or 'io_uring'.\n", io_name);
+            return 1;
+        }
+        io_backend io = io_name == "io_uring" ? io_backend::io_uring : io_backend::blocking;
+
+        // Overlays in precedence order: explicit ones first, then the package manager, _common is added last
+        std::vector<std::string> overlays;
+        if (result.count("overlay")) {
+            overlays = result["overlay"].as<std::vector<std::string>>();
+        }
+        if (result.count("package-manager")) {
+            std::string package_manager = result["package-manager"].as<std::string>();
+            if (package_manager != "cpm" && package_manager != "vcpkg" && package_manager != "xrepo") {
+                fmt::print(stderr, "Error: Unknown package manager '{}', expected 'cpm', 'vcpkg' or 'xrepo'.\n", package_manager);
+                return 1;
+            }
+            overlays.push_back(fmt::format("{}/{}", package_managers_dir, package_manager));
+        }
+        bool common_layer = !result["no-common"].as<bool>();
+
+        std::optional<stats_format> stats_output;
+        if (result.count("stats")) {
+            std::string format = result["stats"].as<std::string>();
+            if (format != "text" && format != "json") {
+                fmt::print(stderr, "Error: Unknown statistics format '{}', expected 'text' or 'json'.\n", format);
+                return 1;
+            }
+            stats_output = format == "json" ? stats_format::json : stats_format::text;
+        }
+        StatsReport stats_report(stats_output);
+        TraceReport trace_report(result.count("trace") ? std::optional<fs::path>(result["trace"].as<std::string>()) : std::nullopt);
+
+        if (result.count("command")) {
+            if (result["command"].as<std::string>() != "serve") {
+                fmt::print(stderr, "Error: Unknown command '{}'. Use --help for options.\n", result["command"].as<std::string>());
+                return 1;
+            }
+#if defined(__unix__) || defined(__APPLE__)
+            ServeOptions serve_options;
+            serve_options.socket_path = result.count("socket") ? fs::path(result["socket"].as<std::string>()) : default_socket_path();
+            if (result.count("templates")) {
+                serve_options.templates_base_dir = result["templates"].as<std::string>();
+            }
+            serve_options.generate.jobs         = result["jobs"].as<std::size_t>();
+            serve_options.generate.use_index    = result["index"].as<bool>();
+            serve_options.generate.io           = io;
+            serve_options.generate.overlays     = overlays;
+            serve_options.generate.common_layer = common_layer;
+
+            PlaceholderProcessor processor; // Uses default style: @PLACEHOLDER@
+            auto                 served_or = serve(serve_options, processor);
+            return served_or ? 0 : static_cast<int>(served_or.error());
+#else
+            fmt::print(stderr, "Error: 'serve' needs Unix domain sockets, which this platform does not provide\n");
+            return 1;
+#endif
+        }
         if (result["list"].as<bool>()) {
             auto result_or = list_templates(result);
 
@@ -50,6 +207,115 @@ int main(int argc, char *argv[]) {
             throw std::runtime_error("Not implemented yet for gui"); // Updated message
         }
 
+#if defined(__unix__) || defined(__APPLE__)
+        // Hand the request to a running `cgen serve`, which already has the template in memory
+        if (result.count("socket") && (result.count("generate") || result.count("input"))) {
+            // The server composes, scans and caches templates with the settings it was started with
+            for (const char *server_option : {"batch", "templates", "jobs", "index", "overlay", "package-manager", "no-common", "watch"}) {
+                if (result.count(server_option)) {
+                    fmt::print(stderr, "Error: --{} cannot be combined with --socket, pass it to 'cgen serve' instead.\n", server_option);
+                    return 1;
+                }
+            }
+
+            ServerRequest request;
+            request.output_dir = fs::absolute(result["output"].as<std::string>());
+            if (result.count("input")) {
+                auto configs = result["input"].as<std::vector<std::string>>();
+                if (configs.size() > 1) {
+                    fmt::print(stderr, "Error: The cgen server generates one project per request, got {} configurations.\n", configs.size());
+                    return 1;
+                }
+                auto project_or = load_project_config(configs.front(), request.output_dir);
+                if (!project_or) {
+                    return static_cast<int>(project_or.error());
+                }
+                if (!project_or->overlays.empty()) {
+                    fmt::print(stderr, "Error: {} selects a package manager layer, which the cgen server cannot add to its templates.\n",
+                               configs.front());
+                    return 1;
+                }
+                request.template_name = std::move(project_or->template_name);
+                request.values        = std::move(project_or->values);
+            } else {
+                request.values = default_values();
+            }
+            if (result.count("generate")) {
+                request.template_name = result["generate"].as<std::string>();
+            }
+            request.incremental = result["incremental"].as<bool>();
+            request.staging     = result["staging"].as<bool>();
+            if (result.count("io")) {
+                request.io = io;
+            }
+
+            auto sent_or = send_request(result["socket"].as<std::string>(), request);
+            if (!sent_or) {
+                return static_cast<int>(sent_or.error());
+            }
+            fmt::print("Project generation complete for template '{}' in '{}'.\n", request.template_name, request.output_dir.string());
+            return 0;
+        }
+#endif
+        if (result.count("batch") || result.count("input")) {
+            fs::path templates_base_dir = result.count("templates") ? result["templates"].as<std::string>() : "templates/";
+
+            BatchManifest manifest;
+            if (result.count("batch")) {
+                auto manifest_or = load_batch_manifest(result["batch"].as<std::string>());
+                if (!manifest_or) {
+                    return static_cast<int>(manifest_or.error());
+                }
+                manifest = std::move(manifest_or.value());
+            }
+
+            // Configurations join the batch, so every template is prepared once however many projects use it
+            auto     configs = result.count("input") ? result["input"].as<std::vector<std::string>>() : std::vector<std::string>();
+            fs::path output  = result["output"].as<std::string>();
+
+            std::set<std::string> project_names; // Subdirectories of the output already claimed
+            for (const auto &config : configs) {
+                auto project_or = load_project_config(config, output);
+                if (!project_or) {
+                    return static_cast<int>(project_or.error());
+                }
+                if (configs.size() > 1) {
+                    // One subdirectory per project, named after it
+                    auto        name_it = project_or->values.find("PROJECT_NAME");
+                    std::string name    = name_it != project_or->values.end() ? name_it->second : std::string();
+                    if (!is_single_path_component(name)) {
+                        fmt::print(stderr, "Error: Project name '{}' of {} cannot be used as a directory name below {}\n", name, config,
+                                   output.string());
+                        return 1;
+                    }
+                    if (!project_names.insert(name).second) {
+                        fmt::print(stderr, "Error: Project name '{}' of {} is also used by another configuration, both would go to {}\n",
+                                   name, config, (output / name).string());
+                        return 1;
+                    }
+                    project_or->output_dir = output / name;
+                }
+                // Only the template is replaced, the package manager overlays the configuration selects still apply
+                if (result.count("generate")) {
+                    project_or->template_name = result["generate"].as<std::string>();
+                }
+                manifest.projects.push_back(std::move(project_or.value()));
+            }
+
+            PlaceholderProcessor processor; // Uses default style: @PLACEHOLDER@
+            GenerateOptions      generate_options;
+            generate_options.jobs         = result["jobs"].as<std::size_t>();
+            generate_options.use_index    = result["index"].as<bool>();
+            generate_options.incremental  = result["incremental"].as<bool>();
+            generate_options.staging      = result["staging"].as<bool>();
+            generate_options.io           = io;
+            generate_options.overlays     = overlays;
+            generate_options.common_layer = common_layer;
+
+            auto generated_or = generate_batch(manifest, templates_base_dir, processor, generate_options);
+            return generated_or ? 0 : static_cast<int>(generated_or.error());
+        }
+
         if (result.count("generate")) {
             std::string template_name = result["generate"].as<std::string>();
             fs::path    output_dir    = result["output"].as<std::string>();
@@ -61,6 +327,8 @@ int main(int argc, char *argv[]) {
                 templates_base_dir_str = "templates/";
             }
 
+            std::unordered_map<std::string, std::string> placeholder_values = default_values();
+
             fmt::print("Generating project from template '{}' into directory '{}' using base '{}'\n", template_name, output_dir.string(),
                        templates_base_dir_str);
 
@@ -80,96 +348,46 @@ int main(int argc, char *argv[]) {
             }
 
             // 2. Scan the template directory
-            auto scanned_template_or = scan_template_directory(template_name, templates_base_dir_str);
+            PlaceholderProcessor processor; // Uses default style: @PLACEHOLDER@
+            GenerateOptions      generate_options;
+            generate_options.jobs         = result["jobs"].as<std::size_t>();
+            generate_options.use_index    = result["index"].as<bool>();
+            generate_options.incremental  = result["incremental"].as<bool>();
+            generate_options.staging      = result["staging"].as<bool>();
+            generate_options.io           = io;
+            generate_options.overlays     = overlays;
+            generate_options.common_layer = common_layer;
+
+            // Generate once, then keep the output in sync while the template is edited
+            if (result["watch"].as<bool>()) {
+                auto output_base_path_or = ensure_output_directory(output_dir);
+                if (!output_base_path_or) {
+                    return static_cast<int>(output_base_path_or.error());
+                }
+                TemplateWatcher watcher(template_name, templates_base_dir_str, output_base_path_or.value(), placeholder_values, processor,
+                                        generate_options);
+                auto            watched_or = watcher.run();
+                return watched_or ? 0 : static_cast<int>(watched_or.error());
+            }
+
+            auto scanned_template_or = load_template_tree(template_name, templates_base_dir_str, generate_options);
             if (!scanned_template_or) {
                 fmt::print(stderr, "Error scanning template directory '{}'.\n", template_name);
                 return static_cast<int>(scanned_template_or.error());
             }
-            const auto &top_level_entries = scanned_template_or.value();
+            const auto &template_tree = scanned_template_or.value();
 
-            // 3. Prepare for placeholder processing
-            PlaceholderProcessor processor; // Uses default style: @PLACEHOLDER@
-            // TODO: Dynamically collect placeholder values (e.g., from user input or a config file)
-            std::unordered_map<std::string, std::string> placeholder_values = {{"PROJECT_NAME", "MyGeneratedProject"},
-                                                                               {"AUTHOR_NAME", "CGen User"},
-                                                                               {"APP_NAME", "DefaultApp"}};
-
-            fs::path output_base_path = fs::absolute(output_dir);
-            if (!fs::exists(output_base_path)) {
-                if (!fs::create_directories(output_base_path)) {
-                    fmt::print(stderr, "Error: Could not create output directory: {}\n", output_base_path.string());
-                    return 1;
-                }
-            } else if (!fs::is_directory(output_base_path)) {
-                fmt::print(stderr, "Error: Output path exists but is not a directory: {}\n", output_base_path.string());
-                return 1;
+            // 3. Prepare the output directory
+            auto output_base_path_or = ensure_output_directory(output_dir);
+            if (!output_base_path_or) {
+                return static_cast<int>(output_base_path_or.error());
             }
+            const fs::path &output_base_path = output_base_path_or.value();
 
-            // 4. Recursive function to process directory entries
-            std::function<void(const std::shared_ptr<Directory> &, const fs::path &)> process_entry_recursively;
-            process_entry_recursively = [&](const std::shared_ptr<Directory> &dir_entry, const fs::path &current_output_dir_path) {
-                fs::path next_output_target_path;
-                // The virtual "." directory means files/dirs are at the current level
-                if (dir_entry->name == ".") {
-                    next_output_target_path = current_output_dir_path;
-                } else {
-                    next_output_target_path = current_output_dir_path / dir_entry->name;
-                    if (!fs::exists(next_output_target_path)) {
-                        if (!fs::create_directories(next_output_target_path)) {
-                            fmt::print(stderr, "Error: Could not create directory: {}\n", next_output_target_path.string());
-                            // Potentially throw or return an error code here to stop generation
-                            return;
-                        }
-                        fmt::print("Created directory: {}\n", next_output_target_path.string());
-                    }
-                }
-
-                // Process files in the current directory entry
-                for (const auto &file_name : dir_entry->files) {
-                    // dir_entry->path is the canonical path to the source directory of this entry
-                    fs::path source_file_path = dir_entry->path / file_name;
-                    fs::path dest_file_path   = next_output_target_path / file_name;
-
-                    // TODO: Implement filename templating if needed (e.g., @PROJECT_NAME@.cpp)
-
-                    try {
-                        std::ifstream tpl_file_stream(source_file_path);
-                        if (!tpl_file_stream) {
-                            fmt::print(stderr, "Warning: Could not open template file for reading: {}\n", source_file_path.string());
-                            continue;
-                        }
-                        std::stringstream buffer;
-                        buffer << tpl_file_stream.rdbuf();
-                        tpl_file_stream.close();
-                        std::string content = buffer.str();
-
-                        std::string processed_content = processor.replacePlaceholders(content, placeholder_values);
-
-                        std::ofstream out_file_stream(dest_file_path);
-                        if (!out_file_stream) {
-                            fmt::print(stderr, "Error: Could not open output file for writing: {}\n", dest_file_path.string());
-                            continue;
-                        }
-                        out_file_stream << processed_content;
-                        out_file_stream.close();
-                        fmt::print("Generated file: {}\n", dest_file_path.string());
-
-                    } catch (const std::exception &e) {
-                        fmt::print(stderr, "Error processing file {} to {}: {}\n", source_file_path.string(), dest_file_path.string(),
-                                   e.what());
-                    }
-                }
-
-                // Recursively process subdirectories
-                for (const auto &sub_dir_entry : dir_entry->directories) {
-                    // Pass the path where this subdirectory's contents should go
-                    process_entry_recursively(sub_dir_entry, next_output_target_path);
-                }
-            };
-
-            // 5. Start processing from top-level entries
-            for (const auto &top_level_dir_entry : top_level_entries) {
-                process_entry_recursively(top_level_dir_entry, output_base_path);
+            // 4. Render every file, fanning out across the worker pool
+            auto generated_or = generate_project(template_tree, output_base_path, processor, placeholder_values, generate_options);
+            if (!generated_or) {
+                return static_cast<int>(generated_or.error());
             }
 
             fmt::print("Project generation complete for template '{}' in '{}'.\n", template_name, output_base_path.string());
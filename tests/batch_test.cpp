@@ -0,0 +1,218 @@
+#include "cgen/batch.h"
+
+#include <doctest/doctest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace cgen;
+
+namespace {
+
+fs::path make_temp_dir(const std::string &name) {
+    fs::path path = fs::temp_directory_path() / name;
+    fs::remove_all(path);
+    fs::create_directories(path);
+    return path;
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+std::string read_file(const fs::path &path) {
+    std::ifstream     in(path);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+} // namespace
+
+TEST_CASE("load_batch_manifest: projects, shared values and relative paths") {
+    fs::path base = make_temp_dir("cgen_batch_manifest_test");
+    write_file(base / "batch.toml", R"(
+templates = "my_templates"
+
+[values]
+AUTHOR_NAME = "Platform Team"
+CPP_STANDARD = 23
+
+[[project]]
+template = "lib"
+output = "out/alpha"
+[project.values]
+PROJECT_NAME = "alpha"
+DEPENDENCIES = ["fmt", "spdlog"]
+
+[[project]]
+template = "lib"
+output = "out/beta"
+[project.values]
+PROJECT_NAME = "beta"
+AUTHOR_NAME = "Someone Else"
+)");
+
+    auto manifest = load_batch_manifest(base / "batch.toml");
+    REQUIRE(manifest.has_value());
+    CHECK(manifest->templates_dir == base / "my_templates");
+    REQUIRE(manifest->projects.size() == 2);
+
+    const auto &alpha = manifest->projects[0];
+    CHECK(alpha.template_name == "lib");
+    CHECK(alpha.output_dir == base / "out/alpha");
+    CHECK(alpha.values.at("PROJECT_NAME") == "alpha");
+    CHECK(alpha.values.at("AUTHOR_NAME") == "Platform Team");
+    CHECK(alpha.values.at("CPP_STANDARD") == "23");
+    CHECK(alpha.values.at("DEPENDENCIES") == "fmt;spdlog");
+
+    CHECK(manifest->projects[1].values.at("AUTHOR_NAME") == "Someone Else");
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("load_batch_manifest: invalid manifests") {
+    fs::path base = make_temp_dir("cgen_batch_invalid_test");
+
+    write_file(base / "missing_output.toml", "[[project]]\ntemplate = \"lib\"\n");
+    CHECK_FALSE(load_batch_manifest(base / "missing_output.toml").has_value());
+
+    write_file(base / "no_projects.toml", "templates = \"t\"\n");
+    CHECK_FALSE(load_batch_manifest(base / "no_projects.toml").has_value());
+
+    CHECK_FALSE(load_batch_manifest(base / "does_not_exist.toml").has_value());
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("generate_batch: many projects from one template") {
+    fs::path base = make_temp_dir("cgen_batch_generate_test");
+    write_file(base / "templates" / "lib" / "CMakeLists.txt", "project(@PROJECT_NAME@)\n");
+    write_file(base / "templates" / "lib" / "src" / "lib.cpp", "// @PROJECT_NAME@ by @AUTHOR_NAME@\n");
+
+    BatchManifest manifest;
+    for (const char *name : {"alpha", "beta", "gamma"}) {
+        manifest.projects.push_back({"lib", base / "out" / name, {{"PROJECT_NAME", name}, {"AUTHOR_NAME", "me"}}});
+    }
+
+    PlaceholderProcessor processor;
+    REQUIRE(generate_batch(manifest, base / "templates", processor).has_value());
+
+    CHECK(read_file(base / "out" / "alpha" / "CMakeLists.txt") == "project(alpha)\n");
+    CHECK(read_file(base / "out" / "beta" / "src" / "lib.cpp") == "// beta by me\n");
+    CHECK(read_file(base / "out" / "gamma" / "CMakeLists.txt") == "project(gamma)\n");
+
+    // An unknown template fails the batch without stopping the other projects
+    manifest.projects.insert(manifest.projects.begin(), {"missing", base / "out" / "delta", {}});
+    CHECK_FALSE(generate_batch(manifest, base / "templates", processor).has_value());
+    CHECK(read_file(base / "out" / "alpha" / "CMakeLists.txt") == "project(alpha)\n");
+
+    // Projects sharing an output directory, however it is spelled, fail the batch before anything is written
+    BatchManifest clashing;
+    clashing.projects.push_back({"lib", base / "clash" / "one", {{"PROJECT_NAME", "one"}}});
+    clashing.projects.push_back({"lib", base / "clash" / "two", {{"PROJECT_NAME", "two"}}});
+    clashing.projects.push_back({"lib", base / "clash" / "." / "two", {{"PROJECT_NAME", "three"}}});
+    CHECK_FALSE(generate_batch(clashing, base / "templates", processor).has_value());
+    CHECK_FALSE(fs::exists(base / "clash"));
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("load_project_config: documented keys become placeholder values") {
+    fs::path base = make_temp_dir("cgen_project_config_test");
+    write_file(base / "project.toml", R"(
+[project]
+name = "my_project"
+version = "1.4"
+description = "A simple project"
+vendor = "Your Organization"
+
+[project.type]
+type = "library"
+
+[dependencies]
+spdlog = { version = "1.11.0", required = false }
+fmt = { version = "9.1.0", required = true }
+doctest = "2.4"
+
+[package_managers]
+cpm = true
+vcpkg = true
+conan = false
+
+[build]
+cpp_standard = 20
+enable_testing = true
+
+[build.cmake_options]
+BUILD_SHARED_LIBS = true
+
+[build.cmake_defines]
+VERSION_INFO = "\"${PROJECT_VERSION}\""
+DEBUG_MODE = ""
+
+[values]
+PROJECT_CONTACT = "team@example.com"
+)");
+
+    auto project = load_project_config(base / "project.toml", base / "out");
+    REQUIRE(project.has_value());
+    CHECK(project->template_name == "library_default");
+    CHECK(project->output_dir == base / "out");
+    CHECK(project->overlays == std::vector<std::string>{"_package_managers/cpm", "_package_managers/vcpkg"});
+
+    const auto &values = project->values;
+    CHECK(values.at("PROJECT_NAME") == "my_project");
+    CHECK(values.at("PROJECT_NAMESPACE") == "my_project");
+    CHECK(values.at("PROJECT_VERSION") == "1.4");
+    CHECK(values.at("PROJECT_VERSION_MINOR") == "4");
+    CHECK(values.at("PROJECT_VERSION_PATCH") == "0");
+    CHECK(values.at("PROJECT_CONTACT") == "team@example.com");
+    CHECK(values.at("PROJECT_KIND") == "shared");
+    CHECK(values.at("CPP_STANDARD") == "20");
+    CHECK(values.at("ENABLE_TESTING") == "ON");
+    CHECK(values.at("USE_MODULES") == "OFF");
+    CHECK(values.at("DEPENDENCIES") == "doctest;fmt;spdlog");
+    CHECK(values.at("REQUIRED_DEPENDENCIES") == "doctest;fmt");
+    CHECK(values.at("FIND_DEPENDENCIES") == "find_dependency(doctest 2.4)\nfind_dependency(fmt 9.1.0)");
+    CHECK(values.at("PACKAGE_MANAGERS") == "cpm;vcpkg");
+    CHECK(values.at("USE_CPM") == "include(${CMAKE_CURRENT_SOURCE_DIR}/get_cpm.cmake)");
+    CHECK(values.at("USE_CONAN").empty());
+    CHECK(values.at("CMAKE_OPTIONS") == "set(BUILD_SHARED_LIBS ON)");
+    CHECK(values.at("CMAKE_DEFINES") == "target_compile_definitions(${PROJECT_NAME} PRIVATE DEBUG_MODE)\n"
+                                        "target_compile_definitions(${PROJECT_NAME} PRIVATE VERSION_INFO=\"${PROJECT_VERSION}\")");
+
+    write_file(base / "nameless.toml", "[project]\nversion = \"1.0\"\n");
+    CHECK_FALSE(load_project_config(base / "nameless.toml", base / "out").has_value());
+    write_file(base / "unknown_type.toml", "[project]\nname = \"x\"\n[project.type]\ntype = \"plugin\"\n");
+    CHECK_FALSE(load_project_config(base / "unknown_type.toml", base / "out").has_value());
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("generate_batch: projects from configurations share their template") {
+    fs::path base = make_temp_dir("cgen_project_config_batch_test");
+    write_file(base / "templates" / "binary_default" / "CMakeLists.txt", "project(@PROJECT_NAME@ VERSION @PROJECT_VERSION@)\n"
+                                                                         "@each DEP in DEPENDENCIES@\n"
+                                                                         "find_package(@DEP@)\n"
+                                                                         "@endeach@\n");
+    write_file(base / "alpha.toml", "[project]\nname = \"alpha\"\n[dependencies]\nfmt = \"9.1.0\"\nspdlog = \"1.11.0\"\n");
+    write_file(base / "beta.toml", "[project]\nname = \"beta\"\nversion = \"2.0.0\"\n");
+
+    BatchManifest manifest;
+    for (const char *name : {"alpha", "beta"}) {
+        auto project = load_project_config(base / (std::string(name) + ".toml"), base / "out" / name);
+        REQUIRE(project.has_value());
+        manifest.projects.push_back(std::move(project.value()));
+    }
+
+    PlaceholderProcessor processor;
+    REQUIRE(generate_batch(manifest, base / "templates", processor).has_value());
+    CHECK(read_file(base / "out" / "alpha" / "CMakeLists.txt") ==
+          "project(alpha VERSION 0.1.0)\nfind_package(fmt)\nfind_package(spdlog)\n");
+    CHECK(read_file(base / "out" / "beta" / "CMakeLists.txt") == "project(beta VERSION 2.0.0)\n");
+
+    fs::remove_all(base);
+}
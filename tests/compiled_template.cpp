@@ -0,0 +1,169 @@
+#include "cgen/compiled_template.h"
+#include "cgen/placeholder_processor.h"
+
+#include <array>
+#include <doctest/doctest.h>
+#include <string>
+#include <unordered_map>
+
+using namespace cgen;
+
+TEST_CASE("CompiledTemplate: segments and slots") {
+    PlaceholderProcessor processor;
+
+    auto compiled = processor.compile("a @FOO@ b @BAR@ c @FOO@");
+    REQUIRE(compiled.slots().size() == 2);
+    CHECK(compiled.slots()[0] == "FOO");
+    CHECK(compiled.slots()[1] == "BAR");
+
+    const auto &segments = compiled.segments();
+    REQUIRE(segments.size() == 6);
+    CHECK(segments[0].slot == CompiledTemplate::literal);
+    CHECK(compiled.source().substr(segments[0].offset, segments[0].length) == "a ");
+    CHECK(segments[1].slot == 0);
+    CHECK(compiled.source().substr(segments[1].offset, segments[1].length) == "@FOO@");
+    CHECK(segments[3].slot == 1);
+    CHECK(segments[5].slot == 0);
+    CHECK(compiled.hasPlaceholders());
+}
+
+TEST_CASE("CompiledTemplate: render many times") {
+    PlaceholderProcessor processor;
+
+    auto compiled = processor.compile("project(@PROJECT_NAME@ VERSION @PROJECT_VERSION@) # @PROJECT_NAME@");
+    CHECK(compiled.render({{"PROJECT_NAME", "alpha"}, {"PROJECT_VERSION", "1.0"}}) == "project(alpha VERSION 1.0) # alpha");
+    CHECK(compiled.render({{"PROJECT_NAME", "beta"}, {"PROJECT_VERSION", "2.0"}}) == "project(beta VERSION 2.0) # beta");
+
+    // Unbound placeholders are kept verbatim
+    CHECK(compiled.render({{"PROJECT_NAME", "gamma"}}) == "project(gamma VERSION @PROJECT_VERSION@) # gamma");
+
+    // Values are never rescanned for placeholders
+    CHECK(compiled.render({{"PROJECT_NAME", "@PROJECT_VERSION@"}, {"PROJECT_VERSION", "3.0"}}) ==
+          "project(@PROJECT_VERSION@ VERSION 3.0) # @PROJECT_VERSION@");
+}
+
+TEST_CASE("CompiledTemplate: no placeholders") {
+    PlaceholderProcessor processor;
+
+    auto compiled = processor.compile("plain text, @lowercase@ is not a placeholder");
+    CHECK_FALSE(compiled.hasPlaceholders());
+    CHECK(compiled.render({{"lowercase", "x"}}) == "plain text, @lowercase@ is not a placeholder");
+
+    auto empty = processor.compile("");
+    CHECK(empty.segments().empty());
+    CHECK(empty.render({}).empty());
+}
+
+TEST_CASE("CompiledTemplate: multiple styles") {
+    PlaceholderProcessor processor({PlaceholderStyle::AtSign, PlaceholderStyle::Percent});
+
+    auto compiled = processor.compile("@FOO@/%BAR%/#BAZ#");
+    REQUIRE(compiled.slots().size() == 2);
+    CHECK(compiled.render({{"FOO", "1"}, {"BAR", "2"}, {"BAZ", "3"}}) == "1/2/#BAZ#");
+}
+
+TEST_CASE("CompiledTemplate: if blocks") {
+    PlaceholderProcessor processor;
+
+    auto compiled = processor.compile("cmake_minimum_required(VERSION 3.28)\n"
+                                      "@if USE_VCPKG@\n"
+                                      "include(vcpkg.cmake)\n"
+                                      "@else@\n"
+                                      "  @if !USE_CPM@\n"
+                                      "find_package(fmt)\n"
+                                      "  @endif@\n"
+                                      "@endif@\n"
+                                      "project(@PROJECT_NAME@)@if SUFFIX@_@SUFFIX@@endif@\n");
+    CHECK(compiled.hasDirectives());
+    CHECK_FALSE(compiled.rendersVerbatim({}));
+
+    CHECK(compiled.render({{"USE_VCPKG", "ON"}, {"PROJECT_NAME", "demo"}}) ==
+          "cmake_minimum_required(VERSION 3.28)\ninclude(vcpkg.cmake)\nproject(demo)\n");
+    CHECK(compiled.render({{"USE_VCPKG", "OFF"}, {"PROJECT_NAME", "demo"}, {"SUFFIX", "x"}}) ==
+          "cmake_minimum_required(VERSION 3.28)\nfind_package(fmt)\nproject(demo)_x\n");
+    CHECK(compiled.render({{"USE_VCPKG", ""}, {"USE_CPM", "1"}}) == "cmake_minimum_required(VERSION 3.28)\nproject(@PROJECT_NAME@)\n");
+
+    // Falsy values, in any case
+    for (const char *no : {"", "0", "false", "FALSE", "off", "No"}) {
+        CHECK(processor.compile("@if X@yes@else@no@endif@").render({{"X", no}}) == "no");
+    }
+    CHECK(processor.compile("@if X@yes@else@no@endif@").render({{"X", "true"}}) == "yes");
+}
+
+TEST_CASE("CompiledTemplate: each loops") {
+    PlaceholderProcessor processor;
+
+    auto compiled = processor.compile("dependencies:\n"
+                                      "@each DEP in DEPENDENCIES@\n"
+                                      "  - @DEP@ (@PROJECT_NAME@)\n"
+                                      "@endeach@\n"
+                                      "done @DEP@\n");
+    CHECK(compiled.render({{"DEPENDENCIES", "fmt;spdlog;doctest"}, {"PROJECT_NAME", "demo"}}) ==
+          "dependencies:\n  - fmt (demo)\n  - spdlog (demo)\n  - doctest (demo)\ndone @DEP@\n");
+    CHECK(compiled.render({{"DEPENDENCIES", ""}}) == "dependencies:\ndone @DEP@\n");
+    CHECK(compiled.render({}) == "dependencies:\ndone @DEP@\n");
+
+    // A trailing separator adds no empty item, empty items elsewhere are kept
+    auto items = processor.compile("@each I in L@<@I@>@endeach@");
+    CHECK(items.render({{"L", "a;b;"}}) == "<a><b>");
+    CHECK(items.render({{"L", "a;;b"}}) == "<a><><b>");
+    CHECK(items.render({{"L", ";"}}) == "<>");
+
+    // The loop variable shadows a value of the same name only inside the loop
+    CHECK(compiled.render({{"DEPENDENCIES", "fmt"}, {"DEP", "outer"}, {"PROJECT_NAME", "p"}}) ==
+          "dependencies:\n  - fmt (p)\ndone outer\n");
+
+    // Nested loops and conditions on the loop variable
+    auto nested = processor.compile("@each A in AS@@each B in BS@@A@@B@@if B@!@endif@ @endeach@@endeach@");
+    CHECK(nested.render({{"AS", "x;y"}, {"BS", "1;0"}}) == "x1! x0 y1! y0 ");
+}
+
+TEST_CASE("CompiledTemplate: directives that do not parse or do not match are text") {
+    PlaceholderProcessor processor;
+
+    CHECK(processor.compile("mail me@example.com @endif@ @else@ @iff X@").render({}) == "mail me@example.com @endif@ @else@ @iff X@");
+    CHECK_FALSE(processor.compile("@endeach@ @if x@").hasDirectives());
+
+    // The rest of a rejected directive is still scanned for placeholders
+    CHECK(processor.compile("@if lower@NAME@").render({{"NAME", "n"}}) == "@if lowern");
+
+    // A block left open ends with the template
+    CHECK(processor.compile("a@if X@b").render({}) == "a");
+    CHECK(processor.compile("@each I in L@<@I@>").render({{"L", "1;2"}}) == "<1><2>");
+}
+
+TEST_CASE("CompiledTemplate: render into a caller's buffer or a reused arena") {
+    PlaceholderProcessor processor;
+    auto                 compiled = processor.compile("project(@PROJECT_NAME@ VERSION @PROJECT_VERSION@) @UNSET@");
+    auto                 looped   = processor.compile("@each DEP in DEPS@[@DEP@]@endeach@@if !DEPS@none@endif@");
+
+    std::unordered_map<std::string, std::string> values = {{"PROJECT_NAME", "demo"}, {"PROJECT_VERSION", "1.2.3"}, {"DEPS", "a;bb"}};
+    SymbolValues                                 bound  = processor.symbols()->bind(values);
+    const std::string                            full   = compiled.render(values);
+    CHECK(compiled.renderedSize(bound) == full.size());
+    CHECK(looped.renderedSize(bound) == 7);
+
+    std::array<char, 64> buffer{};
+    std::size_t          size = compiled.renderInto(bound, buffer);
+    REQUIRE(size == full.size());
+    CHECK(std::string_view(buffer.data(), size) == full);
+
+    // Too small a buffer gets a prefix, and the size it would have needed
+    std::array<char, 8> small{};
+    CHECK(compiled.renderInto(bound, small) == full.size());
+    CHECK(std::string_view(small.data(), small.size()) == "project(");
+
+    // Once the arena is large enough, rendering reuses its storage
+    std::string arena;
+    arena.reserve(256);
+    const char *storage = arena.data();
+    CHECK(compiled.render(bound, arena) == full);
+    CHECK(looped.render(bound, arena) == "[a][bb]");
+    CHECK(compiled.render(bound, arena) == full);
+    CHECK(arena.data() == storage);
+
+    std::unordered_map<std::string, std::string> empty_list = {{"DEPS", ""}};
+    SymbolValues                                 no_deps    = processor.symbols()->bind(empty_list);
+    CHECK(looped.render(no_deps, arena) == "none");
+    CHECK(looped.renderedSize(no_deps) == 4);
+}
@@ -0,0 +1,229 @@
+#include "cgen/directory_tree.h"
+#include "cgen/scanner.h"
+#include "cgen/template_index.h"
+
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace cgen;
+
+namespace {
+
+fs::path make_temp_dir(const std::string &name) {
+    fs::path path = fs::temp_directory_path() / name;
+    fs::remove_all(path);
+    fs::create_directories(path);
+    return path;
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+// Every directory and file of a flat tree as "d <relative>" / "f <relative>", in tree order
+std::vector<std::string> flatten(const DirectoryTree &tree) {
+    std::vector<std::string> entries;
+    for (std::size_t i = 0; i < tree.nodes().size(); ++i) {
+        const auto &node     = tree.nodes()[i];
+        fs::path    relative = tree.relativePath(i);
+        if (i != 0) {
+            entries.push_back("d " + relative.generic_string());
+        }
+        for (std::size_t f = node.first_file; f < node.first_file + node.file_count; ++f) {
+            entries.push_back("f " + (relative / tree.name(tree.files()[f])).generic_string());
+        }
+    }
+    return entries;
+}
+
+void flatten(const std::shared_ptr<Directory> &dir, const fs::path &relative, std::vector<std::string> &entries) {
+    for (const auto &file : dir->files) {
+        entries.push_back("f " + (relative / file).generic_string());
+    }
+    for (const auto &sub_dir : dir->directories) {
+        entries.push_back("d " + (relative / sub_dir->name).generic_string());
+        flatten(sub_dir, relative / sub_dir->name, entries);
+    }
+}
+
+// Same listing for the shared_ptr tree, with the virtual "." directory folded into the root
+std::vector<std::string> flatten(const std::set<std::shared_ptr<Directory>, CompareDirectoryByName<Directory>> &top_level_entries) {
+    std::vector<std::string> entries;
+    for (const auto &dir : top_level_entries) {
+        if (dir->name == ".") {
+            flatten(dir, fs::path{}, entries);
+        } else {
+            entries.push_back("d " + dir->name);
+            flatten(dir, dir->name, entries);
+        }
+    }
+    return entries;
+}
+
+} // namespace
+
+TEST_CASE("DirectoryTree: builder lays nodes out in pre-order") {
+    DirectoryTree tree("/templates/example");
+    tree.openDirectory("");
+    tree.addFile("CMakeLists.txt");
+    tree.openDirectory("include");
+    tree.openDirectory("example");
+    tree.addFile("example.h");
+    tree.closeDirectory();
+    tree.closeDirectory();
+    tree.openDirectory("src");
+    tree.addFile("a.cpp");
+    tree.addFile("b.cpp");
+    tree.closeDirectory();
+    tree.closeDirectory();
+
+    const auto &nodes = tree.nodes();
+    REQUIRE(nodes.size() == 4);
+    CHECK(tree.name(nodes[0].name).empty());
+    CHECK(nodes[0].parent == DirectoryTree::no_parent);
+    CHECK(nodes[0].subtree_end == 4);
+
+    CHECK(tree.name(nodes[1].name) == "include");
+    CHECK(nodes[1].parent == 0);
+    CHECK(nodes[1].subtree_end == 3); // Its next sibling is "src"
+    CHECK(nodes[1].file_count == 0);
+
+    CHECK(tree.name(nodes[2].name) == "example");
+    CHECK(nodes[2].parent == 1);
+    CHECK(tree.relativePath(2) == fs::path("include") / "example");
+
+    CHECK(tree.name(nodes[3].name) == "src");
+    CHECK(nodes[3].file_count == 2);
+    CHECK(tree.name(tree.files()[nodes[3].first_file]) == "a.cpp");
+    CHECK(tree.name(tree.files()[nodes[3].first_file + 1]) == "b.cpp");
+
+    CHECK(tree.relativePath(0).empty());
+    CHECK(tree.rootPath() == fs::path("/templates/example"));
+}
+
+TEST_CASE("scan_template_directory: flat tree matches the Directory tree") {
+    fs::path base = make_temp_dir("cgen_flat_tree_test");
+    write_file(base / "tpl" / "CMakeLists.txt", "project(@PROJECT_NAME@)");
+    write_file(base / "tpl" / "README.md", "# @PROJECT_NAME@");
+    write_file(base / "tpl" / "src" / "main.cpp", "int main() {}");
+    write_file(base / "tpl" / "src" / "detail" / "impl.h", "");
+    write_file(base / "tpl" / "include" / "a.h", "");
+    fs::create_directories(base / "tpl" / "empty");
+    write_file(base / "outside" / "linked.txt", "");
+    fs::create_directory_symlink(base / "outside", base / "tpl" / "linked");
+
+    auto flat = scan_template_directory("tpl", base.string(), flat_tree);
+    REQUIRE(flat.has_value());
+    auto shared = scan_template_directory("tpl", base.string());
+    REQUIRE(shared.has_value());
+
+    auto flat_entries   = flatten(flat.value());
+    auto shared_entries = flatten(shared.value());
+    std::sort(flat_entries.begin(), flat_entries.end());
+    std::sort(shared_entries.begin(), shared_entries.end());
+    CHECK(flat_entries == shared_entries);
+
+    // The symlinked directory is listed but not descended into
+    CHECK(std::find(flat_entries.begin(), flat_entries.end(), "d linked") != flat_entries.end());
+    CHECK(std::find(flat_entries.begin(), flat_entries.end(), "f linked/linked.txt") == flat_entries.end());
+
+    CHECK(flat->rootPath() == fs::weakly_canonical(base / "tpl"));
+    CHECK_FALSE(scan_template_directory("missing", base.string(), flat_tree).has_value());
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("scan_template_directory: parallel scan builds the same tree as the sequential one") {
+    fs::path base = make_temp_dir("cgen_parallel_scan_test");
+    fs::path tpl  = base / "tpl";
+    for (int d = 0; d < 12; ++d) {
+        fs::path dir = tpl / ("dir" + std::to_string(d));
+        for (int s = 0; s < 3; ++s) {
+            write_file(dir / ("sub" + std::to_string(s)) / "deep" / "leaf.txt", "");
+            write_file(dir / ("sub" + std::to_string(s)) / ("file" + std::to_string(s)), "");
+        }
+        write_file(dir / "CMakeLists.txt", "");
+    }
+    write_file(tpl / "README.md", "");
+    fs::create_directories(tpl / "empty");
+    write_file(base / "outside" / "linked.txt", "");
+    fs::create_directory_symlink(base / "outside", tpl / "linked_dir");
+    fs::create_symlink(base / "outside" / "linked.txt", tpl / "linked_file");
+    fs::create_symlink(base / "nowhere", tpl / "dangling");
+
+    auto sequential = scan_template_directory("tpl", base.string(), flat_tree);
+    REQUIRE(sequential.has_value());
+
+    for (std::size_t workers : {1, 4}) {
+        ThreadPool pool(workers);
+        auto       parallel = scan_template_directory("tpl", base.string(), flat_tree, pool);
+        REQUIRE(parallel.has_value());
+        CHECK(flatten(parallel.value()) == flatten(sequential.value())); // Same order, not only the same entries
+        CHECK(parallel->rootPath() == sequential->rootPath());
+        CHECK(parallel->nodes().size() == sequential->nodes().size());
+    }
+
+    ThreadPool pool(2);
+    auto       entries = flatten(scan_template_directory("tpl", base.string(), flat_tree, pool).value());
+    CHECK(std::find(entries.begin(), entries.end(), "f linked_file") != entries.end());
+    CHECK(std::find(entries.begin(), entries.end(), "d linked_dir") != entries.end());
+    CHECK(std::find(entries.begin(), entries.end(), "f linked_dir/linked.txt") == entries.end());
+    CHECK(std::find(entries.begin(), entries.end(), "f dangling") == entries.end());
+    CHECK_FALSE(scan_template_directory("missing", base.string(), flat_tree, pool).has_value());
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("scan_template_directory: repeated parallel scans of a deep and wide tree are complete") {
+    fs::path base = make_temp_dir("cgen_parallel_scan_stress_test");
+    fs::path tpl  = base / "tpl";
+
+    // Wide at the top and six levels deep below each branch, so subdirectory tasks are submitted
+    // from inside running tasks and stolen by other workers throughout the scan
+    for (int d = 0; d < 16; ++d) {
+        fs::path dir = tpl / ("dir" + std::to_string(d));
+        for (int s = 0; s < 4; ++s) {
+            fs::path chain = dir / ("sub" + std::to_string(s));
+            for (int level = 0; level < 6; ++level) {
+                write_file(chain / ("file" + std::to_string(level)), "");
+                chain /= "level" + std::to_string(level);
+            }
+            fs::create_directories(chain);
+        }
+    }
+
+    auto sequential = scan_template_directory("tpl", base.string(), flat_tree);
+    REQUIRE(sequential.has_value());
+    const auto expected = flatten(sequential.value());
+
+    ThreadPool pool(4);
+    for (int round = 0; round < 50; ++round) {
+        auto parallel = scan_template_directory("tpl", base.string(), flat_tree, pool);
+        REQUIRE(parallel.has_value());
+        REQUIRE(flatten(parallel.value()) == expected);
+    }
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("TemplateIndex: flat tree matches a direct scan") {
+    fs::path base = make_temp_dir("cgen_flat_index_test");
+    write_file(base / "tpl" / "CMakeLists.txt", "project(@PROJECT_NAME@)");
+    write_file(base / "tpl" / "src" / "main.cpp", "int main() {}");
+    write_file(base / "tpl" / "src" / "util" / "util.h", "");
+    fs::create_directories(base / "tpl" / "empty");
+
+    auto index = TemplateIndex::open("tpl", base.string());
+    REQUIRE(index.has_value());
+    auto scanned = scan_template_directory("tpl", base.string(), flat_tree);
+    REQUIRE(scanned.has_value());
+
+    CHECK(flatten(index->tree()) == flatten(scanned.value()));
+    CHECK(index->tree().rootPath() == scanned->rootPath());
+
+    fs::remove_all(base);
+}
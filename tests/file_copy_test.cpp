@@ -0,0 +1,114 @@
+#include "cgen/file_copy.h"
+#include "cgen/generator.h"
+
+#include <doctest/doctest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace cgen;
+
+namespace {
+
+fs::path make_temp_dir(const std::string &name) {
+    fs::path path = fs::temp_directory_path() / name;
+    fs::remove_all(path);
+    fs::create_directories(path);
+    return path;
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::binary) << content;
+}
+
+std::string read_file(const fs::path &path) {
+    std::ifstream     in(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+} // namespace
+
+TEST_CASE("copy_file_contents: copies small, large, binary and empty files") {
+    fs::path dir = make_temp_dir("cgen_file_copy_test");
+
+    std::string binary;
+    for (int i = 0; i < 300000; ++i) {
+        binary += static_cast<char>(i * 31 % 256);
+    }
+    write_file(dir / "binary.bin", binary);
+    write_file(dir / "small.txt", ".clang-format contents\n");
+    write_file(dir / "empty.txt", "");
+
+    for (const char *name : {"binary.bin", "small.txt", "empty.txt"}) {
+        CAPTURE(name);
+        auto method = copy_file_contents(dir / name, dir / (std::string(name) + ".copy"));
+        REQUIRE(method.has_value());
+        CHECK(read_file(dir / (std::string(name) + ".copy")) == read_file(dir / name));
+    }
+
+    // An existing destination is truncated, not appended to
+    write_file(dir / "target.txt", std::string(1000, 'z'));
+    REQUIRE(copy_file_contents(dir / "small.txt", dir / "target.txt").has_value());
+    CHECK(read_file(dir / "target.txt") == ".clang-format contents\n");
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("copy_file_contents: reports errors") {
+    fs::path dir = make_temp_dir("cgen_file_copy_error_test");
+    write_file(dir / "source.txt", "text");
+
+    auto missing = copy_file_contents(dir / "missing.txt", dir / "out.txt");
+    REQUIRE_FALSE(missing.has_value());
+    CHECK(missing.error() == std::errc::no_such_file_or_directory);
+    CHECK_FALSE(fs::exists(dir / "out.txt"));
+
+    CHECK_FALSE(copy_file_contents(dir / "source.txt", dir / "no_such_dir" / "out.txt").has_value());
+
+    // Copying a file onto itself must not truncate it
+    fs::create_hard_link(dir / "source.txt", dir / "link.txt");
+    for (const char *target : {"source.txt", "link.txt"}) {
+        CAPTURE(target);
+        auto same = copy_file_contents(dir / "source.txt", dir / target);
+        REQUIRE_FALSE(same.has_value());
+        CHECK(same.error() == std::errc::file_exists);
+        CHECK(read_file(dir / "source.txt") == "text");
+    }
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("CompiledTemplate: rendersVerbatim only when no placeholder is bound") {
+    PlaceholderProcessor processor;
+    CHECK(processor.compile("BasedOnStyle: LLVM\n").rendersVerbatim({{"PROJECT_NAME", "demo"}}));
+    CHECK(processor.compile("@UNBOUND@ text").rendersVerbatim({{"PROJECT_NAME", "demo"}}));
+    CHECK_FALSE(processor.compile("@PROJECT_NAME@").rendersVerbatim({{"PROJECT_NAME", "demo"}}));
+}
+
+TEST_CASE("generate_project: placeholder-free files are copied byte for byte") {
+    fs::path base = make_temp_dir("cgen_pass_through_test");
+    fs::path out  = make_temp_dir("cgen_pass_through_out");
+
+    std::string asset(200000, '\0');
+    for (std::size_t i = 0; i < asset.size(); ++i) {
+        asset[i] = static_cast<char>(i % 251);
+    }
+    write_file(base / "tpl" / "assets" / "logo.bin", asset);
+    write_file(base / "tpl" / ".clang-format", "BasedOnStyle: LLVM\n");
+    write_file(base / "tpl" / "CMakeLists.txt", "project(@PROJECT_NAME@)\n");
+
+    auto tree = scan_template_directory("tpl", base.string(), flat_tree);
+    REQUIRE(tree.has_value());
+    PlaceholderProcessor processor;
+    REQUIRE(generate_project(tree.value(), out, processor, {{"PROJECT_NAME", "demo"}}).has_value());
+
+    CHECK(read_file(out / "assets" / "logo.bin") == asset);
+    CHECK(read_file(out / ".clang-format") == "BasedOnStyle: LLVM\n");
+    CHECK(read_file(out / "CMakeLists.txt") == "project(demo)\n");
+
+    fs::remove_all(base);
+    fs::remove_all(out);
+}
@@ -0,0 +1,95 @@
+#include "cgen/file_source.h"
+#include "cgen/placeholder_processor.h"
+
+#include <doctest/doctest.h>
+#include <fstream>
+#include <string>
+
+using namespace cgen;
+
+namespace {
+
+fs::path make_temp_dir(const std::string &name) {
+    fs::path path = fs::temp_directory_path() / name;
+    fs::remove_all(path);
+    fs::create_directories(path);
+    return path;
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+    std::ofstream(path, std::ios::binary) << content;
+}
+
+} // namespace
+
+TEST_CASE("FileSource: small files are read into a buffer") {
+    fs::path dir = make_temp_dir("cgen_file_source_small");
+    write_file(dir / "small.txt", "project(@PROJECT_NAME@)\n");
+
+    auto source = FileSource::open(dir / "small.txt");
+    REQUIRE(source.has_value());
+    CHECK_FALSE(source->isMapped());
+    CHECK(source->view() == "project(@PROJECT_NAME@)\n");
+
+    write_file(dir / "empty.txt", "");
+    auto empty = FileSource::open(dir / "empty.txt");
+    REQUIRE(empty.has_value());
+    CHECK(empty->view().empty());
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("FileSource: large files are mapped and survive moves") {
+    fs::path    dir = make_temp_dir("cgen_file_source_large");
+    std::string content;
+    for (std::size_t i = 0; content.size() < 4 * FileSource::mmap_threshold; ++i) {
+        content += "// line " + std::to_string(i) + " of @PROJECT_NAME@\n";
+    }
+    write_file(dir / "large.h", content);
+
+    auto source = FileSource::open(dir / "large.h");
+    REQUIRE(source.has_value());
+#if defined(__unix__) || defined(__APPLE__)
+    CHECK(source->isMapped());
+#endif
+    CHECK(source->view() == content);
+
+    FileSource moved = std::move(source.value());
+    CHECK(moved.view() == content);
+    CHECK(source->view().empty());
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("FileSource: missing files report an error") {
+    auto source = FileSource::open(fs::temp_directory_path() / "cgen_file_source_missing" / "nope.txt");
+    REQUIRE_FALSE(source.has_value());
+    CHECK(source.error() == std::errc::no_such_file_or_directory);
+}
+
+#if defined(__linux__)
+TEST_CASE("FileSource: files reporting a zero size are read to the end") {
+    auto source = FileSource::open("/proc/self/status");
+    REQUIRE(source.has_value());
+    CHECK_FALSE(source->isMapped());
+    CHECK(source->view().find("Name:") != std::string_view::npos);
+}
+#endif
+
+TEST_CASE("PlaceholderProcessor: compiles a mapped file without copying it") {
+    fs::path    dir = make_temp_dir("cgen_file_source_compile");
+    std::string content(2 * FileSource::mmap_threshold, 'x');
+    content += "@PROJECT_NAME@";
+    write_file(dir / "big.txt", content);
+
+    auto source = FileSource::open(dir / "big.txt");
+    REQUIRE(source.has_value());
+    const char *mapped_bytes = source->view().data();
+
+    PlaceholderProcessor processor;
+    CompiledTemplate     compiled = processor.compile(std::move(source.value()));
+    CHECK(compiled.source().data() == mapped_bytes);
+    CHECK(compiled.render({{"PROJECT_NAME", "demo"}}) == std::string(2 * FileSource::mmap_threshold, 'x') + "demo");
+
+    fs::remove_all(dir);
+}
@@ -0,0 +1,140 @@
+#include "cgen/generation_manifest.h"
+#include "cgen/generator.h"
+
+#include <chrono>
+#include <doctest/doctest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace cgen;
+
+namespace {
+
+fs::path make_temp_dir(const std::string &name) {
+    fs::path path = fs::temp_directory_path() / name;
+    fs::remove_all(path);
+    fs::create_directories(path);
+    return path;
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+std::string read_file(const fs::path &path) {
+    std::ifstream     in(path);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+// A day in the past: outputs are backdated to it, so any rewrite is visible however coarse the clock is
+const fs::file_time_type yesterday = fs::file_time_type::clock::now() - std::chrono::hours(24);
+
+} // namespace
+
+TEST_CASE("ContentHasher: XXH64 digests, independent of how the input is split") {
+    CHECK(hash_content("") == 0xef46db3751d8e999ULL);
+    CHECK(hash_content("abc") == 0x44bc2cf5ad770999ULL);
+
+    std::string data;
+    for (int i = 0; i < 3 * 256; ++i) {
+        data += static_cast<char>(i % 256);
+    }
+    CHECK(hash_content(data) == 0x8e03c838c596036fULL);
+
+    for (std::size_t piece : {1, 3, 31, 32, 33, 100}) {
+        ContentHasher hasher;
+        for (std::size_t pos = 0; pos < data.size(); pos += piece) {
+            hasher.update(std::string_view(data).substr(pos, piece));
+        }
+        CHECK(hasher.digest() == hash_content(data));
+    }
+}
+
+TEST_CASE("GenerationManifest: save and load") {
+    fs::path base = make_temp_dir("cgen_manifest_test");
+
+    GenerationManifest manifest;
+    manifest.record("src/main.cpp", {1, 2, 3, {4, 5}});
+    manifest.record(fs::path("dir with spaces") / "file name.txt", {0xffffffffffffffffULL, 0, 7, {0, -1}});
+    REQUIRE(manifest.save(base).has_value());
+
+    auto loaded = GenerationManifest::load(base);
+    CHECK(loaded.size() == 2);
+    REQUIRE(loaded.find("src/main.cpp") != nullptr);
+    CHECK(loaded.find("src/main.cpp")->output_hash == 3);
+    CHECK(loaded.find("src/main.cpp")->stamp == OutputStamp{4, 5});
+    REQUIRE(loaded.find(fs::path("dir with spaces") / "file name.txt") != nullptr);
+    CHECK(loaded.find(fs::path("dir with spaces") / "file name.txt")->template_hash == 0xffffffffffffffffULL);
+    CHECK(loaded.find("missing") == nullptr);
+
+    // A damaged manifest is ignored as a whole
+    write_file(GenerationManifest::manifestPath(base), "cgen-manifest 1\nF 1 2 3 oops\n");
+    CHECK(GenerationManifest::load(base).size() == 0);
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("generate_project: incremental generation leaves up-to-date outputs untouched") {
+    fs::path base = make_temp_dir("cgen_incremental_test");
+    fs::path tpl  = base / "templates" / "tpl";
+    fs::path out  = base / "out";
+    write_file(tpl / "CMakeLists.txt", "project(@PROJECT_NAME@)\n");
+    write_file(tpl / "AUTHORS", "@AUTHOR_NAME@\n");
+    write_file(tpl / "src" / "main.cpp", "int main() {}\n");
+    fs::create_directories(out);
+
+    auto scanned = scan_template_directory("tpl", (base / "templates").string(), flat_tree);
+    REQUIRE(scanned.has_value());
+
+    PlaceholderProcessor                         processor;
+    std::unordered_map<std::string, std::string> values = {{"PROJECT_NAME", "demo"}, {"AUTHOR_NAME", "me"}};
+    GenerateOptions                              options;
+    options.incremental = true;
+
+    std::vector<fs::path> outputs  = {out / "CMakeLists.txt", out / "AUTHORS", out / "src" / "main.cpp"};
+    auto                  generate = [&] { REQUIRE(generate_project(scanned.value(), out, processor, values, options).has_value()); };
+    auto                  backdate = [&] {
+        for (const auto &path : outputs) {
+            fs::last_write_time(path, yesterday);
+        }
+    };
+
+    generate();
+    CHECK(read_file(out / "CMakeLists.txt") == "project(demo)\n");
+    CHECK(GenerationManifest::load(out).size() == 3);
+
+    // Nothing changed: no output is rewritten
+    backdate();
+    generate();
+    for (const auto &path : outputs) {
+        CHECK(fs::last_write_time(path) == yesterday);
+    }
+
+    // A value used by one file only rewrites that file
+    values["AUTHOR_NAME"] = "someone else";
+    generate();
+    CHECK(read_file(out / "AUTHORS") == "someone else\n");
+    CHECK(fs::last_write_time(out / "AUTHORS") != yesterday);
+    CHECK(fs::last_write_time(out / "CMakeLists.txt") == yesterday);
+
+    // Without a manifest, outputs that render to the same bytes are still left alone
+    backdate();
+    fs::remove(GenerationManifest::manifestPath(out));
+    generate();
+    for (const auto &path : outputs) {
+        CHECK(fs::last_write_time(path) == yesterday);
+    }
+    CHECK(GenerationManifest::load(out).size() == 3);
+
+    // An output edited by hand is regenerated
+    write_file(out / "CMakeLists.txt", "edited\n");
+    generate();
+    CHECK(read_file(out / "CMakeLists.txt") == "project(demo)\n");
+
+    fs::remove_all(base);
+}
@@ -0,0 +1,145 @@
+#include "cgen/generator.h"
+
+#include <doctest/doctest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace cgen;
+
+namespace {
+
+fs::path make_temp_dir(const std::string &name) {
+    fs::path path = fs::temp_directory_path() / name;
+    fs::remove_all(path);
+    fs::create_directories(path);
+    return path;
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+std::string read_file(const fs::path &path) {
+    std::ifstream     in(path);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+} // namespace
+
+TEST_CASE("generate_project: output does not depend on the number of jobs") {
+    fs::path base = make_temp_dir("cgen_generator_jobs_test");
+    fs::path tpl  = base / "templates" / "tpl";
+    write_file(tpl / "CMakeLists.txt", "project(@PROJECT_NAME@)\n");
+    write_file(tpl / "README.md", "# @PROJECT_NAME@ by @AUTHOR_NAME@\n");
+    for (int i = 0; i < 20; ++i) {
+        write_file(tpl / "src" / ("file" + std::to_string(i) + ".cpp"), "// @PROJECT_NAME@ " + std::to_string(i) + "\n");
+    }
+    write_file(tpl / "src" / "nested" / "deep.h", "#pragma once // @UNBOUND@\n");
+
+    auto scanned = scan_template_directory("tpl", (base / "templates").string());
+    REQUIRE(scanned.has_value());
+
+    PlaceholderProcessor                         processor;
+    std::unordered_map<std::string, std::string> values = {{"PROJECT_NAME", "demo"}, {"AUTHOR_NAME", "me"}};
+
+    for (std::size_t jobs : {1, 4}) {
+        fs::path out = base / ("out" + std::to_string(jobs));
+        fs::create_directories(out);
+
+        GenerateOptions options;
+        options.jobs = jobs;
+        REQUIRE(generate_project(scanned.value(), out, processor, values, options).has_value());
+
+        CHECK(read_file(out / "CMakeLists.txt") == "project(demo)\n");
+        CHECK(read_file(out / "README.md") == "# demo by me\n");
+        CHECK(read_file(out / "src" / "file7.cpp") == "// demo 7\n");
+        CHECK(read_file(out / "src" / "nested" / "deep.h") == "#pragma once // @UNBOUND@\n");
+    }
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("generate_project: placeholders in file and directory names") {
+    fs::path base = make_temp_dir("cgen_generator_names_test");
+    fs::path tpl  = base / "templates" / "tpl";
+    write_file(tpl / "cmake" / "@PROJECT_NAME@-config.cmake.in", "@PACKAGE_INIT@ @PROJECT_NAME@\n");
+    write_file(tpl / "include" / "@NAMESPACE@" / "@PROJECT_NAME@.h", "// @PROJECT_NAME@\n");
+    write_file(tpl / "include" / "@NAMESPACE@" / "detail" / "impl.h", "// impl\n");
+    write_file(tpl / "@UNBOUND@.txt", "kept\n");
+    write_file(tpl / "plain.txt", "plain\n");
+
+    PlaceholderProcessor processor;
+    auto                 flat   = scan_template_directory("tpl", (base / "templates").string(), flat_tree);
+    auto                 nested = scan_template_directory("tpl", (base / "templates").string());
+    REQUIRE(flat.has_value());
+    REQUIRE(nested.has_value());
+
+    // One prepared template, rendered into projects with different names
+    ThreadPool pool(2);
+    for (bool use_flat : {true, false}) {
+        auto prepared_or = use_flat ? prepare_template(flat.value(), processor, pool) : prepare_template(nested.value(), processor, pool);
+        REQUIRE(prepared_or.has_value());
+        CHECK(prepared_or->templated_names);
+
+        for (std::string name : {"alpha", "beta"}) {
+            fs::path out = base / "out" / name;
+            fs::create_directories(out);
+            REQUIRE(generate_project(prepared_or.value(), out, {{"PROJECT_NAME", name}, {"NAMESPACE", "ns_" + name}}, pool).has_value());
+
+            CHECK(read_file(out / "cmake" / (name + "-config.cmake.in")) == "@PACKAGE_INIT@ " + name + "\n");
+            CHECK(read_file(out / "include" / ("ns_" + name) / (name + ".h")) == "// " + name + "\n");
+            CHECK(read_file(out / "include" / ("ns_" + name) / "detail" / "impl.h") == "// impl\n");
+            CHECK(read_file(out / "@UNBOUND@.txt") == "kept\n");
+            CHECK(read_file(out / "plain.txt") == "plain\n");
+            CHECK_FALSE(fs::exists(out / "cmake" / "@PROJECT_NAME@-config.cmake.in"));
+        }
+        fs::remove_all(base / "out");
+    }
+
+    // Values that are not a single path component skip the entry and everything below it
+    auto prepared = prepare_template(flat.value(), processor, pool);
+    REQUIRE(prepared.has_value());
+    fs::path out = base / "out" / "invalid";
+    fs::create_directories(out);
+    REQUIRE(generate_project(prepared.value(), out, {{"PROJECT_NAME", "../escape"}, {"NAMESPACE", ".."}}, pool).has_value());
+    CHECK_FALSE(fs::exists(base / "out" / "escape-config.cmake.in"));
+    CHECK_FALSE(fs::exists(out / "include" / "detail"));
+    CHECK(fs::exists(out / "plain.txt"));
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("is_single_path_component: names that stay one directory level") {
+    for (const char *name : {"demo", "my project", "v1.2", "..hidden", "a..b"}) {
+        CAPTURE(name);
+        CHECK(is_single_path_component(name));
+    }
+    for (const char *name : {"", ".", "..", "a/b", "a\\b", "/abs", "../up"}) {
+        CAPTURE(name);
+        CHECK_FALSE(is_single_path_component(name));
+    }
+    CHECK_FALSE(is_single_path_component(std::string_view("a\0b", 3)));
+}
+
+TEST_CASE("generate_project: file names rendered to the same path are generated once") {
+    fs::path base = make_temp_dir("cgen_generator_name_clash_test");
+    fs::path tpl  = base / "templates" / "tpl";
+    write_file(tpl / "@A@.txt", "from A\n");
+    write_file(tpl / "@B@.txt", "from B\n");
+
+    auto scanned = scan_template_directory("tpl", (base / "templates").string(), flat_tree);
+    REQUIRE(scanned.has_value());
+
+    PlaceholderProcessor processor;
+    fs::path             out = base / "out";
+    fs::create_directories(out);
+    REQUIRE(generate_project(scanned.value(), out, processor, {{"A", "same"}, {"B", "same"}}).has_value());
+    CHECK(read_file(out / "same.txt") == "from A\n");
+
+    fs::remove_all(base);
+}
@@ -0,0 +1,169 @@
+#include "cgen/generation_manifest.h"
+#include "cgen/generator.h"
+#include "cgen/io_ring.h"
+
+#include <doctest/doctest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace cgen;
+
+namespace {
+
+fs::path make_temp_dir(const std::string &name) {
+    fs::path path = fs::temp_directory_path() / name;
+    fs::remove_all(path);
+    fs::create_directories(path);
+    return path;
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+std::string read_file(const fs::path &path) {
+    std::ifstream     in(path);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+} // namespace
+
+TEST_CASE("IoRing: reads and writes batches larger than the ring") {
+    auto ring = IoRing::create(8);
+    if (!ring) {
+        MESSAGE("io_uring is unavailable here: " << ring.error().message());
+        return;
+    }
+    REQUIRE(ring->batchSize() == 4);
+
+    fs::path                      base = make_temp_dir("cgen_io_ring_test");
+    std::vector<fs::path>         paths;
+    std::vector<std::string>      texts;
+    std::vector<std::string_view> contents;
+    for (int i = 0; i < 11; ++i) {
+        paths.push_back(base / ("file" + std::to_string(i)));
+        texts.push_back(std::string(static_cast<std::size_t>(i) * 1000, static_cast<char>('a' + i))); // file0 is empty
+    }
+    for (const auto &text : texts) {
+        contents.push_back(text);
+    }
+
+    auto errors = ring->writeFiles(paths, contents);
+    REQUIRE(errors.size() == paths.size());
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        CHECK_FALSE(errors[i]);
+        CHECK(read_file(paths[i]) == texts[i]);
+    }
+
+    // Writing truncates what was there
+    std::vector<std::string_view> shorter(paths.size(), "short");
+    ring->writeFiles(paths, shorter);
+    CHECK(read_file(paths[10]) == "short");
+
+    paths.push_back(base / "missing");
+    paths.push_back(base); // A directory
+    auto read = ring->readFiles(paths);
+    REQUIRE(read.size() == paths.size());
+    for (std::size_t i = 0; i < 11; ++i) {
+        REQUIRE(read[i].has_value());
+        CHECK(read[i].value() == "short");
+    }
+    REQUIRE_FALSE(read[11].has_value());
+    CHECK(read[11].error() == std::errc::no_such_file_or_directory);
+    CHECK_FALSE(read[12].has_value());
+
+    // Creating a file in a missing directory fails for that file only
+    std::vector<fs::path>         targets  = {base / "no" / "such" / "dir", base / "fine"};
+    std::vector<std::string_view> payloads = {"x", "fine"};
+    auto                          failed   = ring->writeFiles(targets, payloads);
+    CHECK(failed[0] == std::errc::no_such_file_or_directory);
+    CHECK_FALSE(failed[1]);
+    CHECK(read_file(base / "fine") == "fine");
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("generate_project: the io_uring backend generates the same project as the blocking one") {
+    fs::path base = make_temp_dir("cgen_io_backend_test");
+    fs::path tpl  = base / "templates" / "tpl";
+    write_file(tpl / "CMakeLists.txt", "project(@PROJECT_NAME@)\n");
+    write_file(tpl / "LICENSE", std::string(20000, 'L')); // Verbatim, and mapped by the blocking backend
+    write_file(tpl / "empty", "");
+    for (int i = 0; i < 300; ++i) {
+        write_file(tpl / "src" / ("file" + std::to_string(i) + ".cpp"), "// @PROJECT_NAME@ " + std::to_string(i) + "\n");
+    }
+
+    auto scanned = scan_template_directory("tpl", (base / "templates").string(), flat_tree);
+    REQUIRE(scanned.has_value());
+
+    PlaceholderProcessor                         processor;
+    std::unordered_map<std::string, std::string> values = {{"PROJECT_NAME", "demo"}};
+    GenerateOptions                              options;
+    options.jobs = 4;
+
+    fs::path blocking_out = base / "blocking";
+    fs::path uring_out    = base / "uring";
+    fs::create_directories(blocking_out);
+    fs::create_directories(uring_out);
+    REQUIRE(generate_project(scanned.value(), blocking_out, processor, values, options).has_value());
+    options.io = io_backend::io_uring;
+    REQUIRE(generate_project(scanned.value(), uring_out, processor, values, options).has_value());
+
+    std::size_t compared = 0;
+    for (const auto &entry : fs::recursive_directory_iterator(blocking_out)) {
+        if (entry.is_regular_file()) {
+            fs::path relative = fs::relative(entry.path(), blocking_out);
+            CHECK(read_file(uring_out / relative) == read_file(entry.path()));
+            ++compared;
+        }
+    }
+    CHECK(compared == 303);
+    CHECK(read_file(uring_out / "src" / "file299.cpp") == "// demo 299\n");
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("generate_staged: the io_uring backend records every written file in the manifest") {
+    fs::path base = make_temp_dir("cgen_io_staging_test");
+    fs::path tpl  = base / "templates" / "tpl";
+    fs::path out  = base / "out";
+    write_file(tpl / "CMakeLists.txt", "project(@PROJECT_NAME@)\n");
+    write_file(tpl / "LICENSE", std::string(20000, 'L'));
+    for (int i = 0; i < 100; ++i) {
+        write_file(tpl / "src" / ("file" + std::to_string(i) + ".cpp"), "// @PROJECT_NAME@ " + std::to_string(i) + "\n");
+    }
+
+    auto scanned = scan_template_directory("tpl", (base / "templates").string(), flat_tree);
+    REQUIRE(scanned.has_value());
+
+    PlaceholderProcessor                         processor;
+    std::unordered_map<std::string, std::string> values = {{"PROJECT_NAME", "demo"}};
+    GenerateOptions                              options;
+    options.jobs    = 4;
+    options.staging = true;
+    options.io      = io_backend::io_uring;
+    REQUIRE(generate_project(scanned.value(), out, processor, values, options).has_value());
+
+    auto manifest = GenerationManifest::load(out);
+    CHECK(manifest.size() == 102);
+    const ManifestEntry *cmake = manifest.find("CMakeLists.txt");
+    REQUIRE(cmake != nullptr);
+    CHECK(cmake->template_hash == hash_content("project(@PROJECT_NAME@)\n"));
+    CHECK(cmake->output_hash == hash_content("project(demo)\n"));
+    CHECK(cmake->stamp == output_stamp(out / "CMakeLists.txt"));
+    const ManifestEntry *license = manifest.find("LICENSE");
+    REQUIRE(license != nullptr);
+    CHECK(license->output_hash == hash_content(std::string(20000, 'L')));
+
+    // The recorded entries describe the output exactly, so it may be replaced again
+    values["PROJECT_NAME"] = "renamed";
+    REQUIRE(generate_project(scanned.value(), out, processor, values, options).has_value());
+    CHECK(read_file(out / "src" / "file99.cpp") == "// renamed 99\n");
+
+    fs::remove_all(base);
+}
@@ -105,6 +105,16 @@ TEST_CASE("Edge cases for replace") {
     CHECK(result == "value1");
 }
 
+TEST_CASE("Directives are only interpreted when asked for") {
+    PlaceholderProcessor processor;
+
+    std::string content = "@if ON@@FOO@@endif@";
+    CHECK(processor.replacePlaceholders(content, {{"FOO", "x"}}) == "@if ON@x@endif@");
+    CHECK(processor.replacePlaceholders(content, {{"FOO", "x"}}, true) == "");
+    CHECK(processor.replacePlaceholders(content, {{"FOO", "x"}, {"ON", "1"}}, true) == "x");
+    CHECK_FALSE(processor.compile(content, false).hasDirectives());
+}
+
 TEST_CASE("Replace with multiple styles") {
     PlaceholderProcessor processor({PlaceholderStyle::AtSign, PlaceholderStyle::HashTag});
 
@@ -0,0 +1,103 @@
+#include "cgen/placeholder_processor.h"
+#include "cgen/placeholder_scanner.h"
+
+#include <doctest/doctest.h>
+#include <random>
+#include <regex>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace cgen;
+
+namespace {
+
+// Reference implementation: the regex alternation the processor used before the hand-written scanner
+std::vector<std::pair<std::size_t, std::size_t>> regex_matches(const std::string &text, const std::string &pattern) {
+    std::vector<std::pair<std::size_t, std::size_t>> matches;
+    std::regex                                       regex(pattern);
+    for (std::sregex_iterator it(text.begin(), text.end(), regex), end; it != end; ++it) {
+        matches.emplace_back(static_cast<std::size_t>(it->position(0)), static_cast<std::size_t>(it->length(0)));
+    }
+    return matches;
+}
+
+std::vector<std::pair<std::size_t, std::size_t>> scanner_matches(const std::string &text, const PlaceholderScanner &scanner) {
+    std::vector<std::pair<std::size_t, std::size_t>> matches;
+    std::size_t                                      pos = 0;
+    while (auto match = scanner.next(text, pos)) {
+        matches.emplace_back(match->offset, match->length);
+        pos = match->offset + match->length;
+    }
+    return matches;
+}
+
+} // namespace
+
+TEST_CASE("PlaceholderScanner: basic matches") {
+    PlaceholderScanner scanner("@");
+    std::string        text = "x @FOO@ y @bar@ @@ @A@B@ @_1@";
+
+    auto matches = scanner_matches(text, scanner);
+    REQUIRE(matches.size() == 3);
+    CHECK(text.substr(matches[0].first, matches[0].second) == "@FOO@");
+    CHECK(text.substr(matches[1].first, matches[1].second) == "@A@");
+    CHECK(text.substr(matches[2].first, matches[2].second) == "@_1@");
+
+    auto first = scanner.next(text, 0);
+    REQUIRE(first.has_value());
+    CHECK(first->name(text) == "FOO");
+}
+
+TEST_CASE("PlaceholderScanner: delimiters across vector block boundaries") {
+    PlaceholderScanner scanner("@#%");
+    for (std::size_t prefix = 0; prefix < 70; ++prefix) {
+        std::string text(prefix, 'a');
+        text += "#KEY#";
+        text += std::string(prefix % 37, 'b');
+
+        auto match = scanner.next(text, 0);
+        REQUIRE(match.has_value());
+        CHECK(match->offset == prefix);
+        CHECK(match->length == 5);
+        CHECK(scanner.findDelimiter(text, prefix + 1) == prefix + 4);
+        CHECK(scanner.findDelimiter(text, prefix + 5) == std::string::npos);
+    }
+}
+
+TEST_CASE("PlaceholderScanner: agrees with the regex implementation") {
+    const std::vector<std::pair<std::string, std::string>> configurations = {
+        {"@", R"(\@([A-Z0-9_]+)\@)"},
+        {"#", R"(\#([A-Z0-9_]+)\#)"},
+        {"%", R"(\%([A-Z0-9_]+)\%)"},
+        {"@#", R"(\@([A-Z0-9_]+)\@|\#([A-Z0-9_]+)\#)"},
+        {"@#%", R"(\@([A-Z0-9_]+)\@|\#([A-Z0-9_]+)\#|\%([A-Z0-9_]+)\%)"},
+    };
+
+    // Small alphabet so delimiters, body characters and breakers collide often
+    const std::string                  alphabet = "@#%AZ09_a -\n";
+    std::mt19937                       rng(1234);
+    std::uniform_int_distribution<int> pick(0, static_cast<int>(alphabet.size()) - 1);
+    std::uniform_int_distribution<int> length(0, 200);
+
+    for (const auto &[delimiters, pattern] : configurations) {
+        PlaceholderScanner scanner(delimiters);
+        for (int round = 0; round < 200; ++round) {
+            std::string text;
+            for (int i = length(rng); i > 0; --i) {
+                text += alphabet[static_cast<std::size_t>(pick(rng))];
+            }
+            CHECK(scanner_matches(text, scanner) == regex_matches(text, pattern));
+        }
+    }
+}
+
+TEST_CASE("PlaceholderProcessor: extraction is unchanged for every style") {
+    PlaceholderProcessor processor({PlaceholderStyle::AtSign, PlaceholderStyle::HashTag, PlaceholderStyle::Percent});
+
+    auto result = processor.extractPlaceholders("%ONE% #TWO# @THREE@ @ONE@ #nope# %%");
+    REQUIRE(result.size() == 3);
+    CHECK(result[0] == "ONE");
+    CHECK(result[1] == "TWO");
+    CHECK(result[2] == "THREE");
+}
@@ -0,0 +1,205 @@
+#include "cgen/server.h"
+#include "cgen/template_cache.h"
+
+#include <chrono>
+#include <doctest/doctest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace cgen;
+
+namespace {
+
+fs::path make_temp_dir(const std::string &name) {
+    fs::path path = fs::temp_directory_path() / name;
+    fs::remove_all(path);
+    fs::create_directories(path);
+    return path;
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+std::string read_file(const fs::path &path) {
+    std::ifstream     in(path);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+} // namespace
+
+TEST_CASE("Server: requests survive encoding") {
+    ServerRequest request;
+    request.template_name = "library_default";
+    request.output_dir    = "/tmp/dir with spaces/out";
+    request.incremental   = true;
+    request.io            = io_backend::io_uring;
+    request.values        = {{"PROJECT_NAME", "demo"}, {"DESCRIPTION", "two\nlines\r\nand a \\ backslash"}, {"EMPTY", ""}};
+
+    auto decoded = decode_request(encode_request(request));
+    REQUIRE(decoded.has_value());
+    CHECK(decoded->command == server_command::generate);
+    CHECK(decoded->template_name == request.template_name);
+    CHECK(decoded->output_dir == request.output_dir);
+    CHECK(decoded->incremental);
+    CHECK_FALSE(decoded->staging);
+    CHECK(decoded->io == io_backend::io_uring);
+    CHECK(decoded->values == request.values);
+
+    request.incremental = false;
+    request.staging     = true;
+    request.io.reset();
+    decoded = decode_request(encode_request(request));
+    REQUIRE(decoded.has_value());
+    CHECK(decoded->staging);
+    CHECK_FALSE(decoded->io.has_value());
+
+    ServerRequest ping;
+    ping.command = server_command::ping;
+    decoded      = decode_request(encode_request(ping));
+    REQUIRE(decoded.has_value());
+    CHECK(decoded->command == server_command::ping);
+
+    CHECK_FALSE(decode_request("").has_value());
+    CHECK_FALSE(decode_request("cgen-request 2\nping\nend\n").has_value());
+    CHECK_FALSE(decode_request("cgen-request 1\nexplode\nend\n").has_value());
+    CHECK_FALSE(decode_request("cgen-request 1\ngenerate tpl\noutput /tmp/out\n").has_value());
+}
+
+TEST_CASE("TemplateCache: templates are prepared once and dropped when they change") {
+    fs::path base = make_temp_dir("cgen_template_cache_test");
+    write_file(base / "tpl" / "README.md", "@PROJECT_NAME@\n");
+    write_file(base / "tpl" / "src" / "main.cpp", "int main() {}\n");
+
+    PlaceholderProcessor processor;
+    ThreadPool           pool(2);
+    TemplateCache        cache(base.string(), processor);
+
+    auto first = cache.get("tpl", pool);
+    REQUIRE(first.has_value());
+    CHECK(first.value()->files.size() == 2);
+    CHECK_FALSE(cache.get("missing", pool).has_value());
+
+#if defined(__linux__)
+    REQUIRE(cache.changeDescriptor() >= 0);
+    CHECK(cache.size() == 1);
+    auto second = cache.get("tpl", pool);
+    REQUIRE(second.has_value());
+    CHECK(second.value() == first.value());
+
+    // A change in a subdirectory invalidates the template
+    write_file(base / "tpl" / "src" / "util.cpp", "\n");
+    cache.processChanges();
+    CHECK(cache.size() == 0);
+
+    auto third = cache.get("tpl", pool);
+    REQUIRE(third.has_value());
+    CHECK(third.value()->files.size() == 3);
+#endif
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("TemplateCache: cached templates own their bytes") {
+    fs::path base = make_temp_dir("cgen_template_cache_resident_test");
+
+    // Large enough to be mapped outside the cache
+    std::string verbatim;
+    std::string templated;
+    while (verbatim.size() < 2 * FileSource::mmap_threshold) {
+        verbatim += "// plain line\n";
+        templated += "// line of @PROJECT_NAME@\n";
+    }
+    write_file(base / "tpl" / "verbatim.txt", verbatim);
+    write_file(base / "tpl" / "templated.txt", templated);
+
+    PlaceholderProcessor processor;
+    ThreadPool           pool(2);
+    TemplateCache        cache(base.string(), processor);
+    auto                 prepared = cache.get("tpl", pool);
+    REQUIRE(prepared.has_value());
+    CHECK(prepared.value()->resident);
+
+    // Truncated in place after preparation: a mapping of it would fault on the next render
+    std::ofstream(base / "tpl" / "verbatim.txt", std::ios::trunc).close();
+    std::ofstream(base / "tpl" / "templated.txt", std::ios::trunc).close();
+
+    fs::path output = base / "out";
+    fs::create_directories(output);
+    REQUIRE(generate_incremental(*prepared.value(), output, {{"PROJECT_NAME", "demo"}}, pool).has_value());
+    CHECK(read_file(output / "verbatim.txt") == verbatim);
+    CHECK(read_file(output / "templated.txt").starts_with("// line of demo\n"));
+
+    fs::remove_all(base);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST_CASE("Server: generates projects until shut down") {
+    fs::path base = make_temp_dir("cgen_server_test");
+    write_file(base / "templates" / "tpl" / "README.md", "# @PROJECT_NAME@\n");
+
+    PlaceholderProcessor processor;
+    ServeOptions         options;
+    options.socket_path        = base / "cgen.sock";
+    options.templates_base_dir = (base / "templates").string();
+    options.generate.jobs      = 2;
+
+    std::expected<void, generate_status> served;
+    std::thread                          server([&] { served = serve(options, processor); });
+
+    ServerRequest ping;
+    ping.command = server_command::ping;
+    bool ready   = false;
+    for (int attempt = 0; attempt < 200 && !ready; ++attempt) {
+        ready = fs::exists(options.socket_path) && send_request(options.socket_path, ping).has_value();
+        if (!ready) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    REQUIRE(ready);
+    CHECK((fs::status(options.socket_path).permissions() & fs::perms::all) == (fs::perms::owner_read | fs::perms::owner_write));
+
+    ServerRequest request;
+    request.template_name = "tpl";
+    request.output_dir    = base / "out";
+    request.values        = {{"PROJECT_NAME", "demo"}};
+    CHECK(send_request(options.socket_path, request).has_value());
+    CHECK(read_file(base / "out" / "README.md") == "# demo\n");
+
+    // The server notices the template changed
+    write_file(base / "templates" / "tpl" / "README.md", "# @PROJECT_NAME@, again\n");
+    CHECK(send_request(options.socket_path, request).has_value());
+    CHECK(read_file(base / "out" / "README.md") == "# demo, again\n");
+
+    ServerRequest staged = request;
+    staged.output_dir    = base / "staged";
+    staged.staging       = true;
+    CHECK(send_request(options.socket_path, staged).has_value());
+    CHECK(send_request(options.socket_path, staged).has_value()); // Replaces its own output
+    CHECK(read_file(base / "staged" / "README.md") == "# demo, again\n");
+    CHECK(fs::exists(base / "staged" / ".cgen-manifest"));
+    staged.incremental = true;
+    CHECK_FALSE(send_request(options.socket_path, staged).has_value());
+
+    ServerRequest relative = request;
+    relative.output_dir    = "out";
+    CHECK_FALSE(send_request(options.socket_path, relative).has_value());
+    ServerRequest escaping = request;
+    escaping.template_name = "../templates";
+    CHECK_FALSE(send_request(options.socket_path, escaping).has_value());
+
+    ServerRequest shutdown;
+    shutdown.command = server_command::shutdown;
+    CHECK(send_request(options.socket_path, shutdown).has_value());
+    server.join();
+    CHECK(served.has_value());
+    CHECK_FALSE(fs::exists(options.socket_path));
+
+    fs::remove_all(base);
+}
+#endif
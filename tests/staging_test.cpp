@@ -0,0 +1,152 @@
+#include "cgen/generation_manifest.h"
+#include "cgen/generator.h"
+#include "cgen/staging.h"
+
+#include <doctest/doctest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace cgen;
+
+namespace {
+
+fs::path make_temp_dir(const std::string &name) {
+    fs::path path = fs::temp_directory_path() / name;
+    fs::remove_all(path);
+    fs::create_directories(path);
+    return path;
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+std::string read_file(const fs::path &path) {
+    std::ifstream     in(path);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+// Entries of `dir` itself, to find staging directories left behind
+std::size_t entry_count(const fs::path &dir) {
+    std::size_t count = 0;
+    for ([[maybe_unused]] const auto &entry : fs::directory_iterator(dir)) {
+        ++count;
+    }
+    return count;
+}
+
+} // namespace
+
+TEST_CASE("generate_staged: the output is replaced as a whole") {
+    fs::path base = make_temp_dir("cgen_staging_test");
+    fs::path tpl  = base / "templates" / "tpl";
+    fs::path out  = base / "out";
+    write_file(tpl / "CMakeLists.txt", "project(@PROJECT_NAME@)\n");
+    write_file(tpl / "src" / "main.cpp", "int main() {}\n");
+
+    auto scanned = scan_template_directory("tpl", (base / "templates").string(), flat_tree);
+    REQUIRE(scanned.has_value());
+
+    PlaceholderProcessor                         processor;
+    std::unordered_map<std::string, std::string> values = {{"PROJECT_NAME", "demo"}};
+    GenerateOptions                              options;
+    options.staging = true;
+
+    // A fresh output is created by the rename
+    REQUIRE(generate_project(scanned.value(), out, processor, values, options).has_value());
+    CHECK(read_file(out / "CMakeLists.txt") == "project(demo)\n");
+    CHECK(read_file(out / "src" / "main.cpp") == "int main() {}\n");
+    CHECK(GenerationManifest::load(out).size() == 2);
+    CHECK(entry_count(base) == 2); // templates and out
+
+    // Regenerating swaps in a new tree: files that are no longer generated disappear
+    fs::remove(tpl / "src" / "main.cpp");
+    scanned = scan_template_directory("tpl", (base / "templates").string(), flat_tree);
+    REQUIRE(scanned.has_value());
+    values["PROJECT_NAME"] = "renamed";
+    REQUIRE(generate_project(scanned.value(), out, processor, values, options).has_value());
+    CHECK(read_file(out / "CMakeLists.txt") == "project(renamed)\n");
+    CHECK_FALSE(fs::exists(out / "src" / "main.cpp"));
+    CHECK(GenerationManifest::load(out).size() == 1);
+    CHECK(entry_count(base) == 2);
+
+    // An empty directory may be replaced too
+    fs::remove_all(out);
+    fs::create_directories(out);
+    REQUIRE(generate_project(scanned.value(), out, processor, values, options).has_value());
+    CHECK(read_file(out / "CMakeLists.txt") == "project(renamed)\n");
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("generate_staged: a directory cgen did not generate is left alone") {
+    fs::path base = make_temp_dir("cgen_staging_refuse_test");
+    fs::path tpl  = base / "templates" / "tpl";
+    fs::path out  = base / "out";
+    write_file(tpl / "README", "@PROJECT_NAME@\n");
+    write_file(out / "notes.txt", "mine\n");
+
+    auto scanned = scan_template_directory("tpl", (base / "templates").string(), flat_tree);
+    REQUIRE(scanned.has_value());
+
+    PlaceholderProcessor processor;
+    GenerateOptions      options;
+    options.staging = true;
+
+    auto generated = generate_project(scanned.value(), out, processor, {{"PROJECT_NAME", "demo"}}, options);
+    CHECK_FALSE(generated.has_value());
+    CHECK(read_file(out / "notes.txt") == "mine\n");
+    CHECK_FALSE(fs::exists(out / "README"));
+    CHECK(entry_count(base) == 2);
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("generate_staged: files the manifest does not list are never deleted") {
+    fs::path base = make_temp_dir("cgen_staging_unlisted_test");
+    fs::path tpl  = base / "templates" / "tpl";
+    fs::path out  = base / "out";
+    write_file(tpl / "CMakeLists.txt", "project(@PROJECT_NAME@)\n");
+    write_file(tpl / "src" / "main.cpp", "int main() {}\n");
+    fs::create_directories(tpl / "empty");
+
+    auto scanned = scan_template_directory("tpl", (base / "templates").string(), flat_tree);
+    REQUIRE(scanned.has_value());
+
+    PlaceholderProcessor                         processor;
+    std::unordered_map<std::string, std::string> values = {{"PROJECT_NAME", "demo"}};
+    GenerateOptions                              options;
+    options.staging = true;
+    REQUIRE(generate_project(scanned.value(), out, processor, values, options).has_value());
+
+    // Generated files and directories, even empty ones, are all accounted for
+    values["PROJECT_NAME"] = "renamed";
+    REQUIRE(generate_project(scanned.value(), out, processor, values, options).has_value());
+    CHECK(read_file(out / "CMakeLists.txt") == "project(renamed)\n");
+
+    // A file added next to the generated ones, e.g. version control or a build tree
+    write_file(out / ".git" / "HEAD", "ref: refs/heads/main\n");
+    CHECK_FALSE(generate_project(scanned.value(), out, processor, values, options).has_value());
+    CHECK(read_file(out / ".git" / "HEAD") == "ref: refs/heads/main\n");
+    CHECK(read_file(out / "CMakeLists.txt") == "project(renamed)\n");
+    CHECK(entry_count(base) == 2);
+    fs::remove_all(out / ".git");
+
+    // A generated file edited by hand
+    write_file(out / "src" / "main.cpp", "int main() { return 1; }\n");
+    CHECK_FALSE(generate_project(scanned.value(), out, processor, values, options).has_value());
+    CHECK(read_file(out / "src" / "main.cpp") == "int main() { return 1; }\n");
+    CHECK(entry_count(base) == 2);
+
+    // Restoring the generated contents makes the output replaceable again, whatever its mtime
+    write_file(out / "src" / "main.cpp", "int main() {}\n");
+    REQUIRE(generate_project(scanned.value(), out, processor, values, options).has_value());
+    CHECK(read_file(out / "src" / "main.cpp") == "int main() {}\n");
+    CHECK(fs::is_directory(out / "empty"));
+
+    fs::remove_all(base);
+}
@@ -0,0 +1,74 @@
+#include "cgen/generator.h"
+#include "cgen/stats.h"
+
+#include <doctest/doctest.h>
+#include <fstream>
+#include <string>
+
+using namespace cgen;
+
+namespace {
+
+fs::path make_temp_dir(const std::string &name) {
+    fs::path path = fs::temp_directory_path() / name;
+    fs::remove_all(path);
+    fs::create_directories(path);
+    return path;
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+} // namespace
+
+TEST_CASE("Statistics: generation is counted and timed while enabled") {
+    fs::path base = make_temp_dir("cgen_stats_test");
+    write_file(base / "templates" / "tpl" / "README.md", "# @PROJECT_NAME@ by @AUTHOR_NAME@, @PROJECT_NAME@\n");
+    write_file(base / "templates" / "tpl" / "src" / "main.cpp", "int main() {}\n");
+
+    PlaceholderProcessor                         processor;
+    std::unordered_map<std::string, std::string> values = {{"PROJECT_NAME", "demo"}};
+    Statistics                                  &stats  = statistics();
+
+    auto generate = [&] {
+        auto tree_or = scan_template_directory("tpl", (base / "templates").string(), flat_tree);
+        REQUIRE(tree_or.has_value());
+        REQUIRE(generate_project(tree_or.value(), base / "out", processor, values).has_value());
+    };
+    fs::create_directories(base / "out");
+
+    // Off by default: nothing is recorded
+    stats.reset();
+    generate();
+    CHECK(stats.count(stats_counter::files_written) == 0);
+    CHECK(stats.time(stats_phase::generate).count() == 0);
+
+    stats.enable();
+    generate();
+    stats.enable(false);
+
+    CHECK(stats.count(stats_counter::directories_scanned) == 2);
+    CHECK(stats.count(stats_counter::files_scanned) == 2);
+    CHECK(stats.count(stats_counter::files_read) == 2);
+    CHECK(stats.count(stats_counter::bytes_read) == 50 + 14);
+    CHECK(stats.count(stats_counter::placeholders_matched) == 3);
+    CHECK(stats.count(stats_counter::placeholders_substituted) == 2); // AUTHOR_NAME has no value
+    CHECK(stats.count(stats_counter::files_written) == 2);
+    CHECK(stats.count(stats_counter::bytes_written) == 30 + 14);
+    CHECK(stats.time(stats_phase::scan).count() > 0);
+    CHECK(stats.time(stats_phase::generate).count() > 0);
+    CHECK(stats.time(stats_phase::render).count() > 0); // README.md has a value to substitute
+    CHECK(stats.time(stats_phase::write).count() > 0);
+
+    std::string json = format_stats(stats, std::chrono::milliseconds(5), stats_format::json);
+    CHECK(json.starts_with("{\"wall_ms\": 5.000, \"phases_ms\": {\"scan\": "));
+    CHECK(json.find("\"files_written\": 2") != std::string::npos);
+    CHECK(json.find("\"write\": ") != std::string::npos);
+    CHECK(format_stats(stats, std::chrono::milliseconds(5), stats_format::text).find("files_written") != std::string::npos);
+
+    stats.reset();
+    CHECK(stats.count(stats_counter::files_written) == 0);
+    fs::remove_all(base);
+}
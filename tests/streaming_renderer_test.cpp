@@ -0,0 +1,135 @@
+#include "cgen/streaming_renderer.h"
+
+#include <doctest/doctest.h>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace cgen;
+
+namespace {
+
+// Feed `text` in chunks of `chunk_size` bytes and collect the output
+std::string render_chunked(const PlaceholderProcessor &processor, std::string_view text,
+                           const std::unordered_map<std::string, std::string> &values, std::size_t chunk_size) {
+    std::string       output;
+    StreamingRenderer renderer(processor, values, [&output](std::string_view piece) { output.append(piece); });
+    for (std::size_t pos = 0; pos < text.size(); pos += chunk_size) {
+        renderer.write(text.substr(pos, chunk_size));
+    }
+    renderer.finish();
+    return output;
+}
+
+fs::path make_temp_dir(const std::string &name) {
+    fs::path path = fs::temp_directory_path() / name;
+    fs::remove_all(path);
+    fs::create_directories(path);
+    return path;
+}
+
+} // namespace
+
+TEST_CASE("StreamingRenderer: placeholders straddling chunk boundaries") {
+    PlaceholderProcessor                         processor;
+    std::unordered_map<std::string, std::string> values = {{"PROJECT_NAME", "demo"}, {"A", "alpha"}};
+    std::string                                  text   = "project(@PROJECT_NAME@) @A@@A@ @UNBOUND@ @lower@ tail@PROJ";
+
+    std::string expected = processor.replacePlaceholders(text, values);
+    CHECK(expected == "project(demo) alphaalpha @UNBOUND@ @lower@ tail@PROJ");
+    for (std::size_t chunk_size = 1; chunk_size <= text.size(); ++chunk_size) {
+        CAPTURE(chunk_size);
+        CHECK(render_chunked(processor, text, values, chunk_size) == expected);
+    }
+}
+
+TEST_CASE("StreamingRenderer: matches the in-memory engine on random input") {
+    PlaceholderProcessor                         processor({PlaceholderStyle::AtSign, PlaceholderStyle::HashTag});
+    std::unordered_map<std::string, std::string> values = {{"A", "1"}, {"AB", ""}, {"B_2", "a much longer value"}, {"X", "@A@"}};
+
+    std::mt19937      rng(1234);
+    const std::string alphabet = "@#AB_2Xx \n";
+    for (int round = 0; round < 50; ++round) {
+        std::string text;
+        for (int i = 0; i < 400; ++i) {
+            text += alphabet[rng() % alphabet.size()];
+        }
+        std::string expected = processor.replacePlaceholders(text, values);
+        for (std::size_t chunk_size : {1, 2, 3, 5, 7, 13, 64, 1000}) {
+            CAPTURE(round);
+            CAPTURE(chunk_size);
+            CHECK(render_chunked(processor, text, values, chunk_size) == expected);
+        }
+    }
+}
+
+TEST_CASE("StreamingRenderer: overlong unfinished tokens are not held back") {
+    PlaceholderProcessor                         processor;
+    std::unordered_map<std::string, std::string> no_values;
+    std::string                                  text = "@" + std::string(StreamingRenderer::max_token_length * 2, 'A') + " done";
+
+    std::size_t largest_piece = 0;
+    std::string output;
+    {
+        StreamingRenderer renderer(processor, no_values, [&](std::string_view piece) {
+            largest_piece = std::max(largest_piece, piece.size());
+            output.append(piece);
+        });
+        for (char c : text) {
+            renderer.write(std::string_view(&c, 1));
+        }
+        renderer.finish();
+    }
+    CHECK(output == text);
+    CHECK(largest_piece <= StreamingRenderer::max_token_length);
+}
+
+TEST_CASE("render_stream: istream to sink") {
+    PlaceholderProcessor processor;
+    std::istringstream   in("name=@NAME@\nversion=@VERSION@\n");
+    std::string          output;
+
+    auto result = render_stream(processor, in, {{"NAME", "cgen"}, {"VERSION", "1.0"}},
+                                [&output](std::string_view piece) { output.append(piece); }, 4);
+    REQUIRE(result.has_value());
+    CHECK(output == "name=cgen\nversion=1.0\n");
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST_CASE("render_stream: file descriptor to file descriptor") {
+    fs::path dir = make_temp_dir("cgen_streaming_fd_test");
+
+    std::string input;
+    for (int i = 0; i < 20000; ++i) {
+        input += "INSERT INTO @TABLE@ VALUES (" + std::to_string(i) + ", '@OWNER@');\n";
+    }
+    std::ofstream(dir / "seed.sql.in", std::ios::binary) << input;
+
+    std::unordered_map<std::string, std::string> values = {{"TABLE", "users"}, {"OWNER", "cgen"}};
+    PlaceholderProcessor                         processor;
+
+    int in_fd  = ::open((dir / "seed.sql.in").c_str(), O_RDONLY);
+    int out_fd = ::open((dir / "seed.sql").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    REQUIRE(in_fd >= 0);
+    REQUIRE(out_fd >= 0);
+    auto result = render_stream(processor, in_fd, out_fd, values, 4096);
+    ::close(in_fd);
+    ::close(out_fd);
+    REQUIRE(result.has_value());
+
+    std::ifstream     out(dir / "seed.sql", std::ios::binary);
+    std::stringstream buffer;
+    buffer << out.rdbuf();
+    CHECK(buffer.str() == processor.replacePlaceholders(input, values));
+
+    CHECK_FALSE(render_stream(processor, -1, -1, values).has_value());
+
+    fs::remove_all(dir);
+}
+#endif
@@ -0,0 +1,80 @@
+#include "cgen/placeholder_processor.h"
+#include "cgen/symbol_table.h"
+
+#include <doctest/doctest.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace cgen;
+
+TEST_CASE("SymbolTable: names get dense ids that never change") {
+    SymbolTable table;
+    CHECK(table.intern("PROJECT_NAME") == 0);
+    CHECK(table.intern("PROJECT_VERSION") == 1);
+    CHECK(table.intern("PROJECT_NAME") == 0);
+    CHECK(table.size() == 2);
+    CHECK(table.name(1) == "PROJECT_VERSION");
+    CHECK(table.find("PROJECT_VERSION") == 1u);
+    CHECK_FALSE(table.find("MISSING").has_value());
+
+    // Many threads interning overlapping names agree on every id
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&table] {
+            for (int i = 0; i < 200; ++i) {
+                table.intern("NAME_" + std::to_string(i));
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    CHECK(table.size() == 202);
+    for (int i = 0; i < 200; ++i) {
+        std::uint32_t id = table.intern("NAME_" + std::to_string(i));
+        CHECK(table.name(id) == "NAME_" + std::to_string(i));
+    }
+}
+
+TEST_CASE("SymbolTable: bind keeps only interned names and tells empty values from missing ones") {
+    SymbolTable   table;
+    std::uint32_t name  = table.intern("PROJECT_NAME");
+    std::uint32_t empty = table.intern("EMPTY");
+    std::uint32_t unset = table.intern("UNSET");
+
+    std::unordered_map<std::string, std::string> values = {{"PROJECT_NAME", "demo"}, {"EMPTY", ""}, {"UNUSED", "x"}};
+    SymbolValues                                 bound  = table.bind(values);
+    CHECK(bound.get(name) == "demo");
+    CHECK(bound.contains(empty));
+    CHECK(bound.get(empty).empty());
+    CHECK_FALSE(bound.contains(unset));
+
+    std::uint32_t later = table.intern("UNUSED"); // Interned after binding
+    CHECK_FALSE(bound.contains(later));
+    CHECK(table.bind(values).get(later) == "x");
+}
+
+TEST_CASE("CompiledTemplate: rendering with bound values matches rendering with the map") {
+    PlaceholderProcessor processor;
+    auto                 compiled = processor.compile("project(@PROJECT_NAME@) @UNSET@\n"
+                                                      "@each DEP in DEPS@find_package(@DEP@)\n@endeach@"
+                                                      "@if TESTS@enable_testing()\n@endif@");
+    auto                 plain    = processor.compile("no placeholders\n");
+
+    // Both templates share the processor's table, so one binding serves both
+    REQUIRE(compiled.symbols().size() == compiled.slots().size());
+    CHECK(processor.symbols()->name(compiled.symbols()[0]) == "PROJECT_NAME");
+
+    std::unordered_map<std::string, std::string> values = {{"PROJECT_NAME", "demo"}, {"DEPS", "fmt;doctest"}, {"TESTS", "ON"}};
+    SymbolValues                                 bound  = processor.symbols()->bind(values);
+    CHECK(compiled.render(bound) == compiled.render(values));
+    CHECK(compiled.render(bound) == "project(demo) @UNSET@\nfind_package(fmt)\nfind_package(doctest)\nenable_testing()\n");
+    CHECK_FALSE(compiled.rendersVerbatim(bound));
+    CHECK(plain.rendersVerbatim(bound));
+
+    std::string streamed;
+    compiled.render(bound, [&streamed](std::string_view piece) { streamed.append(piece); });
+    CHECK(streamed == compiled.render(values));
+}
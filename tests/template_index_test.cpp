@@ -0,0 +1,144 @@
+#include "cgen/template_index.h"
+
+#include <doctest/doctest.h>
+#include <fmt/format.h>
+#include <fstream>
+#include <string>
+
+using namespace cgen;
+
+namespace {
+
+fs::path make_temp_dir(const std::string &name) {
+    fs::path path = fs::temp_directory_path() / name;
+    fs::remove_all(path);
+    fs::create_directories(path);
+    return path;
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+// Structural comparison of two scanned trees
+bool same_tree(const std::set<std::shared_ptr<Directory>, CompareDirectoryByName<Directory>> &lhs,
+               const std::set<std::shared_ptr<Directory>, CompareDirectoryByName<Directory>> &rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (auto l = lhs.begin(), r = rhs.begin(); l != lhs.end(); ++l, ++r) {
+        if ((*l)->name != (*r)->name || (*l)->path != (*r)->path || (*l)->files != (*r)->files ||
+            !same_tree((*l)->directories, (*r)->directories)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+TEST_CASE("TemplateIndex: matches scan_template_directory") {
+    fs::path base = make_temp_dir("cgen_index_tree_test");
+    write_file(base / "tpl" / "CMakeLists.txt", "project(@PROJECT_NAME@)");
+    write_file(base / "tpl" / "src" / "main.cpp", "// @PROJECT_NAME@ @AUTHOR_NAME@");
+    write_file(base / "tpl" / "src" / "detail" / "with space.h", "plain");
+    fs::create_directories(base / "tpl" / "empty");
+
+    auto index = TemplateIndex::open("tpl", base.string());
+    REQUIRE(index.has_value());
+    CHECK(fs::exists(TemplateIndex::indexPath(base.string())));
+
+    auto scanned = scan_template_directory("tpl", base.string());
+    REQUIRE(scanned.has_value());
+    CHECK(same_tree(index->directories(), scanned.value()));
+
+    const IndexedFile *main_cpp = index->findFile("src/main.cpp");
+    REQUIRE(main_cpp != nullptr);
+    CHECK(main_cpp->name == "main.cpp");
+    CHECK(main_cpp->stamp.size == fs::file_size(base / "tpl" / "src" / "main.cpp"));
+
+    CHECK(index->findFile("src/detail/with space.h") != nullptr);
+    CHECK(index->findFile("src/missing.cpp") == nullptr);
+    CHECK(index->findFile("missing/main.cpp") == nullptr);
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("TemplateIndex: reuses unchanged entries and refreshes changed ones") {
+    fs::path base = make_temp_dir("cgen_index_refresh_test");
+    write_file(base / "tpl" / "README.md", "# @PROJECT_NAME@");
+    write_file(base / "tpl" / "src" / "main.cpp", "int main() {}");
+
+    REQUIRE(TemplateIndex::open("tpl", base.string()).has_value());
+
+    // Nothing changed: no directory is listed again and every stamp is reused
+    auto unchanged = TemplateIndex::open("tpl", base.string());
+    REQUIRE(unchanged.has_value());
+    CHECK(unchanged->refreshedDirectories() == 0);
+    CHECK(unchanged->refreshedFiles() == 0);
+    REQUIRE(unchanged->findFile("README.md") != nullptr);
+
+    // An edited file gets a new stamp, its directory is not listed again
+    write_file(base / "tpl" / "src" / "main.cpp", "// @APP_NAME@\nint main() {}");
+    auto edited = TemplateIndex::open("tpl", base.string());
+    REQUIRE(edited.has_value());
+    CHECK(edited->refreshedDirectories() == 0);
+    CHECK(edited->refreshedFiles() == 1);
+    CHECK(edited->findFile("src/main.cpp")->stamp.size == fs::file_size(base / "tpl" / "src" / "main.cpp"));
+
+    // A new file changes its directory's mtime, only that directory is listed again
+    write_file(base / "tpl" / "src" / "extra.cpp", "// @EXTRA@");
+    auto added = TemplateIndex::open("tpl", base.string());
+    REQUIRE(added.has_value());
+    CHECK(added->refreshedDirectories() == 1);
+    CHECK(added->refreshedFiles() == 1);
+    CHECK(added->findFile("src/extra.cpp") != nullptr);
+
+    // Removing a file drops it from the index
+    fs::remove(base / "tpl" / "README.md");
+    auto removed = TemplateIndex::open("tpl", base.string());
+    REQUIRE(removed.has_value());
+    CHECK(removed->findFile("README.md") == nullptr);
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("TemplateIndex: a relisted directory keeps the cached entries of its other children") {
+    fs::path base = make_temp_dir("cgen_index_relist_test");
+    for (int i = 0; i < 200; ++i) {
+        write_file(base / "tpl" / fmt::format("file{:03}.txt", i), "");
+        write_file(base / "tpl" / fmt::format("dir{:03}", i) / "leaf.txt", "");
+    }
+    REQUIRE(TemplateIndex::open("tpl", base.string()).has_value());
+
+    // Only the root is listed again; every other file and subdirectory is matched to its cached entry
+    write_file(base / "tpl" / "file100b.txt", "");
+    auto relisted = TemplateIndex::open("tpl", base.string());
+    REQUIRE(relisted.has_value());
+    CHECK(relisted->refreshedDirectories() == 1);
+    CHECK(relisted->refreshedFiles() == 1);
+    CHECK(relisted->root().files.size() == 201);
+    CHECK(relisted->findFile("dir150/leaf.txt") != nullptr);
+    CHECK(relisted->findFile("file100b.txt") != nullptr);
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("TemplateIndex: one index file serves several templates") {
+    fs::path base = make_temp_dir("cgen_index_multi_test");
+    write_file(base / "one" / "a.txt", "@A@");
+    write_file(base / "two" / "b.txt", "@B@");
+
+    REQUIRE(TemplateIndex::open("one", base.string()).has_value());
+    REQUIRE(TemplateIndex::open("two", base.string()).has_value());
+
+    auto one = TemplateIndex::open("one", base.string());
+    REQUIRE(one.has_value());
+    CHECK(one->refreshedDirectories() == 0);
+    CHECK(one->findFile("a.txt") != nullptr);
+
+    CHECK_FALSE(TemplateIndex::open("missing", base.string()).has_value());
+
+    fs::remove_all(base);
+}
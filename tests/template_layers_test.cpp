@@ -0,0 +1,119 @@
+#include "cgen/generator.h"
+#include "cgen/template_layers.h"
+
+#include <doctest/doctest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace cgen;
+
+namespace {
+
+fs::path make_temp_dir(const std::string &name) {
+    fs::path path = fs::temp_directory_path() / name;
+    fs::remove_all(path);
+    fs::create_directories(path);
+    return path;
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+std::string read_file(const fs::path &path) {
+    std::ifstream     in(path);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+// Every file of a tree as "<relative> <layer>", in tree order
+std::vector<std::string> layered_files(const DirectoryTree &tree) {
+    std::vector<std::string> entries;
+    for (std::size_t i = 0; i < tree.nodes().size(); ++i) {
+        const auto &node = tree.nodes()[i];
+        for (std::size_t f = node.first_file; f < node.first_file + node.file_count; ++f) {
+            fs::path relative = tree.relativePath(i) / tree.name(tree.files()[f]);
+            entries.push_back(relative.generic_string() + " " + std::to_string(tree.fileLayer(f)));
+        }
+    }
+    return entries;
+}
+
+} // namespace
+
+TEST_CASE("compose_layers: earlier layers win and directories are merged") {
+    fs::path base = make_temp_dir("cgen_compose_layers_test");
+    write_file(base / "tpl" / "CMakeLists.txt", "template\n");
+    write_file(base / "tpl" / "src" / "main.cpp", "template\n");
+    write_file(base / "tpl" / "docs", "a file where the overlay has a directory\n");
+    write_file(base / "overlay" / "CMakeLists.txt", "overlay\n");
+    write_file(base / "overlay" / "get_cpm.cmake", "overlay\n");
+    write_file(base / "overlay" / "src" / "extra.cpp", "overlay\n");
+    write_file(base / "overlay" / "docs" / "index.md", "overlay\n");
+    write_file(base / "common" / "src" / "main.cpp", "common\n");
+    write_file(base / "common" / "tests" / "test.cpp", "common\n");
+
+    std::vector<DirectoryTree> layers;
+    for (const char *name : {"tpl", "overlay", "common"}) {
+        auto scanned = scan_template_directory(name, base.string(), flat_tree);
+        REQUIRE(scanned.has_value());
+        layers.push_back(std::move(scanned.value()));
+    }
+
+    DirectoryTree composed = compose_layers(layers);
+    CHECK(composed.rootPath() == layers[0].rootPath());
+    REQUIRE(composed.layerCount() == 3);
+    CHECK(composed.layerRoot(1) == layers[1].rootPath());
+    CHECK(composed.layerRoot(2) == layers[2].rootPath());
+    CHECK(layered_files(composed) == std::vector<std::string>{"CMakeLists.txt 0", "docs 0", "get_cpm.cmake 1", "src/extra.cpp 1",
+                                                              "src/main.cpp 0", "tests/test.cpp 2"});
+
+    REQUIRE(composed.nodes().size() == 3);
+    CHECK(composed.nodeLayers(0) == 0b111);
+    CHECK(composed.name(composed.nodes()[1].name) == "src");
+    CHECK(composed.nodeLayers(1) == 0b111);
+    CHECK(composed.nodeLayers(2) == 0b100); // tests
+
+    fs::remove_all(base);
+}
+
+TEST_CASE("load_template_tree: _common and overlays are generated once, under the template") {
+    fs::path base = make_temp_dir("cgen_template_layers_test");
+    fs::path out  = base / "out";
+    write_file(base / "templates" / "tpl" / "CMakeLists.txt", "project(@PROJECT_NAME@)\n");
+    write_file(base / "templates" / "tpl" / "README.md", "# @PROJECT_NAME@ from the template\n");
+    write_file(base / "templates" / "_common" / "README.md", "# @PROJECT_NAME@ from _common\n");
+    write_file(base / "templates" / "_common" / ".clang-format", "BasedOnStyle: LLVM\n");
+    write_file(base / "templates" / "_package_managers" / "cpm" / "cmake" / "get_cpm.cmake", "# CPM for @PROJECT_NAME@\n");
+
+    PlaceholderProcessor                         processor;
+    std::unordered_map<std::string, std::string> values = {{"PROJECT_NAME", "demo"}};
+    GenerateOptions                              options;
+    options.overlays = {"_package_managers/cpm"};
+
+    auto tree_or = load_template_tree("tpl", (base / "templates").string(), options);
+    REQUIRE(tree_or.has_value());
+    CHECK(layered_files(tree_or.value()) ==
+          std::vector<std::string>{".clang-format 2", "CMakeLists.txt 0", "README.md 0", "cmake/get_cpm.cmake 1"});
+
+    fs::create_directories(out);
+    REQUIRE(generate_project(tree_or.value(), out, processor, values, options).has_value());
+    CHECK(read_file(out / "README.md") == "# demo from the template\n");
+    CHECK(read_file(out / ".clang-format") == "BasedOnStyle: LLVM\n");
+    CHECK(read_file(out / "cmake" / "get_cpm.cmake") == "# CPM for demo\n");
+
+    // Without _common, and with an overlay that does not exist
+    options.common_layer = false;
+    auto plain_or        = load_template_tree("tpl", (base / "templates").string(), options);
+    REQUIRE(plain_or.has_value());
+    CHECK(layered_files(plain_or.value()) == std::vector<std::string>{"CMakeLists.txt 0", "README.md 0", "cmake/get_cpm.cmake 1"});
+
+    options.overlays = {"missing"};
+    CHECK_FALSE(load_template_tree("tpl", (base / "templates").string(), options).has_value());
+
+    fs::remove_all(base);
+}
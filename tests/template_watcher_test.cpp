@@ -0,0 +1,89 @@
+#include "cgen/template_watcher.h"
+
+#include <chrono>
+#include <doctest/doctest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace cgen;
+
+namespace {
+
+fs::path make_temp_dir(const std::string &name) {
+    fs::path path = fs::temp_directory_path() / name;
+    fs::remove_all(path);
+    fs::create_directories(path);
+    return path;
+}
+
+void write_file(const fs::path &path, const std::string &content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+std::string read_file(const fs::path &path) {
+    std::ifstream     in(path);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+const fs::file_time_type yesterday = fs::file_time_type::clock::now() - std::chrono::hours(24);
+
+} // namespace
+
+#if defined(__linux__)
+TEST_CASE("TemplateWatcher: re-renders only what changed") {
+    fs::path base = make_temp_dir("cgen_watcher_test");
+    fs::path tpl  = base / "templates" / "tpl";
+    fs::path out  = base / "out";
+    write_file(tpl / "README.md", "# @PROJECT_NAME@\n");
+    write_file(tpl / "src" / "main.cpp", "int main() {}\n");
+    fs::create_directories(out);
+
+    PlaceholderProcessor processor;
+    GenerateOptions      options;
+    options.jobs = 2;
+    TemplateWatcher watcher("tpl", (base / "templates").string(), out, {{"PROJECT_NAME", "demo"}}, processor, options);
+    REQUIRE(watcher.start().has_value());
+    CHECK(read_file(out / "README.md") == "# demo\n");
+    CHECK(watcher.processChanges() == std::size_t{0});
+
+    fs::last_write_time(out / "README.md", yesterday);
+    fs::last_write_time(out / "src" / "main.cpp", yesterday);
+
+    // A file written in place
+    write_file(tpl / "src" / "main.cpp", "int main() { return 0; }\n");
+    CHECK(watcher.processChanges() == std::size_t{1});
+    CHECK(read_file(out / "src" / "main.cpp") == "int main() { return 0; }\n");
+    CHECK(fs::last_write_time(out / "README.md") == yesterday);
+
+    // A file replaced by renaming a temporary file over it, as many editors save
+    write_file(tpl / ".README.md.tmp", "# @PROJECT_NAME@ v2\n");
+    fs::rename(tpl / ".README.md.tmp", tpl / "README.md");
+    CHECK(watcher.processChanges() == std::size_t{1});
+    CHECK(read_file(out / "README.md") == "# demo v2\n");
+
+    // New files and directories are picked up, unchanged outputs are left alone
+    fs::last_write_time(out / "README.md", yesterday);
+    write_file(tpl / "include" / "@PROJECT_NAME@.h", "#pragma once\n");
+    CHECK(watcher.processChanges() == std::size_t{3});
+    CHECK(read_file(out / "include" / "demo.h") == "#pragma once\n");
+    CHECK(fs::last_write_time(out / "README.md") == yesterday);
+
+    // ... and watched from then on
+    write_file(tpl / "include" / "@PROJECT_NAME@.h", "#pragma once\nnamespace @PROJECT_NAME@ {}\n");
+    CHECK(watcher.processChanges() == std::size_t{1});
+    CHECK(read_file(out / "include" / "demo.h") == "#pragma once\nnamespace demo {}\n");
+
+    // A deleted template file is no longer rendered
+    fs::remove(tpl / "src" / "main.cpp");
+    CHECK(watcher.processChanges() == std::size_t{2});
+    write_file(tpl / "README.md", "# @PROJECT_NAME@ v3\n");
+    CHECK(watcher.processChanges() == std::size_t{1});
+    CHECK(read_file(out / "README.md") == "# demo v3\n");
+
+    fs::remove_all(base);
+}
+#endif
@@ -0,0 +1,77 @@
+#include "cgen/thread_pool.h"
+
+#include <atomic>
+#include <doctest/doctest.h>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+using namespace cgen;
+
+TEST_CASE("ThreadPool: runs every submitted task") {
+    ThreadPool pool(4);
+    CHECK(pool.size() == 4);
+
+    std::vector<int> slots(1000, 0);
+    for (std::size_t i = 0; i < slots.size(); ++i) {
+        pool.submit([&slots, i] { slots[i] = static_cast<int>(i); });
+    }
+    pool.wait();
+
+    for (std::size_t i = 0; i < slots.size(); ++i) {
+        CHECK(slots[i] == static_cast<int>(i));
+    }
+}
+
+TEST_CASE("ThreadPool: tasks may submit more tasks") {
+    ThreadPool       pool(3);
+    std::atomic<int> counter = 0;
+
+    for (int i = 0; i < 10; ++i) {
+        pool.submit([&pool, &counter] {
+            for (int j = 0; j < 10; ++j) {
+                pool.submit([&counter] { ++counter; });
+            }
+        });
+    }
+    pool.wait();
+    CHECK(counter == 100);
+
+    // The pool is reusable after wait()
+    pool.submit([&counter] { ++counter; });
+    pool.wait();
+    CHECK(counter == 101);
+}
+
+TEST_CASE("ThreadPool: wait covers nested submits under contention") {
+    ThreadPool pool(4);
+
+    // Every round builds a small task tree where children are likely to be stolen and finished
+    // before their parent returns, wait() must still only return once the whole tree is done
+    for (int round = 0; round < 200; ++round) {
+        std::atomic<int>         counter = 0;
+        std::function<void(int)> spawn;
+        spawn = [&](int depth) {
+            ++counter;
+            if (depth == 0) {
+                return;
+            }
+            for (int i = 0; i < 4; ++i) {
+                pool.submit([&spawn, depth] { spawn(depth - 1); });
+            }
+        };
+        pool.submit([&spawn] { spawn(3); });
+        pool.wait();
+        REQUIRE(counter == 1 + 4 + 16 + 64);
+    }
+}
+
+TEST_CASE("ThreadPool: wait rethrows task exceptions") {
+    ThreadPool pool(2);
+    pool.submit([] { throw std::runtime_error("boom"); });
+    CHECK_THROWS(pool.wait());
+
+    // Subsequent waits succeed once the error has been reported
+    pool.submit([] {});
+    CHECK_NOTHROW(pool.wait());
+}
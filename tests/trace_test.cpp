@@ -0,0 +1,88 @@
+#include "cgen/thread_pool.h"
+#include "cgen/trace.h"
+
+#include <atomic>
+#include <doctest/doctest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cgen;
+
+namespace {
+
+std::string read_file(const fs::path &path) {
+    std::ifstream     in(path);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+} // namespace
+
+TEST_CASE("Tracer: per-thread spans are written as trace events") {
+    fs::path path = fs::temp_directory_path() / "cgen_trace_test.json";
+
+    // Nothing is recorded while tracing is off
+    { TraceScope scope("ignored", "test"); }
+
+    tracer().start();
+    tracer().nameThread("main");
+    {
+        TraceScope outer("outer", "test");
+        ThreadPool pool(2);
+        fs::path   file = "dir/\"quoted\"\tname";
+        for (int i = 0; i < 8; ++i) {
+            pool.submit([&file] { TraceScope scope("task", "test", file); });
+        }
+        pool.wait();
+    }
+    tracer().stop();
+    { TraceScope scope("ignored", "test"); }
+
+    CHECK(tracer().eventCount() == 9);
+    REQUIRE(tracer().write(path).has_value());
+
+    std::string trace = read_file(path);
+    CHECK(trace.starts_with("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"));
+    CHECK(trace.find("\"args\": {\"name\": \"main\"}") != std::string::npos);
+    CHECK(trace.find("\"args\": {\"name\": \"worker ") != std::string::npos);
+    CHECK(trace.find("{\"name\": \"outer\", \"cat\": \"test\", \"ph\": \"X\", \"ts\": ") != std::string::npos);
+    CHECK(trace.find("\"args\": {\"file\": \"dir/\\\"quoted\\\"\\tname\"}") != std::string::npos);
+    CHECK(trace.find("ignored") == std::string::npos);
+
+    // Starting again discards the previous session
+    tracer().start();
+    tracer().stop();
+    CHECK(tracer().eventCount() == 0);
+    fs::remove(path);
+}
+
+TEST_CASE("Tracer: restarting while threads record keeps their buffers alive") {
+    std::atomic<bool>        done{false};
+    std::vector<std::thread> threads;
+    tracer().start();
+    for (int t = 0; t < 3; ++t) {
+        threads.emplace_back([&done] {
+            while (!done.load()) {
+                TraceScope scope("busy", "test");
+            }
+        });
+    }
+    for (int i = 0; i < 50; ++i) {
+        tracer().start();
+        std::this_thread::yield();
+    }
+    done = true;
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    tracer().stop();
+
+    // Only the last session is kept
+    tracer().start();
+    tracer().stop();
+    CHECK(tracer().eventCount() == 0);
+}